@@ -0,0 +1,115 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     AddressMap_bench.c
+
+  File Description:
+
+     This file contains the microbenchmark of the AddressMap. The uuids of 
+     LBeacons in the AddressMap and uuids not in it are looked up in a 
+     pseudo-random order.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "Bench.h"
+
+/* The number of lookups of each case */
+#define BENCH_ADDRESS_MAP_OPS 100000
+
+
+static AddressMapArray bench_address_map_array;
+
+
+static void run_case(int number_entries, bool is_found){
+
+    char uuids[MAX_NUMBER_NODES][LENGTH_OF_UUID];
+    char address[NETWORK_ADDR_LENGTH];
+    uint32_t random_state = BENCH_RANDOM_SEED;
+    Histogram latency;
+    uint64_t start_time;
+    uint64_t operation_start_time;
+    uint64_t elapsed_time;
+    char parameter[32];
+    int i;
+
+    init_Address_Map( &bench_address_map_array);
+
+    for(i = 0; i < number_entries; i++){
+
+        snprintf(uuids[i], LENGTH_OF_UUID, "%032X", i);
+        snprintf(address, sizeof(address), "10.%d.%d.%d", (i >> 16) & 0xFF, 
+                 (i >> 8) & 0xFF, i & 0xFF);
+
+        update_entry_in_Address_Map( &bench_address_map_array, i,
+                                    ADDRESS_MAP_TYPE_LBEACON, address,
+                                    uuids[i], BOT_GATEWAY_API_VERSION_LATEST);
+
+        /* The uuids not found are those past the entries */
+        if(is_found == false)
+            snprintf(uuids[i], LENGTH_OF_UUID, "%032X", i + MAX_NUMBER_NODES);
+    }
+
+    histogram_reset( &latency);
+
+    start_time = get_clock_time_in_ns();
+
+    for(i = 0; i < BENCH_ADDRESS_MAP_OPS; i++){
+
+        char *uuid = uuids[next_bench_random( &random_state) % 
+                           number_entries];
+
+        operation_start_time = get_clock_time_in_ns();
+
+        is_in_Address_Map( &bench_address_map_array, 
+                          ADDRESS_MAP_TYPE_LBEACON, uuid);
+
+        histogram_record( &latency,
+                         get_clock_time_in_ns() - operation_start_time);
+    }
+
+    elapsed_time = get_clock_time_in_ns() - start_time;
+
+    snprintf(parameter, sizeof(parameter), "entries=%d %s", number_entries,
+             is_found ? "found" : "not_found");
+
+    print_bench_result("address_map", parameter, 1, BENCH_ADDRESS_MAP_OPS,
+                       elapsed_time, &latency);
+}
+
+
+void bench_address_map(void){
+
+    int numbers_entries[] = {10, 1000, MAX_NUMBER_NODES};
+    int i;
+
+    for(i = 0; i < sizeof(numbers_entries) / sizeof(int); i++){
+
+        run_case(numbers_entries[i], true);
+        run_case(numbers_entries[i], false);
+    }
+}
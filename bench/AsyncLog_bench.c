@@ -0,0 +1,112 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     AsyncLog_bench.c
+
+  File Description:
+
+     This file contains the microbenchmark of the asynchronous logger. The
+     messages are logged in bursts of half a ring, and the writer thread
+     empties the ring between bursts, so that no message is dropped.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "Bench.h"
+
+/* The number of messages logged by each case */
+#define BENCH_ASYNC_LOG_OPS 100000
+
+/* The number of messages logged before waiting for the writer thread */
+#define BENCH_ASYNC_LOG_BURST (ASYNC_LOG_RING_LENGTH / 2)
+
+
+static AsyncLogger bench_async_logger;
+
+
+static void run_case(char *parameter, bool is_started,
+                     bool is_format_deferred){
+
+    char content[] = "1;8;2.0;0x1234;8F8F8F8F8F8F8F8F8F8F8F8F8F8F8F8F;"
+                     "-65;1598932800;";
+    Histogram latency;
+    uint64_t elapsed_time = 0;
+    uint64_t operation_start_time;
+    uint64_t operation_time;
+    uint64_t written_count = 0;
+    int i;
+    int j;
+
+    if(is_started == true &&
+       start_async_logger( &bench_async_logger, is_format_deferred) != 0)
+        return;
+
+    histogram_reset( &latency);
+
+    for(i = 0; i < BENCH_ASYNC_LOG_OPS; i += BENCH_ASYNC_LOG_BURST){
+
+        for(j = 0; j < BENCH_ASYNC_LOG_BURST; j++){
+
+            operation_start_time = get_clock_time_in_ns();
+
+            async_zlog_info(category_debug, "pkt_direction=[%d], " \
+                            "pkt_type=[%d] API_version=[%f] " \
+                            "new_node -> content=[%s]",
+                            i, j, 2.0, content);
+
+            operation_time = get_clock_time_in_ns() - operation_start_time;
+
+            histogram_record( &latency, operation_time);
+
+            /* The time waiting for the writer thread is not counted */
+            elapsed_time += operation_time;
+        }
+
+        if(is_started == false)
+            continue;
+
+        written_count += BENCH_ASYNC_LOG_BURST;
+
+        while(__atomic_load_n( &bench_async_logger.written_count,
+                              __ATOMIC_ACQUIRE) < written_count)
+            sched_yield();
+    }
+
+    if(is_started == true)
+        stop_async_logger( &bench_async_logger);
+
+    print_bench_result("async_log", parameter, 1, BENCH_ASYNC_LOG_OPS,
+                       elapsed_time, &latency);
+}
+
+
+void bench_async_log(void){
+
+    run_case("sync", false, false);
+    run_case("ring", true, false);
+    run_case("deferred", true, true);
+}
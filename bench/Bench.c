@@ -0,0 +1,128 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Bench.c
+
+  File Description:
+
+     This file contains the main program of the microbenchmarks. Usage:
+
+        Bench.out [benchmark ...]
+
+     where a benchmark is one of mempool, pkt_queue, thpool, linked_list,
+     address_map, udp_framing and async_log. All benchmarks run if none is
+     given.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "Bench.h"
+
+
+static Benchmark benchmarks[] = {
+    {"mempool", bench_mempool},
+    {"pkt_queue", bench_pkt_queue},
+    {"thpool", bench_thpool},
+    {"linked_list", bench_linked_list},
+    {"address_map", bench_address_map},
+    {"udp_framing", bench_udp_framing},
+    {"async_log", bench_async_log}
+};
+
+
+void print_bench_result(char *benchmark,
+                        char *parameter,
+                        int number_threads,
+                        uint64_t number_ops,
+                        uint64_t elapsed_time_in_ns,
+                        Histogram *latency){
+
+    double seconds = (double)elapsed_time_in_ns / NS_EACH_SECOND;
+    uint64_t p50 = histogram_percentile(latency, 50);
+    uint64_t p99 = histogram_percentile(latency, 99);
+
+    /* The percentiles are the upper bounds of buckets */
+    if(p50 > latency->max_value)
+        p50 = latency->max_value;
+    if(p99 > latency->max_value)
+        p99 = latency->max_value;
+
+    printf("%s,%s,%d,%llu,%.6f,%.0f,%llu,%llu,%llu\n",
+           benchmark, parameter, number_threads,
+           (unsigned long long)number_ops, seconds,
+           (seconds > 0) ? number_ops / seconds : 0,
+           (unsigned long long)p50, (unsigned long long)p99,
+           (unsigned long long)latency->max_value);
+
+    fflush(stdout);
+}
+
+
+uint32_t next_bench_random(uint32_t *state){
+
+    /* xorshift32 */
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+
+    return *state;
+}
+
+
+int main(int argc, char **argv){
+
+    int number_benchmarks = sizeof(benchmarks) / sizeof(Benchmark);
+    int i;
+    int j;
+
+    /* The primitives log as in the gateway */
+    if(zlog_init(BENCH_ZLOG_CONFIG_FILE_NAME) == 0)
+        category_debug = zlog_get_category(LOG_CATEGORY_DEBUG);
+
+    printf("benchmark,parameter,threads,ops,seconds,ops_per_sec,"
+           "p50_ns,p99_ns,max_ns\n");
+
+    for(i = 0; i < number_benchmarks; i++){
+
+        if(argc > 1){
+
+            for(j = 1; j < argc; j++){
+                if(strcmp(argv[j], benchmarks[i].name) == 0)
+                    break;
+            }
+
+            if(j == argc)
+                continue;
+        }
+
+        benchmarks[i].function();
+    }
+
+    zlog_fini();
+
+    return 0;
+}
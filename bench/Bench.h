@@ -0,0 +1,174 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Bench.h
+
+  File Description:
+
+     This header file contains the declarations of the microbenchmarks of 
+     the primitives in import. Every benchmark runs a fixed number of 
+     operations with fixed inputs, so that runs are comparable across 
+     builds, and prints one line of comma separated values per case:
+
+        benchmark,parameter,threads,ops,seconds,ops_per_sec,p50_ns,p99_ns,
+        max_ns
+
+     The percentiles are taken over the latency of single operations, 
+     including the reading of the clock, unless the benchmark describes 
+     another latency.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <sched.h>
+
+#include "BeDIS.h"
+
+/* The path of the configuration file of zlog, as used by the gateway */
+#define BENCH_ZLOG_CONFIG_FILE_NAME "../config/zlog.conf"
+
+/* The largest number of threads of a case */
+#define BENCH_MAX_THREADS 8
+
+/* The seed of the pseudo-random sequences of the benchmarks */
+#define BENCH_RANDOM_SEED 20261019
+
+
+/* A benchmark and the name it is selected by on the command line */
+typedef struct {
+
+    char *name;
+
+    void (*function)(void);
+
+} Benchmark;
+
+
+/*
+  print_bench_result:
+
+     This function prints the result of a case of a benchmark.
+
+  Parameters:
+
+     benchmark - The name of the benchmark.
+     parameter - The parameter of the case.
+     number_threads - The number of threads of the case.
+     number_ops - The number of operations run.
+     elapsed_time_in_ns - The time in nanoseconds the operations took.
+     latency - The histogram of the latency of the operations in 
+               nanoseconds.
+
+  Return value:
+
+     None
+ */
+void print_bench_result(char *benchmark,
+                        char *parameter,
+                        int number_threads,
+                        uint64_t number_ops,
+                        uint64_t elapsed_time_in_ns,
+                        Histogram *latency);
+
+/*
+  next_bench_random:
+
+     This function returns the next value of a pseudo-random sequence.
+
+  Parameters:
+
+     state - A pointer to the state of the sequence.
+
+  Return value:
+
+     uint32_t - The next value.
+ */
+uint32_t next_bench_random(uint32_t *state);
+
+/*
+  bench_mempool:
+
+     This function benchmarks mp_alloc and mp_free under 1 to 
+     BENCH_MAX_THREADS threads sharing one memory pool.
+ */
+void bench_mempool(void);
+
+/*
+  bench_pkt_queue:
+
+     This function benchmarks addpkt and get_pkt_into for each kind of 
+     synchronization of the pkt queue. The latency is the time pkts wait in 
+     the queue.
+ */
+void bench_pkt_queue(void);
+
+/*
+  bench_thpool:
+
+     This function benchmarks thpool_add_work. The latency is the time from
+     adding a job to a worker starting it.
+ */
+void bench_thpool(void);
+
+/*
+  bench_linked_list:
+
+     This function benchmarks insert_list_tail and remove_list_node.
+ */
+void bench_linked_list(void);
+
+/*
+  bench_address_map:
+
+     This function benchmarks is_in_Address_Map with 10, 1000 and 
+     MAX_NUMBER_NODES entries, for uuids found and not found.
+ */
+void bench_address_map(void);
+
+/*
+  bench_udp_framing:
+
+     This function benchmarks the framing of udp_addpkt and udp_getrecv for
+     messages of several sizes, through the queues of a UDP configuration 
+     without sockets.
+ */
+void bench_udp_framing(void);
+
+/*
+  bench_async_log:
+
+     This function benchmarks async_zlog with a message of the packet path,
+     written by zlog synchronously, formatted into the ring and deferred to
+     the writer thread. The latency is the time the logging thread spends
+     in async_zlog.
+ */
+void bench_async_log(void);
+
+#endif
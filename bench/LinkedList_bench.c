@@ -0,0 +1,96 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     LinkedList_bench.c
+
+  File Description:
+
+     This file contains the microbenchmark of the linked list. The first node
+     of a list is removed and inserted at the tail, as buffer lists are 
+     consumed and refilled.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "Bench.h"
+
+/* The number of nodes moved by each case */
+#define BENCH_LINKED_LIST_OPS 2000000
+
+/* The largest length of the list */
+#define BENCH_LINKED_LIST_MAX_LENGTH 1000
+
+
+static List_Entry bench_nodes[BENCH_LINKED_LIST_MAX_LENGTH];
+
+
+void bench_linked_list(void){
+
+    int lengths[] = {10, BENCH_LINKED_LIST_MAX_LENGTH};
+    List_Entry list_head;
+    List_Entry *node = NULL;
+    Histogram latency;
+    uint64_t start_time;
+    uint64_t operation_start_time;
+    uint64_t elapsed_time;
+    char parameter[32];
+    int i;
+    int j;
+
+    for(i = 0; i < sizeof(lengths) / sizeof(int); i++){
+
+        init_entry( &list_head);
+
+        for(j = 0; j < lengths[i]; j++){
+            init_entry( &bench_nodes[j]);
+            insert_list_tail( &bench_nodes[j], &list_head);
+        }
+
+        histogram_reset( &latency);
+
+        start_time = get_clock_time_in_ns();
+
+        for(j = 0; j < BENCH_LINKED_LIST_OPS; j++){
+
+            operation_start_time = get_clock_time_in_ns();
+
+            node = list_head.next;
+            remove_list_node(node);
+            insert_list_tail(node, &list_head);
+
+            histogram_record( &latency,
+                             get_clock_time_in_ns() - operation_start_time);
+        }
+
+        elapsed_time = get_clock_time_in_ns() - start_time;
+
+        snprintf(parameter, sizeof(parameter), "length=%d", lengths[i]);
+
+        print_bench_result("linked_list", parameter, 1, BENCH_LINKED_LIST_OPS,
+                           elapsed_time, &latency);
+    }
+}
@@ -0,0 +1,120 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Mempool_bench.c
+
+  File Description:
+
+     This file contains the microbenchmark of the memory pool. Threads 
+     sharing one memory pool allocate a batch of slots and free them again.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "Bench.h"
+
+/* The number of slots allocated and freed by each thread */
+#define BENCH_MEMPOOL_SLOTS_PER_THREAD 500000
+
+/* The number of slots each thread holds at a time */
+#define BENCH_MEMPOOL_BATCH 16
+
+/* The number of slots of the memory pool, as for the buffer nodes of the 
+   gateway */
+#define BENCH_MEMPOOL_SLOTS 2048
+
+
+static Memory_Pool bench_mempool_pool;
+
+static Histogram bench_mempool_latency;
+
+
+static void *mempool_routine(void *arg){
+
+    void *slots[BENCH_MEMPOOL_BATCH];
+    uint64_t start_time;
+    int i;
+    int j;
+
+    for(i = 0; i < BENCH_MEMPOOL_SLOTS_PER_THREAD; i += BENCH_MEMPOOL_BATCH){
+
+        for(j = 0; j < BENCH_MEMPOOL_BATCH; j++){
+
+            start_time = get_clock_time_in_ns();
+            slots[j] = mp_alloc( &bench_mempool_pool);
+            histogram_record( &bench_mempool_latency,
+                             get_clock_time_in_ns() - start_time);
+        }
+
+        for(j = 0; j < BENCH_MEMPOOL_BATCH; j++){
+
+            start_time = get_clock_time_in_ns();
+            mp_free( &bench_mempool_pool, slots[j]);
+            histogram_record( &bench_mempool_latency,
+                             get_clock_time_in_ns() - start_time);
+        }
+    }
+
+    return (void *)NULL;
+}
+
+
+void bench_mempool(void){
+
+    pthread_t threads[BENCH_MAX_THREADS];
+    uint64_t start_time;
+    uint64_t elapsed_time;
+    int number_threads;
+    int i;
+
+    for(number_threads = 1; number_threads <= BENCH_MAX_THREADS; 
+        number_threads *= 2){
+
+        if(mp_init( &bench_mempool_pool, sizeof(BufferNode),
+                   BENCH_MEMPOOL_SLOTS) != MEMORY_POOL_SUCCESS)
+            return;
+
+        histogram_reset( &bench_mempool_latency);
+
+        start_time = get_clock_time_in_ns();
+
+        for(i = 0; i < number_threads; i++)
+            pthread_create( &threads[i], NULL, mempool_routine, NULL);
+
+        for(i = 0; i < number_threads; i++)
+            pthread_join(threads[i], NULL);
+
+        elapsed_time = get_clock_time_in_ns() - start_time;
+
+        mp_destroy( &bench_mempool_pool);
+
+        print_bench_result("mempool", "alloc_free", number_threads,
+                           (uint64_t)number_threads * 
+                           BENCH_MEMPOOL_SLOTS_PER_THREAD * 2,
+                           elapsed_time, &bench_mempool_latency);
+    }
+}
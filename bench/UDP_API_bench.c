@@ -0,0 +1,145 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     UDP_API_bench.c
+
+  File Description:
+
+     This file contains the microbenchmark of the UDP framing. Messages are
+     added by udp_addpkt and got by udp_getrecv through the queues of a UDP 
+     configuration which has no sockets, so only the framing and the queues
+     are measured.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+/* For aligned_alloc, which -std=gnu99 does not declare. Defining it turns
+   off the default features such as SO_REUSEPORT, so they are kept on. */
+#define _ISOC11_SOURCE
+#define _DEFAULT_SOURCE
+
+#include "Bench.h"
+
+/* The number of messages of each case */
+#define BENCH_UDP_OPS 100000
+
+
+static void run_case(pudp_config udp_config, int content_size){
+
+    char content[WIFI_MESSAGE_LENGTH];
+    char message[LENGTH_OF_ENCODED_WIFI_MESSAGE];
+    int message_size;
+    static sPkt pkt;
+    Histogram add_latency;
+    Histogram get_latency;
+    uint64_t add_time = 0;
+    uint64_t get_time = 0;
+    uint64_t start_time;
+    uint64_t operation_time;
+    char parameter[32];
+    int i;
+
+    memset(content, 0, sizeof(content));
+
+    for(i = 0; i < content_size; i++)
+        content[i] = 'a' + i % 26;
+
+    message_size = udp_encode_message(content, message, sizeof(message));
+    if(message_size < 0)
+        return;
+
+    histogram_reset( &add_latency);
+    histogram_reset( &get_latency);
+
+    for(i = 0; i < BENCH_UDP_OPS; i++){
+
+        /* The framed message is got from the send queue untimed */
+        start_time = get_clock_time_in_ns();
+        udp_addpkt(udp_config, "127.0.0.1", 8888, content, content_size);
+        operation_time = get_clock_time_in_ns() - start_time;
+
+        add_time += operation_time;
+        histogram_record( &add_latency, operation_time);
+
+        get_pkt_into( &udp_config -> pkt_Queue, &pkt);
+
+        /* The framed message is added to the receive queue untimed */
+        addpkt( &udp_config -> receivers[0].Received_Queue, "127.0.0.1", 
+               8888, message, message_size);
+
+        start_time = get_clock_time_in_ns();
+        pkt = udp_getrecv(udp_config);
+        operation_time = get_clock_time_in_ns() - start_time;
+
+        get_time += operation_time;
+        histogram_record( &get_latency, operation_time);
+    }
+
+    snprintf(parameter, sizeof(parameter), "udp_addpkt size=%d", 
+             content_size);
+    print_bench_result("udp_framing", parameter, 1, BENCH_UDP_OPS, add_time,
+                       &add_latency);
+
+    snprintf(parameter, sizeof(parameter), "udp_getrecv size=%d", 
+             content_size);
+    print_bench_result("udp_framing", parameter, 1, BENCH_UDP_OPS, get_time,
+                       &get_latency);
+}
+
+
+void bench_udp_framing(void){
+
+    int content_sizes[] = {64, 1024, WIFI_MESSAGE_LENGTH / 2};
+    pudp_config udp_config = NULL;
+    int i;
+
+    udp_config = aligned_alloc(CACHE_LINE_SIZE, sizeof(sudp_config));
+    if(udp_config == NULL)
+        return;
+
+    memset(udp_config, 0, sizeof(sudp_config));
+
+    udp_config -> receivers = aligned_alloc(CACHE_LINE_SIZE, 
+                                            sizeof(sudp_receiver));
+    if(udp_config -> receivers == NULL){
+        free(udp_config);
+        return;
+    }
+
+    init_Packet_Queue_with_type( &udp_config -> pkt_Queue, PKT_QUEUE_MPSC);
+    init_Packet_Queue_with_type( &udp_config -> receivers[0].Received_Queue, 
+                                PKT_QUEUE_SPSC);
+
+    for(i = 0; i < sizeof(content_sizes) / sizeof(int); i++)
+        run_case(udp_config, content_sizes[i]);
+
+    Free_Packet_Queue( &udp_config -> pkt_Queue);
+    Free_Packet_Queue( &udp_config -> receivers[0].Received_Queue);
+
+    free(udp_config -> receivers);
+    free(udp_config);
+}
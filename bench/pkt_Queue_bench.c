@@ -0,0 +1,151 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     pkt_Queue_bench.c
+
+  File Description:
+
+     This file contains the microbenchmark of the pkt queue. For each kind of
+     synchronization, producer threads add small pkts while one consumer 
+     thread gets them.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+/* For aligned_alloc, which -std=gnu99 does not declare. Defining it turns
+   off the default features such as SO_REUSEPORT, so they are kept on. */
+#define _ISOC11_SOURCE
+#define _DEFAULT_SOURCE
+
+#include "Bench.h"
+
+/* The number of pkts added by each case */
+#define BENCH_NUMBER_PKTS 2000000
+
+/* The size in bytes of the content of each pkt */
+#define BENCH_CONTENT_SIZE 64
+
+
+typedef struct {
+
+    pkt_ptr pkt_queue;
+
+    int number_pkts;
+
+} BenchProducer;
+
+
+static void *producer_routine(void *bench_producer){
+
+    BenchProducer *producer = (BenchProducer *)bench_producer;
+    char content[BENCH_CONTENT_SIZE];
+    int i;
+
+    memset(content, 'p', sizeof(content));
+
+    for(i = 0; i < producer->number_pkts; i++){
+
+        while(addpkt(producer->pkt_queue, "127.0.0.1", 8888, content,
+                     sizeof(content)) == pkt_Queue_FULL)
+            sched_yield();
+    }
+
+    return (void *)NULL;
+}
+
+
+static void run_case(pkt_ptr pkt_queue, PktQueueType type, char *type_name,
+                     int number_producers){
+
+    pthread_t producer_threads[BENCH_MAX_THREADS];
+    BenchProducer producers[BENCH_MAX_THREADS];
+    int number_pkts = BENCH_NUMBER_PKTS / number_producers * number_producers;
+    int number_got = 0;
+    uint64_t start_time;
+    uint64_t elapsed_time;
+    static Histogram latency;
+    static sPkt pkt;
+    int i;
+
+    init_Packet_Queue_with_type(pkt_queue, type);
+    histogram_reset(&latency);
+
+    start_time = get_clock_time_in_ns();
+
+    for(i = 0; i < number_producers; i++){
+
+        producers[i].pkt_queue = pkt_queue;
+        producers[i].number_pkts = number_pkts / number_producers;
+        pthread_create(&producer_threads[i], NULL, producer_routine,
+                       &producers[i]);
+    }
+
+    while(number_got < number_pkts){
+
+        if(get_pkt_into(pkt_queue, &pkt) == pkt_Queue_is_NULL){
+            sched_yield();
+            continue;
+        }
+
+        histogram_record(&latency,
+                         get_clock_time_in_ns() - pkt.enqueue_time_in_ns);
+        number_got++;
+    }
+
+    elapsed_time = get_clock_time_in_ns() - start_time;
+
+    for(i = 0; i < number_producers; i++)
+        pthread_join(producer_threads[i], NULL);
+
+    Free_Packet_Queue(pkt_queue);
+
+    print_bench_result("pkt_queue", type_name, number_producers, number_pkts,
+                       elapsed_time, &latency);
+}
+
+
+void bench_pkt_queue(void){
+
+    pkt_ptr pkt_queue = NULL;
+    int number_producers;
+
+    pkt_queue = aligned_alloc(CACHE_LINE_SIZE, sizeof(spkt_ptr));
+    if(pkt_queue == NULL)
+        return;
+
+    run_case(pkt_queue, PKT_QUEUE_LOCKED, "locked", 1);
+    run_case(pkt_queue, PKT_QUEUE_SPSC, "spsc", 1);
+
+    for(number_producers = 1; number_producers <= BENCH_MAX_THREADS;
+        number_producers *= 2){
+
+        run_case(pkt_queue, PKT_QUEUE_LOCKED, "locked", number_producers);
+        run_case(pkt_queue, PKT_QUEUE_MPSC, "mpsc", number_producers);
+    }
+
+    free(pkt_queue);
+}
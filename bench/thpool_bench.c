@@ -0,0 +1,128 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     thpool_bench.c
+
+  File Description:
+
+     This file contains the microbenchmark of the thread pool. One thread 
+     adds jobs which do nothing but record when a worker started them.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "Bench.h"
+
+/* The number of jobs added by each case */
+#define BENCH_THPOOL_JOBS 200000
+
+/* The number of slots of the memory pool of the thread pool each worker
+   leaves for the jobs, after its own thread, the job queue and the job it
+   finished but has not freed yet */
+#define BENCH_THPOOL_JOB_SLOTS_PER_WORKER (SLOTS_FOR_MEM_POOL_PER_THREAD - 3)
+
+
+typedef struct {
+
+    /* The uptime in nanoseconds at which the job was added */
+    uint64_t add_time_in_ns;
+
+} BenchJob;
+
+
+static BenchJob bench_jobs[BENCH_THPOOL_JOBS];
+
+static Histogram bench_thpool_latency;
+
+static int bench_finished_jobs;
+
+
+static void bench_job(void *arg){
+
+    BenchJob *job = (BenchJob *)arg;
+
+    histogram_record( &bench_thpool_latency,
+                     get_clock_time_in_ns() - job->add_time_in_ns);
+
+    __atomic_fetch_add( &bench_finished_jobs, 1, __ATOMIC_RELEASE);
+}
+
+
+void bench_thpool(void){
+
+    Threadpool threadpool = NULL;
+    uint64_t start_time;
+    uint64_t elapsed_time;
+    int number_workers;
+    int max_in_flight;
+    char parameter[32];
+    int i;
+
+    for(number_workers = 1; number_workers <= BENCH_MAX_THREADS; 
+        number_workers *= 2){
+
+        threadpool = thpool_init(number_workers);
+        if(threadpool == NULL)
+            return;
+
+        /* Jobs are not added beyond the memory pool of the thread pool */
+        max_in_flight = number_workers * BENCH_THPOOL_JOB_SLOTS_PER_WORKER;
+
+        histogram_reset( &bench_thpool_latency);
+        bench_finished_jobs = 0;
+
+        start_time = get_clock_time_in_ns();
+
+        for(i = 0; i < BENCH_THPOOL_JOBS; i++){
+
+            while(i - __atomic_load_n( &bench_finished_jobs, 
+                                       __ATOMIC_ACQUIRE) >=
+                  max_in_flight)
+                sched_yield();
+
+            bench_jobs[i].add_time_in_ns = get_clock_time_in_ns();
+
+            while(thpool_add_work(threadpool, bench_job, &bench_jobs[i], 0)
+                  != 0)
+                sched_yield();
+        }
+
+        while(__atomic_load_n( &bench_finished_jobs, __ATOMIC_ACQUIRE) <
+              BENCH_THPOOL_JOBS)
+            sched_yield();
+
+        elapsed_time = get_clock_time_in_ns() - start_time;
+
+        thpool_destroy(threadpool);
+
+        snprintf(parameter, sizeof(parameter), "add_work");
+
+        print_bench_result("thpool", parameter, number_workers,
+                           BENCH_THPOOL_JOBS, elapsed_time,
+                           &bench_thpool_latency);
+    }
+}
@@ -0,0 +1,684 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     AsyncLog.c
+
+  File Description:
+
+     This file contains the programs of the asynchronous logger.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+/* For aligned_alloc, which -std=gnu99 does not declare. Defining it turns
+   off the default features such as SO_REUSEPORT, so they are kept on. */
+#define _ISOC11_SOURCE
+#define _DEFAULT_SOURCE
+
+#include "AsyncLog.h"
+
+
+/* The logger started, or NULL if messages are written synchronously */
+static AsyncLogger *active_logger = NULL;
+
+/* The number of times a logger has been started */
+static uint64_t logger_generation = 0;
+
+/* The ring of the calling thread, or NULL if it has not logged yet. Rings
+   are never freed, because a thread may still hold its ring when the
+   logger is stopped. */
+static __thread AsyncLogRing *thread_ring = NULL;
+
+/* The generation of the logger the ring of the calling thread is added to,
+   or of the logger which has no ring left for the thread */
+static __thread uint64_t thread_ring_generation = 0;
+
+
+/* The length modifiers of conversions */
+typedef enum {
+    LENGTH_NONE,
+    LENGTH_CHAR,
+    LENGTH_SHORT,
+    LENGTH_LONG,
+    LENGTH_LONG_LONG,
+    LENGTH_INTMAX,
+    LENGTH_SIZE,
+    LENGTH_PTRDIFF,
+    LENGTH_LONG_DOUBLE
+} LengthModifier;
+
+/* The types of arguments copied into a record */
+typedef enum {
+    ARGUMENT_NONE,
+    ARGUMENT_SIGNED,
+    ARGUMENT_UNSIGNED,
+    ARGUMENT_CHARACTER,
+    ARGUMENT_DOUBLE,
+    ARGUMENT_LONG_DOUBLE,
+    ARGUMENT_STRING,
+    ARGUMENT_POINTER,
+    ARGUMENT_UNSUPPORTED
+} ArgumentType;
+
+/* A conversion of a format, e.g. "%-*.3lu" */
+typedef struct {
+
+    /* The length of the conversion, including '%' */
+    int length;
+
+    /* The number of '*' in the width and precision, each taking an int
+       argument before the argument of the conversion */
+    int number_stars;
+
+    LengthModifier length_modifier;
+
+    ArgumentType argument_type;
+
+} Conversion;
+
+
+/* Gets the ring of the calling thread, adding one on its first message */
+static AsyncLogRing *get_thread_ring(AsyncLogger *logger){
+
+    AsyncLogRing *ring = thread_ring;
+    uint64_t generation = __atomic_load_n(&logger_generation, 
+                                          __ATOMIC_ACQUIRE);
+    int index;
+
+    if(thread_ring_generation == generation)
+        return ring;
+
+    /* The ring of a logger stopped before is added to the current one */
+    thread_ring_generation = generation;
+    thread_ring = NULL;
+
+    index = __atomic_fetch_add(&logger->number_rings, 1, __ATOMIC_ACQ_REL);
+
+    if(index >= MAX_ASYNC_LOG_THREADS)
+        return NULL;
+
+    if(ring == NULL)
+        ring = aligned_alloc(CACHE_LINE_SIZE, sizeof(AsyncLogRing));
+
+    if(ring == NULL)
+        return NULL;
+
+    ring->head = 0;
+    ring->tail = 0;
+
+    /* The writer thread skips the slot until the ring is published */
+    __atomic_store_n(&logger->rings[index], ring, __ATOMIC_RELEASE);
+
+    thread_ring = ring;
+
+    return ring;
+}
+
+
+/* Parses the conversion starting at the '%' of a format */
+static void parse_conversion(const char *format, Conversion *conversion){
+
+    const char *current = format + 1;
+
+    conversion->number_stars = 0;
+    conversion->length_modifier = LENGTH_NONE;
+
+    while(strchr("-+ #0'", *current) != NULL && *current != '\0')
+        current++;
+
+    /* The width and the precision */
+    while((*current >= '0' && *current <= '9') || *current == '.' || 
+          *current == '*'){
+
+        if(*current == '*')
+            conversion->number_stars++;
+        current++;
+    }
+
+    switch(*current){
+        case 'h':
+            conversion->length_modifier = LENGTH_SHORT;
+            if(*(++current) == 'h'){
+                conversion->length_modifier = LENGTH_CHAR;
+                current++;
+            }
+            break;
+        case 'l':
+            conversion->length_modifier = LENGTH_LONG;
+            if(*(++current) == 'l'){
+                conversion->length_modifier = LENGTH_LONG_LONG;
+                current++;
+            }
+            break;
+        case 'q':
+            conversion->length_modifier = LENGTH_LONG_LONG;
+            current++;
+            break;
+        case 'j':
+            conversion->length_modifier = LENGTH_INTMAX;
+            current++;
+            break;
+        case 'z':
+            conversion->length_modifier = LENGTH_SIZE;
+            current++;
+            break;
+        case 't':
+            conversion->length_modifier = LENGTH_PTRDIFF;
+            current++;
+            break;
+        case 'L':
+            conversion->length_modifier = LENGTH_LONG_DOUBLE;
+            current++;
+            break;
+    }
+
+    switch(*current){
+        case 'd':
+        case 'i':
+            conversion->argument_type = ARGUMENT_SIGNED;
+            break;
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            conversion->argument_type = ARGUMENT_UNSIGNED;
+            break;
+        case 'c':
+            conversion->argument_type = 
+                conversion->length_modifier == LENGTH_NONE ? 
+                ARGUMENT_CHARACTER : ARGUMENT_UNSUPPORTED;
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            conversion->argument_type = 
+                conversion->length_modifier == LENGTH_LONG_DOUBLE ? 
+                ARGUMENT_LONG_DOUBLE : ARGUMENT_DOUBLE;
+            break;
+        case 's':
+            conversion->argument_type = 
+                conversion->length_modifier == LENGTH_NONE ? 
+                ARGUMENT_STRING : ARGUMENT_UNSUPPORTED;
+            break;
+        case 'p':
+            conversion->argument_type = ARGUMENT_POINTER;
+            break;
+        case '%':
+            conversion->argument_type = ARGUMENT_NONE;
+            break;
+        default:
+            conversion->argument_type = ARGUMENT_UNSUPPORTED;
+            break;
+    }
+
+    if(*current != '\0')
+        current++;
+
+    conversion->length = current - format;
+}
+
+
+/* Gets an integer argument by the length modifier of its conversion, and
+   converts it as printf would before widening it to 64 bits */
+static unsigned long long get_integer_argument(Conversion *conversion, 
+                                               va_list *args){
+
+    bool is_signed = conversion->argument_type == ARGUMENT_SIGNED;
+
+    switch(conversion->length_modifier){
+        case LENGTH_CHAR:
+            return is_signed ? 
+                   (long long)(signed char)va_arg(*args, int) :
+                   (unsigned char)va_arg(*args, unsigned int);
+        case LENGTH_SHORT:
+            return is_signed ? 
+                   (long long)(short)va_arg(*args, int) :
+                   (unsigned short)va_arg(*args, unsigned int);
+        case LENGTH_LONG:
+            return is_signed ? 
+                   (long long)va_arg(*args, long) :
+                   va_arg(*args, unsigned long);
+        case LENGTH_LONG_LONG:
+            return is_signed ? 
+                   va_arg(*args, long long) :
+                   va_arg(*args, unsigned long long);
+        case LENGTH_INTMAX:
+            return is_signed ? 
+                   (long long)va_arg(*args, intmax_t) :
+                   va_arg(*args, uintmax_t);
+        case LENGTH_SIZE:
+        case LENGTH_PTRDIFF:
+            return is_signed ? 
+                   (long long)va_arg(*args, ptrdiff_t) :
+                   va_arg(*args, size_t);
+        default:
+            return is_signed ? 
+                   (long long)va_arg(*args, int) :
+                   va_arg(*args, unsigned int);
+    }
+}
+
+
+/* Copies a value into the arguments of a record, returning false when the
+   record is full */
+static bool pack_value(char *arguments, size_t *size, const void *value,
+                       size_t value_size){
+
+    if(*size + value_size > ASYNC_LOG_MESSAGE_LENGTH)
+        return false;
+
+    memcpy(arguments + *size, value, value_size);
+    *size += value_size;
+
+    return true;
+}
+
+
+/* Copies the arguments of a format into a record, in the order of their
+   conversions. It returns false if an argument cannot be copied. */
+static bool pack_arguments(char *arguments, const char *format, 
+                           va_list *args){
+
+    Conversion conversion;
+    unsigned long long integer;
+    double double_value;
+    long double long_double_value;
+    const char *string;
+    void *pointer;
+    size_t size = 0;
+    int star;
+    int i;
+    bool is_packed = true;
+
+    while(*format != '\0' && is_packed == true){
+
+        if(*format != '%'){
+            format++;
+            continue;
+        }
+
+        parse_conversion(format, &conversion);
+        format += conversion.length;
+
+        for(i = 0; i < conversion.number_stars && is_packed == true; i++){
+            star = va_arg(*args, int);
+            is_packed = pack_value(arguments, &size, &star, sizeof(star));
+        }
+
+        if(is_packed == false)
+            break;
+
+        switch(conversion.argument_type){
+            case ARGUMENT_SIGNED:
+            case ARGUMENT_UNSIGNED:
+                integer = get_integer_argument(&conversion, args);
+                is_packed = pack_value(arguments, &size, &integer, 
+                                       sizeof(integer));
+                break;
+            case ARGUMENT_CHARACTER:
+                star = va_arg(*args, int);
+                is_packed = pack_value(arguments, &size, &star, 
+                                       sizeof(star));
+                break;
+            case ARGUMENT_DOUBLE:
+                double_value = va_arg(*args, double);
+                is_packed = pack_value(arguments, &size, &double_value, 
+                                       sizeof(double_value));
+                break;
+            case ARGUMENT_LONG_DOUBLE:
+                long_double_value = va_arg(*args, long double);
+                is_packed = pack_value(arguments, &size, &long_double_value,
+                                       sizeof(long_double_value));
+                break;
+            case ARGUMENT_STRING:
+                string = va_arg(*args, const char *);
+                if(string == NULL)
+                    string = "(null)";
+                is_packed = pack_value(arguments, &size, string, 
+                                       strlen(string) + 1);
+                break;
+            case ARGUMENT_POINTER:
+                pointer = va_arg(*args, void *);
+                is_packed = pack_value(arguments, &size, &pointer, 
+                                       sizeof(pointer));
+                break;
+            case ARGUMENT_NONE:
+                break;
+            default:
+                is_packed = false;
+                break;
+        }
+    }
+
+    return is_packed;
+}
+
+
+/* Formats a record whose arguments are packed, as vsnprintf would have
+   formatted them when the message was logged */
+static void render_arguments(AsyncLogRecord *record, char *message, 
+                             size_t message_size){
+
+    const char *format = record->format;
+    const char *arguments = record->message;
+    char specification[32];
+    Conversion conversion;
+    unsigned long long integer;
+    double double_value;
+    long double long_double_value;
+    void *pointer;
+    int stars[2] = {0, 0};
+    int character;
+    size_t length = 0;
+    int written;
+    int i;
+
+/* Prints the argument of a conversion after its width and precision */
+#define RENDER_ARGUMENT(value) \
+    (conversion.number_stars == 0 ? \
+        snprintf(message + length, message_size - length, specification, \
+                 value) : \
+     conversion.number_stars == 1 ? \
+        snprintf(message + length, message_size - length, specification, \
+                 stars[0], value) : \
+        snprintf(message + length, message_size - length, specification, \
+                 stars[0], stars[1], value))
+
+    while(*format != '\0' && length + 1 < message_size){
+
+        if(*format != '%'){
+            message[length++] = *format++;
+            continue;
+        }
+
+        parse_conversion(format, &conversion);
+
+        if(conversion.length >= sizeof(specification) - 2 || 
+           conversion.number_stars > 2)
+            break;
+
+        memcpy(specification, format, conversion.length);
+        specification[conversion.length] = '\0';
+        format += conversion.length;
+
+        for(i = 0; i < conversion.number_stars; i++){
+            memcpy(&stars[i], arguments, sizeof(int));
+            arguments += sizeof(int);
+        }
+
+        written = 0;
+
+        switch(conversion.argument_type){
+            case ARGUMENT_SIGNED:
+            case ARGUMENT_UNSIGNED:
+                /* The integers are packed as 64 bits, so the length 
+                   modifier is replaced by ll */
+                i = conversion.length - 1;
+                while(i > 0 && strchr("hlqjztL", specification[i - 1]) != 
+                      NULL)
+                    i--;
+                specification[i] = 'l';
+                specification[i + 1] = 'l';
+                specification[i + 2] = format[-1];
+                specification[i + 3] = '\0';
+
+                memcpy(&integer, arguments, sizeof(integer));
+                arguments += sizeof(integer);
+                written = RENDER_ARGUMENT(integer);
+                break;
+            case ARGUMENT_CHARACTER:
+                memcpy(&character, arguments, sizeof(character));
+                arguments += sizeof(character);
+                written = RENDER_ARGUMENT(character);
+                break;
+            case ARGUMENT_DOUBLE:
+                memcpy(&double_value, arguments, sizeof(double_value));
+                arguments += sizeof(double_value);
+                written = RENDER_ARGUMENT(double_value);
+                break;
+            case ARGUMENT_LONG_DOUBLE:
+                memcpy(&long_double_value, arguments, 
+                       sizeof(long_double_value));
+                arguments += sizeof(long_double_value);
+                written = RENDER_ARGUMENT(long_double_value);
+                break;
+            case ARGUMENT_STRING:
+                written = RENDER_ARGUMENT(arguments);
+                arguments += strlen(arguments) + 1;
+                break;
+            case ARGUMENT_POINTER:
+                memcpy(&pointer, arguments, sizeof(pointer));
+                arguments += sizeof(pointer);
+                written = RENDER_ARGUMENT(pointer);
+                break;
+            case ARGUMENT_NONE:
+                written = snprintf(message + length, message_size - length,
+                                   "%s", "%");
+                break;
+            default:
+                break;
+        }
+
+        if(written > 0)
+            length += written;
+    }
+
+#undef RENDER_ARGUMENT
+
+    if(length >= message_size)
+        length = message_size - 1;
+
+    message[length] = '\0';
+}
+
+
+/* Writes the messages waiting in a ring, returning the number written */
+static int drain_ring(AsyncLogger *logger, AsyncLogRing *ring){
+
+    AsyncLogRecord *record;
+    uint64_t head = ring->head;
+    uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    char message[ASYNC_LOG_MESSAGE_LENGTH];
+    int number_written = 0;
+
+    while(head != tail){
+
+        record = &ring->records[head & (ASYNC_LOG_RING_LENGTH - 1)];
+
+        if(record->category != NULL){
+
+            if(record->format != NULL)
+                render_arguments(record, message, sizeof(message));
+
+            zlog(record->category, record->file, record->file_len,
+                 record->func, record->func_len, record->line,
+                 record->level, "%s", 
+                 record->format != NULL ? message : record->message);
+        }
+
+        head++;
+        number_written++;
+
+        /* The slot is given back as soon as it is written */
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+
+    if(number_written > 0)
+        __atomic_fetch_add(&logger->written_count, number_written,
+                           __ATOMIC_RELAXED);
+
+    return number_written;
+}
+
+
+/* Writes the messages waiting in every ring */
+static int drain_rings(AsyncLogger *logger){
+
+    AsyncLogRing *ring;
+    int number_rings;
+    int number_written = 0;
+    int index;
+
+    number_rings = __atomic_load_n(&logger->number_rings, __ATOMIC_ACQUIRE);
+    if(number_rings > MAX_ASYNC_LOG_THREADS)
+        number_rings = MAX_ASYNC_LOG_THREADS;
+
+    for(index = 0; index < number_rings; index++){
+
+        ring = __atomic_load_n(&logger->rings[index], __ATOMIC_ACQUIRE);
+
+        if(ring != NULL)
+            number_written += drain_ring(logger, ring);
+    }
+
+    return number_written;
+}
+
+
+static void *async_log_writer_routine(void *async_logger){
+
+    AsyncLogger *logger = (AsyncLogger *)async_logger;
+    struct timespec idle_time;
+
+    apply_thread_role(THREAD_ROLE_BACKGROUND);
+
+    idle_time.tv_sec = 0;
+    idle_time.tv_nsec = ASYNC_LOG_WRITER_IDLE_TIME_IN_MS * NS_EACH_MS;
+
+    while(__atomic_load_n(&logger->shutdown, __ATOMIC_ACQUIRE) == false){
+
+        if(drain_rings(logger) == 0)
+            nanosleep(&idle_time, NULL);
+    }
+
+    /* Messages logged before the logger stopped are not lost */
+    drain_rings(logger);
+
+    return (void *)NULL;
+}
+
+
+int start_async_logger(AsyncLogger *logger, bool is_format_deferred){
+
+    memset(logger, 0, sizeof(AsyncLogger));
+
+    logger->is_format_deferred = is_format_deferred;
+
+    if(pthread_create(&logger->writer_thread, NULL,
+                      async_log_writer_routine, logger) != 0)
+        return -1;
+
+    __atomic_fetch_add(&logger_generation, 1, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&active_logger, logger, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+
+void stop_async_logger(AsyncLogger *logger){
+
+    if(__atomic_load_n(&active_logger, __ATOMIC_ACQUIRE) != logger)
+        return;
+
+    /* Messages logged from now on are written synchronously */
+    __atomic_store_n(&active_logger, NULL, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&logger->shutdown, true, __ATOMIC_RELEASE);
+
+    pthread_join(logger->writer_thread, NULL);
+}
+
+
+void async_zlog(zlog_category_t *category,
+                const char *file, size_t file_len,
+                const char *func, size_t func_len,
+                long line, int level,
+                const char *format, ...){
+
+    AsyncLogger *logger = __atomic_load_n(&active_logger, __ATOMIC_ACQUIRE);
+    AsyncLogRing *ring = NULL;
+    AsyncLogRecord *record;
+    uint64_t tail;
+    va_list args;
+    va_list packed_args;
+
+    if(logger != NULL)
+        ring = get_thread_ring(logger);
+
+    va_start(args, format);
+
+    if(ring == NULL){
+
+        vzlog(category, file, file_len, func, func_len, line, level, format,
+              args);
+
+    }else{
+
+        tail = ring->tail;
+
+        if(tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) >=
+           ASYNC_LOG_RING_LENGTH){
+
+            __atomic_fetch_add(&logger->drop_count, 1, __ATOMIC_RELAXED);
+
+        }else{
+
+            record = &ring->records[tail & (ASYNC_LOG_RING_LENGTH - 1)];
+
+            record->category = category;
+            record->file = file;
+            record->file_len = file_len;
+            record->func = func;
+            record->func_len = func_len;
+            record->line = line;
+            record->level = level;
+            record->format = NULL;
+
+            if(logger->is_format_deferred == true){
+
+                va_copy(packed_args, args);
+                if(pack_arguments(record->message, format, &packed_args) == 
+                   true)
+                    record->format = format;
+                va_end(packed_args);
+            }
+
+            if(record->format == NULL)
+                vsnprintf(record->message, sizeof(record->message), format,
+                          args);
+
+            __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+        }
+    }
+
+    va_end(args);
+}
@@ -0,0 +1,248 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     AsyncLog.h
+
+  File Description:
+
+     This file contains the declarations of the asynchronous logger, which
+     takes the writing of log messages off the threads forwarding packets.
+     Each thread formats its messages into its own ring, and a writer
+     thread drains the rings into zlog. When the ring of a thread is full,
+     the message is dropped and counted instead of waiting, so that
+     logging never stalls the thread. Until the logger is started, and
+     after it is stopped, messages are written by zlog synchronously.
+
+     With the format deferred, a thread only copies the arguments of a
+     message into its ring, and the writer thread formats them. Messages
+     below ASYNC_LOG_MINIMAL_LEVEL are removed at compile time.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+#include "Clock.h"
+#include "ThreadProfile.h"
+#include "zlog.h"
+
+/* The number of messages in the ring of each thread. It must be a power of
+   2. */
+#define ASYNC_LOG_RING_LENGTH 128
+
+/* The maximal length of a message, longer messages are truncated */
+#define ASYNC_LOG_MESSAGE_LENGTH 1024
+
+/* The maximal number of threads which log asynchronously. Messages of
+   further threads are written synchronously. */
+#define MAX_ASYNC_LOG_THREADS 64
+
+/* The time in milliseconds for the writer thread to sleep when every ring
+   is empty */
+#define ASYNC_LOG_WRITER_IDLE_TIME_IN_MS 10
+
+/* The lowest zlog level of the messages compiled into the program. For
+   example, -DASYNC_LOG_MINIMAL_LEVEL=40 removes the async_zlog_debug 
+   calls, including the evaluation of their arguments. */
+#ifndef ASYNC_LOG_MINIMAL_LEVEL
+#define ASYNC_LOG_MINIMAL_LEVEL 0
+#endif
+
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+
+/* A message waiting in a ring, with the place in the code it was logged */
+typedef struct {
+
+    zlog_category_t *category;
+
+    const char *file;
+    size_t file_len;
+
+    const char *func;
+    size_t func_len;
+
+    long line;
+
+    int level;
+
+    /* The format of the message if its arguments are packed in message, or
+       NULL if message is the formatted text */
+    const char *format;
+
+    char message[ASYNC_LOG_MESSAGE_LENGTH];
+
+} AsyncLogRecord;
+
+/* The ring of a thread. The thread is the only producer and the writer
+   thread the only consumer. */
+typedef struct {
+
+    /* The number of messages taken by the writer thread */
+    uint64_t head __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    /* The number of messages added by the thread */
+    uint64_t tail __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    AsyncLogRecord records[ASYNC_LOG_RING_LENGTH]
+        __attribute__((aligned(CACHE_LINE_SIZE)));
+
+} AsyncLogRing;
+
+typedef struct {
+
+    /* The flag set to true when the writer thread needs to stop */
+    bool shutdown;
+
+    /* A flag indicating whether messages are formatted by the writer 
+       thread instead of the threads logging them */
+    bool is_format_deferred;
+
+    pthread_t writer_thread;
+
+    /* The rings of the threads which have logged, added by the threads
+       themselves */
+    AsyncLogRing *rings[MAX_ASYNC_LOG_THREADS];
+
+    int number_rings;
+
+    /* The number of messages written to zlog by the writer thread */
+    uint64_t written_count;
+
+    /* The number of messages dropped because the ring of the thread was
+       full */
+    uint64_t drop_count;
+
+} AsyncLogger;
+
+
+/* The macros logging like zlog_fatal ... zlog_debug, through the logger
+   when it is started. The format must be a string literal, because the
+   writer thread reads it after the call returns. */
+#define ASYNC_ZLOG_AT_LEVEL(cat, level, ...) \
+    do{ \
+        if((level) >= ASYNC_LOG_MINIMAL_LEVEL) \
+            async_zlog(cat, __FILE__, sizeof(__FILE__) - 1, __func__, \
+                       sizeof(__func__) - 1, __LINE__, level, __VA_ARGS__); \
+    }while(0)
+
+#define async_zlog_fatal(cat, ...) \
+    ASYNC_ZLOG_AT_LEVEL(cat, ZLOG_LEVEL_FATAL, __VA_ARGS__)
+#define async_zlog_error(cat, ...) \
+    ASYNC_ZLOG_AT_LEVEL(cat, ZLOG_LEVEL_ERROR, __VA_ARGS__)
+#define async_zlog_warn(cat, ...) \
+    ASYNC_ZLOG_AT_LEVEL(cat, ZLOG_LEVEL_WARN, __VA_ARGS__)
+#define async_zlog_notice(cat, ...) \
+    ASYNC_ZLOG_AT_LEVEL(cat, ZLOG_LEVEL_NOTICE, __VA_ARGS__)
+#define async_zlog_info(cat, ...) \
+    ASYNC_ZLOG_AT_LEVEL(cat, ZLOG_LEVEL_INFO, __VA_ARGS__)
+#define async_zlog_debug(cat, ...) \
+    ASYNC_ZLOG_AT_LEVEL(cat, ZLOG_LEVEL_DEBUG, __VA_ARGS__)
+
+
+/*
+  start_async_logger:
+
+     This function initializes the logger and starts its writer thread. From
+     then on, messages logged by async_zlog are written by the writer
+     thread.
+
+  Parameters:
+
+     logger - A pointer to the logger.
+     is_format_deferred - A flag indicating whether the arguments of the
+                          messages are copied, and formatted by the writer
+                          thread. Messages with conversions which cannot
+                          be copied, such as %n and %ls, or with more
+                          arguments than a record holds, are formatted
+                          by the threads logging them.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the writer thread cannot be started.
+ */
+int start_async_logger(AsyncLogger *logger, bool is_format_deferred);
+
+/*
+  stop_async_logger:
+
+     This function stops the writer thread after it writes every message
+     left in the rings. From then on, messages are written synchronously.
+
+  Parameters:
+
+     logger - A pointer to the logger.
+
+  Return value:
+
+     None
+ */
+void stop_async_logger(AsyncLogger *logger);
+
+/*
+  async_zlog:
+
+     This function logs a message like zlog. When the logger is started, the
+     message, or its arguments if the format is deferred, is put into the
+     ring of the calling thread, or dropped if the ring is full.
+
+  Parameters:
+
+     category - The zlog category.
+     file - The name of the source file.
+     file_len - The length of the name of the source file.
+     func - The name of the function.
+     func_len - The length of the name of the function.
+     line - The line in the source file.
+     level - The zlog level.
+     format - The format of the message, followed by its arguments.
+
+  Return value:
+
+     None
+ */
+void async_zlog(zlog_category_t *category,
+                const char *file, size_t file_len,
+                const char *func, size_t func_len,
+                long line, int level,
+                const char *format, ...)
+                __attribute__((format(printf, 8, 9)));
+
+#endif
@@ -100,6 +100,19 @@ void init_Address_Map(AddressMapArray *address_map)
 
     for(n = 0; n < MAX_NUMBER_NODES; n ++)
         address_map -> in_use[n] = false;
+
+    /* The first dump always happens */
+    address_map -> generation = 1;
+    address_map -> dumped_generation = 0;
+
+    memset(address_map -> journal, 0, sizeof(address_map -> journal));
+
+    init_entry( &address_map -> expiry_list_head);
+    for(n = 0; n < MAX_NUMBER_NODES; n ++)
+        init_entry( &address_map -> expiry_list_entries[n]);
+
+    address_map -> eviction_function = NULL;
+    address_map -> eviction_arg = NULL;
 }
 
 
@@ -128,12 +141,12 @@ int is_in_Address_Map(AddressMapArray *address_map,
                 strncmp(address_map -> address_map_list[n].uuid, 
                 identifer, LENGTH_OF_UUID) == 0)
             {
-                zlog_debug(category_debug,
-                            "uuid matached n=%d [%s] [%s] [%d]\n", 
-                            n, 
-                            address_map->address_map_list[n].uuid, 
-                            identifer, 
-                            LENGTH_OF_UUID);
+                async_zlog_debug(category_debug,
+                                 "uuid matached n=%d [%s] [%s] [%d]\n", 
+                                 n, 
+                                 address_map->address_map_list[n].uuid, 
+                                 identifer, 
+                                 LENGTH_OF_UUID);
                     return n;
                    
             }
@@ -142,6 +155,32 @@ int is_in_Address_Map(AddressMapArray *address_map,
     return -1;
 }
 
+/* Increases the generation of the AddressMap and records the change */
+static void record_change_in_Address_Map(AddressMapArray *address_map,
+                                         char *uuid,
+                                         bool is_removed)
+{
+    AddressMapChange *change = NULL;
+
+    address_map -> generation ++;
+
+    change = &address_map -> journal[address_map -> generation % 
+                                     ADDRESS_MAP_JOURNAL_LENGTH];
+    change -> generation = address_map -> generation;
+    change -> is_removed = is_removed;
+    memset(change -> uuid, 0, LENGTH_OF_UUID);
+    strncpy(change -> uuid, uuid, LENGTH_OF_UUID - 1);
+}
+
+/* Moves the entry which has just reported to the end of the expiry order */
+static void touch_entry_in_Address_Map(AddressMapArray *address_map, 
+                                       int index)
+{
+    remove_list_node( &address_map -> expiry_list_entries[index]);
+    insert_list_tail( &address_map -> expiry_list_entries[index],
+                      &address_map -> expiry_list_head);
+}
+
 ErrorCode update_entry_in_Address_Map(AddressMapArray *address_map,
                                       int index,
                                       AddressMapType type,
@@ -151,8 +190,19 @@ ErrorCode update_entry_in_Address_Map(AddressMapArray *address_map,
 {
     int current_time = get_system_time();
 
+    /* The membership changes when the entry is newly occupied or moves to
+       another network address */
+    if(address_map -> in_use[index] == false ||
+       strncmp(address_map -> address_map_list[index].net_address, address,
+               NETWORK_ADDR_LENGTH) != 0)
+        record_change_in_Address_Map(address_map, 
+                                     (uuid != NULL) ? uuid : address, 
+                                     false);
+
     address_map -> in_use[index] = true;
     address_map -> last_reported_timestamp[index] = current_time;
+    address_map -> last_reported_time_in_ns[index] = get_clock_time_in_ns();
+    touch_entry_in_Address_Map(address_map, index);
     memset(address_map->address_map_list[index].API_version, 0,
            LENGTH_OF_API_VERSION);
     strncpy(address_map->address_map_list[index].API_version, 
@@ -190,14 +240,21 @@ ErrorCode update_report_timestamp_in_Address_Map(AddressMapArray *address_map,
     int index = -1;
     int current_time = get_system_time();
 
+    pthread_mutex_lock( &address_map -> list_lock);
+
     index = is_in_Address_Map(address_map, type, identifer);
 
     if(index != -1){
         
         address_map -> last_reported_timestamp[index] = current_time;
+        address_map -> last_reported_time_in_ns[index] = 
+            get_clock_time_in_ns();
+        touch_entry_in_Address_Map(address_map, index);
 
     }
 
+    pthread_mutex_unlock( &address_map -> list_lock);
+
     return WORK_SUCCESSFULLY;
 
 }
@@ -206,23 +263,129 @@ ErrorCode release_not_used_entry_from_Address_Map(AddressMapArray *address_map,
                                                   int tolerance_duration)
 {
     int i;
-    int current_time = get_system_time();
+    List_Entry *first = NULL;
+    uint64_t current_time;
+    uint64_t tolerance_duration_in_ns = 
+        (uint64_t)tolerance_duration * NS_EACH_SECOND;
+
+    pthread_mutex_lock( &address_map -> list_lock);
+
+    /* Read after the lock is taken, so that no entry is reported later than
+       current_time and the subtraction below cannot wrap around */
+    current_time = get_clock_time_in_ns();
+
+    /* The entries are in the order of their deadlines, so the scan stops at
+       the first entry not expired */
+    while(is_entry_list_empty( &address_map -> expiry_list_head) == false)
+    {
+        first = address_map -> expiry_list_head.next;
+        i = first - address_map -> expiry_list_entries;
+
+        if(current_time - address_map ->last_reported_time_in_ns[i] <= 
+           tolerance_duration_in_ns)
+            break;
+
+        remove_list_node(first);
+
+        address_map -> in_use[i] = false;
+        record_change_in_Address_Map(
+            address_map, address_map->address_map_list[i].uuid, true);
+        printf("release index [%d], net_address [%s], uuid [%s]\n",
+               i, 
+               address_map->address_map_list[i].net_address, 
+               address_map->address_map_list[i].uuid);
+
+        if(address_map -> eviction_function != NULL)
+            address_map -> eviction_function(
+                &address_map -> address_map_list[i],
+                address_map -> eviction_arg);
+    }
+
+    pthread_mutex_unlock( &address_map -> list_lock);
+
+    return WORK_SUCCESSFULLY;
+}
+
+int get_next_expiry_in_ms_from_Address_Map(AddressMapArray *address_map,
+                                           int tolerance_duration)
+{
+    int i;
+    uint64_t current_time;
+    uint64_t deadline;
+    int next_expiry_in_ms = tolerance_duration * 1000;
+
+    pthread_mutex_lock( &address_map -> list_lock);
+
+    if(is_entry_list_empty( &address_map -> expiry_list_head) == false)
+    {
+        i = address_map -> expiry_list_head.next - 
+            address_map -> expiry_list_entries;
+
+        current_time = get_clock_time_in_ns();
+        deadline = address_map -> last_reported_time_in_ns[i] + 
+                   (uint64_t)tolerance_duration * NS_EACH_SECOND;
+
+        /* Round up so that the entry has expired when the time comes */
+        if(deadline < current_time)
+            next_expiry_in_ms = 0;
+        else
+            next_expiry_in_ms = 
+                (int)((deadline - current_time) / NS_EACH_MS) + 1;
+    }
+
+    pthread_mutex_unlock( &address_map -> list_lock);
+
+    return next_expiry_in_ms;
+}
+
+void set_eviction_function_of_Address_Map(AddressMapArray *address_map,
+                                          AddressMapEvictionFunction function,
+                                          void *arg)
+{
+    pthread_mutex_lock( &address_map -> list_lock);
+
+    address_map -> eviction_function = function;
+    address_map -> eviction_arg = arg;
+
+    pthread_mutex_unlock( &address_map -> list_lock);
+}
+
+/* Copies the network addresses of the active entries. Returns the number of
+   entries copied and the generation of the AddressMap. */
+static int collect_active_entries(AddressMapArray *address_map,
+                                  int tolerance_duration,
+                                  char net_address[][NETWORK_ADDR_LENGTH],
+                                  uint64_t *generation)
+{
+    int i;
+    int number_entries = 0;
+    uint64_t current_time;
+    uint64_t tolerance_duration_in_ns = 
+        (uint64_t)tolerance_duration * NS_EACH_SECOND;
+
+    pthread_mutex_lock( &address_map -> list_lock);
+
+    /* Read under the lock, as in release_not_used_entry_from_Address_Map */
+    current_time = get_clock_time_in_ns();
 
     for(i = 0;i < MAX_NUMBER_NODES;i ++)
     {
         if (address_map -> in_use[i] == true && 
-            (current_time - address_map ->last_reported_timestamp[i] > 
-             tolerance_duration)){
-
-            address_map -> in_use[i] = false;
-            printf("release index [%d], net_address [%s], uuid [%s]\n",
-                   i, 
-                   address_map->address_map_list[i].net_address, 
-                   address_map->address_map_list[i].uuid);
+            (current_time - address_map ->last_reported_time_in_ns[i] < 
+             tolerance_duration_in_ns)){
+
+            memcpy(net_address[number_entries], 
+                   address_map->address_map_list[i].net_address,
+                   NETWORK_ADDR_LENGTH);
+            number_entries ++;
         }
     }
 
-    return WORK_SUCCESSFULLY;
+    *generation = address_map -> generation;
+
+    pthread_mutex_unlock( &address_map -> list_lock);
+
+    return number_entries;
 }
 
 ErrorCode dump_ip_of_active_entry_from_Address_Map(char *filename,
@@ -230,14 +393,28 @@ ErrorCode dump_ip_of_active_entry_from_Address_Map(char *filename,
                                                    int tolerance_duration){
                                                        
     int i;
-    int current_time = get_system_time();
+    int number_entries;
+    uint64_t generation;
+    char net_address[MAX_NUMBER_NODES][NETWORK_ADDR_LENGTH];
+    char temp_filename[CONFIG_BUFFER_SIZE];
     int retry_times = 0;
     FILE *active_file = NULL;
+
+    /* Skip the dump when the membership has not changed and the file is 
+       still there */
+    if(address_map -> dumped_generation == address_map -> generation &&
+       access(filename, F_OK) == 0)
+        return WORK_SUCCESSFULLY;
+
+    number_entries = collect_active_entries(address_map, tolerance_duration,
+                                            net_address, &generation);
+
+    snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
     
     retry_times = FILE_OPEN_RETRY;
     while(retry_times--){
         active_file =
-        fopen(filename, "w");
+        fopen(temp_filename, "w");
 
         if(NULL != active_file){
             break;
@@ -247,22 +424,309 @@ ErrorCode dump_ip_of_active_entry_from_Address_Map(char *filename,
     if(NULL == active_file)
         return E_OPEN_FILE;
     
-    for(i = 0;i < MAX_NUMBER_NODES;i ++)
+    for(i = 0;i < number_entries;i ++)
     {
-        if (address_map -> in_use[i] == true && 
-            (current_time - address_map ->last_reported_timestamp[i] < 
-             tolerance_duration)){
-
-            fprintf(active_file, "%s\n", 
-                    address_map->address_map_list[i].net_address);
-        }
+        fprintf(active_file, "%s\n", net_address[i]);
     }
     
     fclose(active_file);
+
+    if(rename(temp_filename, filename) != 0)
+        return E_OPEN_FILE;
+
+    address_map -> dumped_generation = generation;
     
     return WORK_SUCCESSFULLY;                                                      
 }
 
+ErrorCode save_Address_Map(char *filename, AddressMapArray *address_map)
+{
+    int i;
+    AddressMapCheckpointHeader header;
+    AddressMapCheckpointEntry entries[MAX_NUMBER_NODES];
+    char temp_filename[CONFIG_BUFFER_SIZE];
+    int retry_times = 0;
+    FILE *checkpoint_file = NULL;
+    size_t written;
+
+    header.magic = ADDRESS_MAP_CHECKPOINT_MAGIC;
+    header.version = ADDRESS_MAP_CHECKPOINT_VERSION;
+    header.entry_size = sizeof(AddressMapCheckpointEntry);
+    header.number_entries = 0;
+
+    memset(entries, 0, sizeof(entries));
+
+    pthread_mutex_lock( &address_map -> list_lock);
+
+    for(i = 0;i < MAX_NUMBER_NODES;i ++)
+    {
+        if(address_map -> in_use[i] == true){
+
+            entries[header.number_entries].address_map = 
+                address_map -> address_map_list[i];
+            entries[header.number_entries].last_reported_timestamp = 
+                address_map -> last_reported_timestamp[i];
+            header.number_entries ++;
+        }
+    }
+
+    pthread_mutex_unlock( &address_map -> list_lock);
+
+    snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+
+    retry_times = FILE_OPEN_RETRY;
+    while(retry_times--){
+        checkpoint_file = fopen(temp_filename, "wb");
+
+        if(NULL != checkpoint_file){
+            break;
+        }
+    }
+
+    if(NULL == checkpoint_file)
+        return E_OPEN_FILE;
+
+    written = fwrite(&header, sizeof(header), 1, checkpoint_file);
+    written += fwrite(entries, sizeof(AddressMapCheckpointEntry), 
+                      header.number_entries, checkpoint_file);
+
+    fclose(checkpoint_file);
+
+    if(written != 1 + header.number_entries){
+        remove(temp_filename);
+        return E_OPEN_FILE;
+    }
+
+    if(rename(temp_filename, filename) != 0)
+        return E_OPEN_FILE;
+
+    return WORK_SUCCESSFULLY;
+}
+
+int load_Address_Map(char *filename, 
+                     AddressMapArray *address_map,
+                     int tolerance_duration)
+{
+    int i;
+    int index = 0;
+    AddressMapCheckpointHeader header;
+    AddressMapCheckpointEntry entry;
+    FILE *checkpoint_file = NULL;
+    int current_time = get_system_time();
+    uint64_t current_time_in_ns = get_clock_time_in_ns();
+    uint64_t age_in_ns;
+    List_Entry *position = NULL;
+
+    checkpoint_file = fopen(filename, "rb");
+    if(NULL == checkpoint_file)
+        return -1;
+
+    if(fread(&header, sizeof(header), 1, checkpoint_file) != 1 ||
+       header.magic != ADDRESS_MAP_CHECKPOINT_MAGIC ||
+       header.version != ADDRESS_MAP_CHECKPOINT_VERSION ||
+       header.entry_size != sizeof(AddressMapCheckpointEntry) ||
+       header.number_entries < 0 ||
+       header.number_entries > MAX_NUMBER_NODES){
+
+        fclose(checkpoint_file);
+        return -1;
+    }
+
+    pthread_mutex_lock( &address_map -> list_lock);
+
+    for(i = 0;i < header.number_entries;i ++)
+    {
+        if(fread(&entry, sizeof(entry), 1, checkpoint_file) != 1)
+            break;
+
+        /* Entries reported in the future are from a clock change and are 
+           not trusted either */
+        if(current_time - entry.last_reported_timestamp >= 
+           tolerance_duration ||
+           current_time < entry.last_reported_timestamp)
+            continue;
+
+        /* Strings in the file are not trusted to be terminated */
+        entry.address_map.uuid[LENGTH_OF_UUID - 1] = '\0';
+        entry.address_map.net_address[NETWORK_ADDR_LENGTH - 1] = '\0';
+        entry.address_map.API_version[LENGTH_OF_API_VERSION - 1] = '\0';
+
+        address_map -> address_map_list[index] = entry.address_map;
+        address_map -> in_use[index] = true;
+        address_map -> last_reported_timestamp[index] = 
+            entry.last_reported_timestamp;
+
+        /* The monotonic clock restarts at boot, so the age may exceed it */
+        age_in_ns = (uint64_t)(current_time - entry.last_reported_timestamp) *
+                    NS_EACH_SECOND;
+        address_map -> last_reported_time_in_ns[index] = 
+            (age_in_ns < current_time_in_ns) ? 
+            current_time_in_ns - age_in_ns : 0;
+
+        /* The checkpoint is not in the expiry order, so the entry is 
+           inserted after the last entry which reported earlier */
+        position = address_map -> expiry_list_head.prev;
+        while(position != &address_map -> expiry_list_head &&
+              address_map -> last_reported_time_in_ns[
+                  position - address_map -> expiry_list_entries] >
+              address_map -> last_reported_time_in_ns[index])
+            position = position -> prev;
+
+        remove_list_node( &address_map -> expiry_list_entries[index]);
+        insert_entry_list( &address_map -> expiry_list_entries[index],
+                           position, position -> next);
+
+        index ++;
+    }
+
+    address_map -> generation ++;
+
+    pthread_mutex_unlock( &address_map -> list_lock);
+
+    fclose(checkpoint_file);
+
+    return index;
+}
+
+ActiveEntrySnapshot *open_active_entry_snapshot(char *shm_name)
+{
+    int shm_fd;
+    ActiveEntrySnapshot *snapshot = NULL;
+
+    shm_fd = shm_open(shm_name, O_CREAT | O_RDWR, 0644);
+    if(shm_fd == -1)
+        return NULL;
+
+    if(ftruncate(shm_fd, sizeof(ActiveEntrySnapshot)) == -1){
+        close(shm_fd);
+        return NULL;
+    }
+
+    snapshot = mmap(NULL, sizeof(ActiveEntrySnapshot), 
+                    PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+
+    /* The mapping stays valid after the descriptor is closed */
+    close(shm_fd);
+
+    if(snapshot == MAP_FAILED)
+        return NULL;
+
+    /* The snapshot left by a previous run is rewritten at the first dump */
+    snapshot -> generation = 0;
+
+    return snapshot;
+}
+
+ErrorCode dump_ip_of_active_entry_to_snapshot(ActiveEntrySnapshot *snapshot,
+                                              AddressMapArray *address_map,
+                                              int tolerance_duration)
+{
+    int number_entries;
+    uint64_t generation;
+    char net_address[MAX_NUMBER_NODES][NETWORK_ADDR_LENGTH];
+
+    if(snapshot -> generation == address_map -> generation)
+        return WORK_SUCCESSFULLY;
+
+    number_entries = collect_active_entries(address_map, tolerance_duration,
+                                            net_address, &generation);
+
+    /* Make the sequence odd before writing and even again after writing */
+    __atomic_fetch_add(&snapshot -> sequence, 1, __ATOMIC_ACQ_REL);
+
+    memcpy(snapshot -> net_address, net_address, 
+           number_entries * NETWORK_ADDR_LENGTH);
+    snapshot -> number_entries = number_entries;
+    snapshot -> generation = generation;
+
+    __atomic_fetch_add(&snapshot -> sequence, 1, __ATOMIC_RELEASE);
+
+    return WORK_SUCCESSFULLY;
+}
+
+double get_buffer_list_length_metric(void *buffer_list_head){
+
+    BufferListHead *list_head = (BufferListHead *)buffer_list_head;
+    int length;
+
+    pthread_mutex_lock( &list_head -> list_lock);
+    length = get_list_length( &list_head -> list_head);
+    pthread_mutex_unlock( &list_head -> list_lock);
+
+    return (double)length;
+}
+
+double get_pkt_queue_length_metric(void *pkt_queue){
+
+    /* The length is read from the counters of the queue without its lock */
+    return (double)queue_len((pkt_ptr)pkt_queue);
+}
+
+double get_mempool_used_slots_metric(void *mempool){
+
+    Memory_Pool *mp = (Memory_Pool *)mempool;
+    int used_slots;
+
+    pthread_mutex_lock( &mp -> mem_lock);
+    used_slots = mp -> used_slots;
+    pthread_mutex_unlock( &mp -> mem_lock);
+
+    return (double)used_slots;
+}
+
+double get_mempool_capacity_metric(void *mempool){
+
+    Memory_Pool *mp = (Memory_Pool *)mempool;
+    int capacity;
+
+    pthread_mutex_lock( &mp -> mem_lock);
+    capacity = mp -> alloc_time * mp -> slots;
+    pthread_mutex_unlock( &mp -> mem_lock);
+
+    return (double)capacity;
+}
+
+double get_thpool_working_threads_metric(void *threadpool){
+
+    Threadpool pool = *(Threadpool *)threadpool;
+
+    if(pool == NULL)
+        return 0;
+
+    return (double)thpool_num_threads_working(pool);
+}
+
+double get_thpool_job_queue_length_metric(void *threadpool){
+
+    Threadpool pool = *(Threadpool *)threadpool;
+    int length;
+
+    if(pool == NULL)
+        return 0;
+
+    pthread_mutex_lock( &pool -> jobqueue.rwmutex);
+    length = pool -> jobqueue.len;
+    pthread_mutex_unlock( &pool -> jobqueue.rwmutex);
+
+    return (double)length;
+}
+
+double get_address_map_size_metric(void *address_map){
+
+    AddressMapArray *map = (AddressMapArray *)address_map;
+    int number_entries = 0;
+    int n;
+
+    pthread_mutex_lock( &map -> list_lock);
+    for(n = 0; n < MAX_NUMBER_NODES; n ++){
+        if(map -> in_use[n] == true)
+            number_entries ++;
+    }
+    pthread_mutex_unlock( &map -> list_lock);
+
+    return (double)number_entries;
+}
+
 void *sort_priority_list(CommonConfig *common_config, BufferListHead *list_head){
 
     List_Entry *list_pointer,
@@ -340,7 +804,11 @@ void *CommUnit_routine()
 
     int uptime;
 
-    Threadpool thpool;
+    /* The uptime in nanoseconds of the current iteration */
+    uint64_t uptime_in_ns;
+
+    /* The age in nanoseconds after which a packet is out of date */
+    uint64_t max_age_in_ns;
 
     int return_error_value;
 
@@ -357,6 +825,8 @@ void *CommUnit_routine()
     /* The pointer to the current buffer list head */
     BufferListHead *current_head;
 
+    apply_thread_role(THREAD_ROLE_DISPATCH);
+
     /* wait for NSI get ready */
     while(NSI_initialization_complete == false)
     {
@@ -377,7 +847,11 @@ void *CommUnit_routine()
     zlog_info(category_debug, "[CommUnit] thread pool Initialized");
 #endif
 
-    uptime = get_clock_time();
+    max_age_in_ns = (uint64_t)common_config.min_age_out_of_date_packet_in_sec *
+                    NS_EACH_SECOND;
+
+    uptime_in_ns = refresh_cached_clock_time();
+    uptime = (int)(uptime_in_ns / NS_EACH_SECOND);
 
     /* Set the initial time. */
     init_time = uptime;
@@ -389,7 +863,8 @@ void *CommUnit_routine()
     /* When there is no dead thead, continue to work. */
     while(ready_to_work == true)
     {
-        uptime = get_clock_time();
+        uptime_in_ns = refresh_cached_clock_time();
+        uptime = (int)(uptime_in_ns / NS_EACH_SECOND);
 
         /* In the normal situation, the scanning starts from the high priority
            to lower priority. When the timer expired for MAX_STARVATION_TIME,
@@ -430,12 +905,21 @@ void *CommUnit_routine()
                     current_node = ListEntry(list_entry, BufferNode,
                                              buffer_entry);
 
-                    if(uptime - current_node->uptime_at_receive > 
-                       common_config.min_age_out_of_date_packet_in_sec){
+                    /* The node may be received after the cached uptime was
+                       refreshed, so it is aged out only when it is older */
+                    if(uptime_in_ns > current_node->receive_time_in_ns &&
+                       uptime_in_ns - current_node->receive_time_in_ns >
+                       max_age_in_ns){
 
+                       metric_counter_add(&aged_out_packet_count, 1);
                        mp_free(&node_mempool, current_node);
                        continue;
                     } 
+                    /* The node may be enqueued after the cached clock was
+                       refreshed, so the dispatch time is read live */
+                    current_node->dispatch_time_in_ns = 
+                        get_clock_time_in_ns();
+
                     /* Have a worker thread execute the function specified by the 
                     function pointer to do the work */
                     return_error_value = thpool_add_work(thpool,
@@ -447,7 +931,8 @@ void *CommUnit_routine()
                     break;
                 }
             }
-            uptime = get_clock_time();
+            uptime_in_ns = refresh_cached_clock_time();
+            uptime = (int)(uptime_in_ns / NS_EACH_SECOND);
             pthread_mutex_unlock( &priority_list_head.list_lock);
             
             if(did_work == false){
@@ -496,6 +981,9 @@ void *CommUnit_routine()
                 current_node = ListEntry(list_entry, BufferNode,
                                              buffer_entry);
 
+                current_node->dispatch_time_in_ns = 
+                    get_clock_time_in_ns();
+
                 return_error_value = thpool_add_work(thpool,
                                                      current_head -> function,
                                                      current_node,
@@ -532,6 +1020,9 @@ void *CommUnit_routine()
                 current_node = ListEntry(list_entry, BufferNode,
                                          buffer_entry);
 
+                current_node->dispatch_time_in_ns = 
+                    get_clock_time_in_ns();
+
                 /* Call the function pointed to by the function pointer to do 
                    the work */
                 return_error_value = thpool_add_work(thpool,
@@ -560,6 +1051,7 @@ void *CommUnit_routine()
     
     /* Destroy the thread pool */
     thpool_destroy(thpool);
+    thpool = NULL;
 
     return (void *)NULL;
 }
@@ -597,6 +1089,197 @@ void fetch_next_string(FILE *file, char *message, size_t message_size)
     strcpy(message, config_message);
 }
 
+/* Store the text of a value into the variable of its key. It returns false
+   if the value is malformed or out of range. */
+static bool set_config_value(ConfigEntry *entry, const char *value)
+{
+    char *end = NULL;
+    long integer_value;
+    double double_value;
+
+    switch(entry -> type){
+
+        case CONFIG_VALUE_INT:
+        case CONFIG_VALUE_BOOL:
+
+            errno = 0;
+            integer_value = strtol(value, &end, 10);
+            if(end == value || *end != '\0' || errno != 0 ||
+               integer_value < entry -> minimal_value ||
+               integer_value > entry -> maximal_value)
+                return false;
+
+            if(entry -> type == CONFIG_VALUE_BOOL)
+                *(bool *)entry -> value = (integer_value != 0);
+            else
+                *(int *)entry -> value = (int)integer_value;
+            return true;
+
+        case CONFIG_VALUE_DOUBLE:
+
+            errno = 0;
+            double_value = strtod(value, &end);
+            if(end == value || *end != '\0' || errno != 0 ||
+               !(double_value >= entry -> minimal_value &&
+                 double_value <= entry -> maximal_value))
+                return false;
+
+            *(double *)entry -> value = double_value;
+            return true;
+
+        case CONFIG_VALUE_STRING:
+
+            if(strlen(value) >= entry -> size)
+                return false;
+
+            memset(entry -> value, 0, entry -> size);
+            memcpy(entry -> value, value, strlen(value));
+            return true;
+
+        default:
+
+            return true;
+    }
+}
+
+ErrorCode load_config_file(char *file_name,
+                           ConfigEntry *entries,
+                           int number_entries)
+{
+    FILE *file = NULL;
+    char *content = NULL;
+    char *line = NULL;
+    char *next_line = NULL;
+    char *value = NULL;
+    long file_size = 0;
+    int line_number = 0;
+    int i = 0;
+    ErrorCode return_value = WORK_SUCCESSFULLY;
+
+    for(i = 0; i < number_entries; i++){
+
+        entries[i].is_found = false;
+
+        if(entries[i].default_value != NULL &&
+           set_config_value(&entries[i], entries[i].default_value) == false){
+
+            zlog_error(category_health_report,
+                       "Invalid default value [%s] of config key [%s]",
+                       entries[i].default_value, entries[i].key);
+            return E_INPUT_PARAMETER;
+        }
+    }
+
+    file = fopen(file_name, "r");
+    if(file == NULL)
+        return E_OPEN_FILE;
+
+    /* The file is read at once and its lines are parsed in place */
+    if(fseek(file, 0, SEEK_END) != 0 || (file_size = ftell(file)) < 0 ||
+       fseek(file, 0, SEEK_SET) != 0){
+
+        fclose(file);
+        return E_OPEN_FILE;
+    }
+
+    content = malloc(file_size + 1);
+    if(content == NULL){
+
+        fclose(file);
+        return E_MALLOC;
+    }
+
+    file_size = fread(content, 1, file_size, file);
+    content[file_size] = '\0';
+
+    fclose(file);
+
+    for(line = content; line != NULL; line = next_line){
+
+        line_number++;
+
+        next_line = strchr(line, '\n');
+        if(next_line != NULL){
+            *next_line = '\0';
+            next_line++;
+        }
+
+        trim_string_tail(line);
+        while(*line == ' ' || *line == '\t')
+            line++;
+
+        if(*line == '\0' || *line == '#')
+            continue;
+
+        value = strstr(line, DELIMITER);
+        if(value == NULL){
+
+            zlog_error(category_health_report,
+                       "Line [%d] of config file [%s] has no value",
+                       line_number, file_name);
+            continue;
+        }
+
+        *value = '\0';
+        value = value + strlen(DELIMITER);
+
+        trim_string_tail(line);
+        while(*value == ' ' || *value == '\t')
+            value++;
+
+        for(i = 0; i < number_entries; i++){
+            if(strcmp(entries[i].key, line) == 0)
+                break;
+        }
+
+        if(i == number_entries){
+
+            zlog_error(category_health_report,
+                       "Unknown config key [%s] in line [%d] of [%s]",
+                       line, line_number, file_name);
+            continue;
+        }
+
+        if(entries[i].is_found == true)
+            zlog_error(category_health_report,
+                       "Config key [%s] is set again in line [%d] of [%s]",
+                       line, line_number, file_name);
+
+        if(set_config_value(&entries[i], value) == false){
+
+            zlog_error(category_health_report,
+                       "Invalid value [%s] of config key [%s] is ignored",
+                       value, line);
+            continue;
+        }
+
+        entries[i].is_found = true;
+    }
+
+    free(content);
+
+    for(i = 0; i < number_entries; i++){
+
+        if(entries[i].is_found == false){
+
+            if(entries[i].default_value == NULL){
+
+                zlog_error(category_health_report,
+                           "Config key [%s] is missing", entries[i].key);
+                return_value = E_INPUT_PARAMETER;
+
+            }else if(entries[i].type != CONFIG_VALUE_IGNORED){
+
+                zlog_info(category_health_report,
+                          "Config key [%s] uses the default value [%s]",
+                          entries[i].key, entries[i].default_value);
+            }
+        }
+    }
+
+    return return_value;
+}
+
 bool is_numeric(char * str_value)
 {
     size_t len = 0;
@@ -700,13 +1383,7 @@ int get_system_time()
 
 int get_clock_time()
 {
-#ifdef _WIN32
-    return GetTickCount() / 1000;
-#elif __unix__
-    struct timespec current_time;
-    clock_gettime(CLOCK_MONOTONIC, &current_time);
-    return current_time.tv_sec;
-#endif
+    return (int)(get_clock_time_in_ns() / NS_EACH_SECOND);
 }
 
 
@@ -79,11 +79,17 @@
 #include <limits.h>
 #include <signal.h>
 #include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include "Common.h"
+#include "Clock.h"
 #include "Mempool.h"
 #include "UDP_API.h"
 #include "LinkedList.h"
+#include "Metrics.h"
 #include "thpool.h"
+#include "ThreadProfile.h"
+#include "AsyncLog.h"
 #include "zlog.h"
 
 
@@ -332,8 +338,20 @@ typedef struct {
     /* The size of the content */
     int content_size;
 
-    /* The uptime at which this buffer is recevied */
-    int uptime_at_receive;
+    /* The uptime in nanoseconds at which this buffer is recevied */
+    uint64_t receive_time_in_ns;
+
+    /* The uptime in nanoseconds at which this buffer is inserted into a 
+       buffer list */
+    uint64_t enqueue_time_in_ns;
+
+    /* The uptime in nanoseconds at which this buffer is handed over to the 
+       thread pool */
+    uint64_t dispatch_time_in_ns;
+
+    /* The uptime in nanoseconds at which a worker thread starts processing 
+       this buffer */
+    uint64_t process_start_time_in_ns;
 
 } BufferNode;
 
@@ -360,6 +378,10 @@ typedef struct {
 
 } BufferListHead;
 
+/* The number of the latest changes of the membership kept in the journal of
+   an AddressMap */
+#define ADDRESS_MAP_JOURNAL_LENGTH 1024
+
 /*  A struct for recording the network address and its last update time */
 typedef struct {
 
@@ -372,6 +394,26 @@ typedef struct {
       
 } AddressMap;
 
+/* The function called when an entry of an AddressMap is released because it
+   has not reported for the tolerant duration. It is called with the lock of
+   the AddressMap held. */
+typedef void (*AddressMapEvictionFunction)(AddressMap *entry, void *arg);
+
+/* A change of the membership of an AddressMap */
+typedef struct {
+
+    /* The generation of the AddressMap after the change */
+    uint64_t generation;
+
+    /* A flag indicating whether the entry is released, otherwise it is 
+       occupied or changes its network address */
+    bool is_removed;
+
+    /* The uuid of the entry changed */
+    char uuid[LENGTH_OF_UUID];
+
+} AddressMapChange;
+
 
 typedef struct {
 
@@ -382,12 +424,93 @@ typedef struct {
        is in use. */
     bool in_use[MAX_NUMBER_NODES];
 
+    /* The system time at which each entry reported most recently. It is
+       reported to the server. */
     int last_reported_timestamp[MAX_NUMBER_NODES];
+
+    /* The uptime in nanoseconds at which each entry reported most recently.
+       It is used to decide whether the entry is still alive, because the
+       system time may jump when it is synchronized. */
+    uint64_t last_reported_time_in_ns[MAX_NUMBER_NODES];
     
     AddressMap address_map_list[MAX_NUMBER_NODES];
 
+    /* The generation of the membership of the AddressMap. It increases when
+       an entry is occupied, released or changes its network address. */
+    uint64_t generation;
+
+    /* The generation dumped to the file by 
+       dump_ip_of_active_entry_from_Address_Map most recently */
+    uint64_t dumped_generation;
+
+    /* The latest changes of the membership. The change to generation g is
+       kept at index g % ADDRESS_MAP_JOURNAL_LENGTH. Changes without an entry
+       in the journal, e.g. restoring from a checkpoint, make the changes 
+       before them unavailable. */
+    AddressMapChange journal[ADDRESS_MAP_JOURNAL_LENGTH];
+
+    /* The entries in use ordered by the time they reported most recently,
+       which is also the order of their deadlines because all entries have
+       the same tolerant duration. The ith list entry belongs to the ith 
+       entry and is isolated when the entry is not in use. */
+    List_Entry expiry_list_head;
+    List_Entry expiry_list_entries[MAX_NUMBER_NODES];
+
+    /* The function called for each entry released, or NULL */
+    AddressMapEvictionFunction eviction_function;
+    void *eviction_arg;
+
 } AddressMapArray;
 
+/* The snapshot of the network addresses of active entries in shared memory,
+   for external tools to read without files */
+typedef struct {
+
+    /* The sequence is odd while the snapshot is being written. Readers copy
+       the snapshot and retry when the sequence is odd or has changed during
+       the copy. */
+    uint32_t sequence;
+
+    /* The generation of the AddressMap of the snapshot */
+    uint64_t generation;
+
+    int number_entries;
+
+    char net_address[MAX_NUMBER_NODES][NETWORK_ADDR_LENGTH];
+
+} ActiveEntrySnapshot;
+
+/* The magic number at the beginning of AddressMap checkpoint files */
+#define ADDRESS_MAP_CHECKPOINT_MAGIC 0x4244414D
+
+/* The version of the format of AddressMap checkpoint files */
+#define ADDRESS_MAP_CHECKPOINT_VERSION 1
+
+/* The header of AddressMap checkpoint files, followed by number_entries 
+   AddressMapCheckpointEntry */
+typedef struct {
+
+    uint32_t magic;
+
+    uint32_t version;
+
+    /* The size in bytes of an entry, to reject files of other builds */
+    uint32_t entry_size;
+
+    int number_entries;
+
+} AddressMapCheckpointHeader;
+
+/* An entry of AddressMap checkpoint files */
+typedef struct {
+
+    AddressMap address_map;
+
+    /* The system time in seconds at which the entry was last reported */
+    int last_reported_timestamp;
+
+} AddressMapCheckpointEntry;
+
 
 typedef struct coordinates{
 
@@ -416,6 +539,72 @@ typedef struct {
 
 } CommonConfig;
 
+/* The types of the values in a config file */
+typedef enum _ConfigValueType {
+
+    CONFIG_VALUE_INT = 0,
+
+    /* A value of 0 or 1, stored in a bool */
+    CONFIG_VALUE_BOOL = 1,
+
+    CONFIG_VALUE_DOUBLE = 2,
+
+    CONFIG_VALUE_STRING = 3,
+
+    /* A key read by other programs, such as the scripts, whose value is
+       not stored */
+    CONFIG_VALUE_IGNORED = 4
+
+} ConfigValueType;
+
+/* A key in a config file, with the place its value is stored in and the
+   value used when the key is missing or its value is invalid */
+typedef struct {
+
+    const char *key;
+
+    ConfigValueType type;
+
+    /* The variable the value is stored in */
+    void *value;
+
+    /* The size in bytes of the character array of a string value */
+    size_t size;
+
+    /* The default value in the text of the config file, or NULL if the key
+       is required */
+    const char *default_value;
+
+    /* The range of an int or double value */
+    double minimal_value;
+    double maximal_value;
+
+    /* A flag indicating whether the key has been read from the file */
+    bool is_found;
+
+} ConfigEntry;
+
+/* The macros for declaring the keys of a config file */
+#define CONFIG_INT(key, variable, default_value, minimal_value, maximal_value) \
+    {key, CONFIG_VALUE_INT, &(variable), sizeof(variable), default_value, \
+     minimal_value, maximal_value, false}
+#define CONFIG_BOOL(key, variable, default_value) \
+    {key, CONFIG_VALUE_BOOL, &(variable), sizeof(variable), default_value, \
+     0, 1, false}
+#define CONFIG_DOUBLE(key, variable, default_value, minimal_value, \
+                      maximal_value) \
+    {key, CONFIG_VALUE_DOUBLE, &(variable), sizeof(variable), default_value, \
+     minimal_value, maximal_value, false}
+#define CONFIG_STRING(key, variable, default_value) \
+    {key, CONFIG_VALUE_STRING, (variable), sizeof(variable), default_value, \
+     0, 0, false}
+#define CONFIG_IGNORED(key) \
+    {key, CONFIG_VALUE_IGNORED, NULL, 0, "", 0, 0, false}
+
+/* The text of the value of a macro, for default values defined by macros */
+#define CONFIG_DEFAULT(macro) CONFIG_DEFAULT_TEXT(macro)
+#define CONFIG_DEFAULT_TEXT(value) #value
+
 typedef struct {
 
     int start_area_index;
@@ -456,6 +645,14 @@ BufferListHead BHM_receive_buffer_list_head;
    order. */
 BufferListHead priority_list_head;
 
+/* The thread pool of the communication unit. It is NULL until 
+   CommUnit_routine initializes it. */
+Threadpool thpool;
+
+/* The number of packets dropped by CommUnit_routine because they are out of 
+   date */
+uint64_t aged_out_packet_count;
+
 
 /* Flags */
 
@@ -621,7 +818,8 @@ ErrorCode update_entry_in_Address_Map(AddressMapArray *address_map,
 /*
   update_report_timestamp_in_Address_Map:
 
-     This function updates the last reported timestamp of the input identifer
+     This function updates the last reported timestamp of the input 
+     identifer and moves the entry to the end of the expiry order.
 
   Parameters:
 
@@ -641,7 +839,9 @@ ErrorCode update_report_timestamp_in_Address_Map(AddressMapArray *address_map,
   release_not_used_entry_from_Address_Map:
 
      This function releases the out-of-date entries on which the 
-     last_reported_timestamp is not updated for long time.
+     last_reported_timestamp is not updated for long time. Only the expired
+     entries at the front of the expiry order are visited, and the eviction
+     function is called for each of them.
 
   Parameters:
 
@@ -655,11 +855,54 @@ ErrorCode update_report_timestamp_in_Address_Map(AddressMapArray *address_map,
  */
 ErrorCode release_not_used_entry_from_Address_Map(AddressMapArray *address_map,
                                                   int tolerance_duration);
+
+/*
+  get_next_expiry_in_ms_from_Address_Map:
+
+     This function returns the time until the earliest entry in use expires.
+
+  Parameters:
+
+     address_map - A pointer to the head of the AddressMap.
+     tolerance_duration - The time period in which we expected the 
+                          last_reported_timestamp to be updated.
+
+  Return value:
+
+     int - The time in milliseconds until the earliest entry expires, or 
+           the tolerant duration in milliseconds if no entry is in use,
+           since entries joining later cannot expire earlier.
+ */
+int get_next_expiry_in_ms_from_Address_Map(AddressMapArray *address_map,
+                                           int tolerance_duration);
+
+/*
+  set_eviction_function_of_Address_Map:
+
+     This function sets the function called for each entry released by 
+     release_not_used_entry_from_Address_Map.
+
+  Parameters:
+
+     address_map - A pointer to the head of the AddressMap.
+     function - The eviction function, or NULL.
+     arg - The argument of the function.
+
+  Return value:
+
+     None
+ */
+void set_eviction_function_of_Address_Map(AddressMapArray *address_map,
+                                          AddressMapEvictionFunction function,
+                                          void *arg);
 /*
   dump_ip_of_active_entry_from_Address_Map:
 
      This function dumps the active entries on which the 
-     last_reported_timestamp is updated within tolerant duration.
+     last_reported_timestamp is updated within tolerant duration. The file
+     is rewritten only when the membership of the AddressMap has changed 
+     since the last dump. It is written to a temporary file which then 
+     replaces the file, so that readers never see a partial file.
 
   Parameters:
 
@@ -675,6 +918,202 @@ ErrorCode release_not_used_entry_from_Address_Map(AddressMapArray *address_map,
 ErrorCode dump_ip_of_active_entry_from_Address_Map(char *filename,
                                                    AddressMapArray *address_map,
                                                    int tolerance_duration);
+
+/*
+  save_Address_Map:
+
+     This function writes the entries in use of the AddressMap to a 
+     checkpoint file. It is written to a temporary file which then replaces
+     the file, so that a crash during the write leaves the previous 
+     checkpoint intact.
+
+  Parameters:
+
+     filename - The name of the checkpoint file.
+     address_map - A pointer to the head of the AddressMap.
+
+  Return value:
+
+     Error_code: The error code for the corresponding error
+ */
+ErrorCode save_Address_Map(char *filename, AddressMapArray *address_map);
+
+/*
+  load_Address_Map:
+
+     This function restores the entries of the AddressMap from a checkpoint
+     file. The entries not reported within the tolerant duration are 
+     dropped.
+
+  Parameters:
+
+     filename - The name of the checkpoint file.
+     address_map - A pointer to the head of the initialized AddressMap.
+     tolerance_duration - The time period in which we expected the 
+                          last_reported_timestamp to be updated.
+
+  Return value:
+
+     int - The number of entries restored, or -1 if the file is missing or
+           invalid.
+ */
+int load_Address_Map(char *filename, 
+                     AddressMapArray *address_map,
+                     int tolerance_duration);
+
+/*
+  open_active_entry_snapshot:
+
+     This function creates or opens the POSIX shared memory object holding
+     the snapshot of active entries and maps it.
+
+  Parameters:
+
+     shm_name - The name of the shared memory object, e.g. "/name".
+
+  Return value:
+
+     ActiveEntrySnapshot * - A pointer to the mapped snapshot, or NULL if 
+                             the shared memory cannot be mapped.
+ */
+ActiveEntrySnapshot *open_active_entry_snapshot(char *shm_name);
+
+/*
+  dump_ip_of_active_entry_to_snapshot:
+
+     This function writes the active entries on which the 
+     last_reported_timestamp is updated within tolerant duration to the 
+     snapshot in shared memory, when the membership of the AddressMap has 
+     changed since the last dump.
+
+  Parameters:
+
+     snapshot - A pointer to the mapped snapshot.
+     address_map - A pointer to the head of the AddressMap.
+     tolerance_duration - The time period in which we expected the 
+                          last_reported_timestamp to be updated.
+
+  Return value:
+
+     Error_code: The error code for the corresponding error
+ */
+ErrorCode dump_ip_of_active_entry_to_snapshot(ActiveEntrySnapshot *snapshot,
+                                              AddressMapArray *address_map,
+                                              int tolerance_duration);
+/*
+  get_buffer_list_length_metric:
+
+     This function is the metric gauge function of the number of buffer 
+     nodes in a buffer list.
+
+  Parameters:
+
+     buffer_list_head - A pointer to the head of the buffer list.
+
+  Return value:
+
+     double - The number of buffer nodes in the list
+ */
+double get_buffer_list_length_metric(void *buffer_list_head);
+
+/*
+  get_pkt_queue_length_metric:
+
+     This function is the metric gauge function of the number of pkts in a 
+     pkt queue.
+
+  Parameters:
+
+     pkt_queue - A pointer to the pkt queue.
+
+  Return value:
+
+     double - The number of pkts in the queue
+ */
+double get_pkt_queue_length_metric(void *pkt_queue);
+
+/*
+  get_mempool_used_slots_metric:
+
+     This function is the metric gauge function of the number of slots in use
+     in a memory pool.
+
+  Parameters:
+
+     mempool - A pointer to the memory pool.
+
+  Return value:
+
+     double - The number of slots in use
+ */
+double get_mempool_used_slots_metric(void *mempool);
+
+/*
+  get_mempool_capacity_metric:
+
+     This function is the metric gauge function of the number of slots 
+     currently allocated by a memory pool.
+
+  Parameters:
+
+     mempool - A pointer to the memory pool.
+
+  Return value:
+
+     double - The number of slots allocated
+ */
+double get_mempool_capacity_metric(void *mempool);
+
+/*
+  get_thpool_working_threads_metric:
+
+     This function is the metric gauge function of the number of worker 
+     threads running a job.
+
+  Parameters:
+
+     threadpool - A pointer to the variable of the thread pool, which may be
+                  NULL before the thread pool is initialized.
+
+  Return value:
+
+     double - The number of working threads
+ */
+double get_thpool_working_threads_metric(void *threadpool);
+
+/*
+  get_thpool_job_queue_length_metric:
+
+     This function is the metric gauge function of the number of jobs 
+     waiting for a worker thread.
+
+  Parameters:
+
+     threadpool - A pointer to the variable of the thread pool, which may be
+                  NULL before the thread pool is initialized.
+
+  Return value:
+
+     double - The number of jobs in the job queue
+ */
+double get_thpool_job_queue_length_metric(void *threadpool);
+
+/*
+  get_address_map_size_metric:
+
+     This function is the metric gauge function of the number of entries in
+     use in an AddressMap.
+
+  Parameters:
+
+     address_map - A pointer to the head of the AddressMap.
+
+  Return value:
+
+     double - The number of entries in use
+ */
+double get_address_map_size_metric(void *address_map);
+
 /*
   sort_priority_list:
 
@@ -748,6 +1187,32 @@ void trim_string_tail(char *message);
  */
 void fetch_next_string(FILE *file, char *message, size_t message_size);
 
+/*
+  load_config_file:
+
+     This function reads a config file of "key=value" lines in any order.
+     Every key first gets its default value. Then each value in the file
+     is checked against the type and range of its key. Empty lines and
+     lines starting with '#' are skipped. Unknown keys, and values which
+     are malformed or out of range, are logged and leave the default
+     value in place.
+
+  Parameters:
+
+     file_name - The name of the config file.
+     entries - The array of the keys of the config file.
+     number_entries - The number of keys in the array.
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY, E_OPEN_FILE if the file cannot be read,
+                 or E_INPUT_PARAMETER if a required key is missing or
+                 invalid.
+ */
+ErrorCode load_config_file(char *file_name,
+                           ConfigEntry *entries,
+                           int number_entries);
+
 /*
   is_numeric:
 
@@ -900,7 +1365,8 @@ int extern get_system_time();
 /*
   get_clock_time:
 
-     This helper function gets the monotonic time.
+     This helper function gets the monotonic time. Use get_clock_time_in_ns 
+     when the resolution of seconds is not enough.
 
   Parameters:
 
@@ -0,0 +1,92 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Clock.c
+
+  File Description:
+
+     This file contains the monotonic time source used in server, gateway and
+     Lbeacon.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "Clock.h"
+
+
+/* The clock time stored by the latest refresh_cached_clock_time. It is read
+   and written with atomic builtins, because 64-bit stores are not atomic on
+   32-bit boards. */
+static uint64_t cached_clock_time_in_ns = 0;
+
+
+uint64_t get_clock_time_in_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * NS_EACH_SECOND +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * NS_EACH_SECOND /
+           frequency.QuadPart;
+#elif __unix__
+    struct timespec current_time;
+
+#ifdef USE_COARSE_MONOTONIC_CLOCK
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &current_time);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &current_time);
+#endif
+
+    return (uint64_t)current_time.tv_sec * NS_EACH_SECOND +
+           (uint64_t)current_time.tv_nsec;
+#endif
+}
+
+
+uint64_t refresh_cached_clock_time(void)
+{
+    uint64_t now = get_clock_time_in_ns();
+
+    __atomic_store_n(&cached_clock_time_in_ns, now, __ATOMIC_RELAXED);
+
+    return now;
+}
+
+
+uint64_t get_cached_clock_time_in_ns(void)
+{
+    uint64_t now = __atomic_load_n(&cached_clock_time_in_ns, __ATOMIC_RELAXED);
+
+    if(now == 0)
+        return refresh_cached_clock_time();
+
+    return now;
+}
@@ -0,0 +1,113 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Clock.h
+
+  File Description:
+
+     This file contains the declarations of the monotonic time source used in
+     server, gateway and Lbeacon.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/* Read CLOCK_MONOTONIC_COARSE instead of CLOCK_MONOTONIC. The coarse clock is
+   served from the vDSO without reading the hardware counter, which is cheaper
+   on ARM boards, but only advances once per scheduler tick (1-10 ms). */
+//#define USE_COARSE_MONOTONIC_CLOCK
+
+/* The number of nanoseconds of each second */
+#define NS_EACH_SECOND 1000000000ULL
+
+/* The number of nanoseconds of each millisecond */
+#define NS_EACH_MS 1000000ULL
+
+/* The number of nanoseconds of each microsecond */
+#define NS_EACH_US 1000ULL
+
+
+/*
+  get_clock_time_in_ns:
+
+     This function reads the monotonic clock.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     uint64_t - uptime of MONOTONIC time in nanoseconds
+ */
+uint64_t get_clock_time_in_ns(void);
+
+/*
+  refresh_cached_clock_time:
+
+     This function reads the monotonic clock and stores the result as the
+     cached clock time. Event loops call this function once per iteration so
+     that the code they run can read the time without a system call.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     uint64_t - uptime of MONOTONIC time in nanoseconds
+ */
+uint64_t refresh_cached_clock_time(void);
+
+/*
+  get_cached_clock_time_in_ns:
+
+     This function returns the clock time stored by the most recent call to
+     refresh_cached_clock_time. The value is as old as the iteration of the
+     event loop which refreshed it. When the clock time has never been
+     refreshed, the clock is read instead.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     uint64_t - cached uptime of MONOTONIC time in nanoseconds
+ */
+uint64_t get_cached_clock_time_in_ns(void);
+
+#endif
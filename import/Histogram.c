@@ -0,0 +1,195 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Histogram.c
+
+  File Description:
+
+     This file contains the program of the histograms used to record the
+     distribution of latencies.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "Histogram.h"
+
+
+/* Values smaller than HISTOGRAM_SUB_BUCKETS are counted in their own bucket.
+   Larger values are counted by their highest HISTOGRAM_SUB_BUCKET_BITS + 1
+   bits. */
+static int bucket_index(uint64_t value){
+
+    int highest_bit;
+    int shift;
+    int index;
+
+    if(value < HISTOGRAM_SUB_BUCKETS)
+        return (int)value;
+
+    highest_bit = 63 - __builtin_clzll(value);
+    shift = highest_bit - HISTOGRAM_SUB_BUCKET_BITS;
+    index = (shift + 1) * HISTOGRAM_SUB_BUCKETS +
+            (int)((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+
+    if(index >= HISTOGRAM_BUCKETS)
+        return HISTOGRAM_BUCKETS - 1;
+
+    return index;
+}
+
+
+/* Returns the middle of the range of values counted in the bucket */
+static uint64_t bucket_value(int index){
+
+    int shift;
+    uint64_t lowest;
+
+    if(index < HISTOGRAM_SUB_BUCKETS)
+        return (uint64_t)index;
+
+    shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+    lowest = (uint64_t)(HISTOGRAM_SUB_BUCKETS +
+                        index % HISTOGRAM_SUB_BUCKETS) << shift;
+
+    return lowest + (((uint64_t)1 << shift) >> 1);
+}
+
+
+void histogram_reset(Histogram *histogram){
+
+    memset(histogram, 0, sizeof(Histogram));
+}
+
+
+void histogram_record(Histogram *histogram, uint64_t value){
+
+    uint64_t current_max;
+
+    __atomic_fetch_add(&histogram->counts[bucket_index(value)], 1,
+                       __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->total_count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->total_sum, value, __ATOMIC_RELAXED);
+
+    current_max = __atomic_load_n(&histogram->max_value, __ATOMIC_RELAXED);
+    while(value > current_max &&
+          !__atomic_compare_exchange_n(&histogram->max_value, &current_max,
+                                       value, 1, __ATOMIC_RELAXED,
+                                       __ATOMIC_RELAXED)){
+        /* current_max is reloaded by the failed exchange */
+    }
+}
+
+
+void histogram_snapshot(Histogram *histogram, Histogram *snapshot){
+
+    int i;
+
+    snapshot->total_count = 0;
+
+    for(i = 0; i < HISTOGRAM_BUCKETS; i++){
+        snapshot->counts[i] = __atomic_load_n(&histogram->counts[i],
+                                              __ATOMIC_RELAXED);
+        snapshot->total_count += snapshot->counts[i];
+    }
+
+    snapshot->total_sum = __atomic_load_n(&histogram->total_sum,
+                                          __ATOMIC_RELAXED);
+    snapshot->max_value = __atomic_load_n(&histogram->max_value,
+                                          __ATOMIC_RELAXED);
+}
+
+
+void histogram_subtract(Histogram *newer, Histogram *older){
+
+    int i;
+
+    newer->total_count = 0;
+
+    for(i = 0; i < HISTOGRAM_BUCKETS; i++){
+        newer->counts[i] = (newer->counts[i] > older->counts[i]) ?
+                           newer->counts[i] - older->counts[i] : 0;
+        newer->total_count += newer->counts[i];
+    }
+
+    newer->total_sum = (newer->total_sum > older->total_sum) ?
+                       newer->total_sum - older->total_sum : 0;
+}
+
+
+void histogram_add(Histogram *target, Histogram *source){
+
+    uint64_t max_value;
+    uint64_t count;
+    int i;
+
+    for(i = 0; i < HISTOGRAM_BUCKETS; i++){
+        count = __atomic_load_n(&source->counts[i], __ATOMIC_RELAXED);
+        target->counts[i] += count;
+        target->total_count += count;
+    }
+
+    target->total_sum += __atomic_load_n(&source->total_sum,
+                                         __ATOMIC_RELAXED);
+
+    max_value = __atomic_load_n(&source->max_value, __ATOMIC_RELAXED);
+    if(max_value > target->max_value)
+        target->max_value = max_value;
+}
+
+
+uint64_t histogram_percentile(Histogram *histogram, double percentile){
+
+    uint64_t total_count = 0;
+    uint64_t target;
+    uint64_t seen = 0;
+    int i;
+
+    for(i = 0; i < HISTOGRAM_BUCKETS; i++)
+        total_count += __atomic_load_n(&histogram->counts[i],
+                                       __ATOMIC_RELAXED);
+
+    if(total_count == 0)
+        return 0;
+
+    if(percentile <= 0)
+        target = 1;
+    else if(percentile >= 100)
+        target = total_count;
+    else
+        target = (uint64_t)(total_count * percentile / 100.0 + 0.5);
+
+    if(target == 0)
+        target = 1;
+
+    for(i = 0; i < HISTOGRAM_BUCKETS; i++){
+        seen += __atomic_load_n(&histogram->counts[i], __ATOMIC_RELAXED);
+        if(seen >= target)
+            return bucket_value(i);
+    }
+
+    return bucket_value(HISTOGRAM_BUCKETS - 1);
+}
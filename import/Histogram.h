@@ -0,0 +1,184 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Histogram.h
+
+  File Description:
+
+     This file contains the declarations of the histograms used to record the
+     distribution of latencies. Values are counted in buckets whose width
+     grows with the magnitude of the value, so that every recorded value is
+     represented within 1/HISTOGRAM_SUB_BUCKETS of its magnitude using a fixed
+     and small amount of memory. Recording a value is lock-free and can be
+     done by multiple threads concurrently.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+#include <string.h>
+
+/* The number of bits of the value used to select the sub-bucket within a
+   power of two. */
+#define HISTOGRAM_SUB_BUCKET_BITS 3
+
+/* The number of sub-buckets within each power of two */
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+
+/* The number of powers of two covered by the histogram. Values larger than
+   the last bucket are counted in the last bucket. With nanosecond values the
+   histogram covers about 36 minutes. */
+#define HISTOGRAM_MAGNITUDES 40
+
+/* The number of buckets in the histogram */
+#define HISTOGRAM_BUCKETS (HISTOGRAM_MAGNITUDES * HISTOGRAM_SUB_BUCKETS)
+
+/* The structure of the histogram */
+typedef struct {
+
+    /* The number of values recorded in each bucket */
+    uint64_t counts[HISTOGRAM_BUCKETS];
+
+    /* The number of values recorded */
+    uint64_t total_count;
+
+    /* The sum of values recorded */
+    uint64_t total_sum;
+
+    /* The largest value recorded */
+    uint64_t max_value;
+
+} Histogram;
+
+
+/*
+  histogram_reset:
+
+     This function clears all values recorded in the histogram. It must not
+     be called while other threads are recording values.
+
+  Parameters:
+
+     histogram - A pointer to the histogram.
+
+  Return value:
+
+     None
+ */
+void histogram_reset(Histogram *histogram);
+
+/*
+  histogram_record:
+
+     This function records one value in the histogram.
+
+  Parameters:
+
+     histogram - A pointer to the histogram.
+     value - The value to be recorded.
+
+  Return value:
+
+     None
+ */
+void histogram_record(Histogram *histogram, uint64_t value);
+
+/*
+  histogram_snapshot:
+
+     This function copies the histogram while other threads may be recording
+     values. The copy is consistent per bucket.
+
+  Parameters:
+
+     histogram - A pointer to the histogram to be copied.
+     snapshot - A pointer to the histogram to store the copy.
+
+  Return value:
+
+     None
+ */
+void histogram_snapshot(Histogram *histogram, Histogram *snapshot);
+
+/*
+  histogram_subtract:
+
+     This function subtracts the counts of an older snapshot from a newer
+     snapshot of the same histogram, so that the result contains only the
+     values recorded between the two snapshots. The max value of the result
+     is the max value of the newer snapshot.
+
+  Parameters:
+
+     newer - A pointer to the newer snapshot, which stores the result.
+     older - A pointer to the older snapshot.
+
+  Return value:
+
+     None
+ */
+void histogram_subtract(Histogram *newer, Histogram *older);
+
+/*
+  histogram_add:
+
+     This function adds the values recorded in a histogram to another
+     histogram, e.g. to combine the histograms of different packet types.
+     The source histogram may be recorded by other threads concurrently.
+
+  Parameters:
+
+     target - A pointer to the histogram which stores the result.
+     source - A pointer to the histogram to be added.
+
+  Return value:
+
+     None
+ */
+void histogram_add(Histogram *target, Histogram *source);
+
+/*
+  histogram_percentile:
+
+     This function returns the value at the specified percentile of the
+     values recorded in the histogram.
+
+  Parameters:
+
+     histogram - A pointer to the histogram.
+     percentile - The percentile between 0 and 100.
+
+  Return value:
+
+     uint64_t - The value at the percentile, or 0 if the histogram is empty.
+ */
+uint64_t histogram_percentile(Histogram *histogram, double percentile);
+
+#endif
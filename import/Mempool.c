@@ -69,6 +69,7 @@ int mp_init(Memory_Pool *mp, size_t size, size_t slots){
     mp->size = size;
     mp->slots = slots;
     mp->used_slots = 0;
+    mp->alloc_failure_count = 0;
     mp->alloc_time = 0;
     mp->blocks = 0;
 
@@ -182,6 +183,8 @@ void *mp_alloc(Memory_Pool *mp){
            expand the memory pool. */
         if(mp_expand(mp) == MEMORY_POOL_ERROR){
 
+            __atomic_fetch_add(&mp->alloc_failure_count, 1, 
+                               __ATOMIC_RELAXED);
             pthread_mutex_unlock(&mp->mem_lock);
             return NULL;
         }
@@ -46,6 +46,7 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <string.h>
+#include <stdint.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -84,6 +85,10 @@ typedef struct {
     /* counter for calculating the slots usage */
     int used_slots;
 
+    /* The number of mp_alloc calls failed because the memory pool cannot 
+       be expanded */
+    uint64_t alloc_failure_count;
+
 } Memory_Pool;
 
 
@@ -0,0 +1,431 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Metrics.c
+
+  File Description:
+
+     This file contains the program of the metrics registry and the HTTP
+     listener which exports the metrics in the Prometheus text format.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include <stdarg.h>
+#include "Metrics.h"
+
+
+/* The quantiles exported for each summary */
+static const double summary_quantiles[] = {0.5, 0.9, 0.99};
+
+
+/* Takes a free metric from the registry and fills the common attributes.
+   Returns NULL when the registry is full. */
+static Metric *add_metric(MetricsRegistry *registry,
+                          MetricType type,
+                          char *name,
+                          char *labels,
+                          char *help){
+
+    Metric *metric = NULL;
+
+    if(registry->number_metrics >= MAX_NUMBER_METRICS)
+        return NULL;
+
+    metric = &registry->metrics[registry->number_metrics];
+    memset(metric, 0, sizeof(Metric));
+
+    metric->type = type;
+    strncpy(metric->name, name, sizeof(metric->name) - 1);
+    if(labels != NULL)
+        strncpy(metric->labels, labels, sizeof(metric->labels) - 1);
+    strncpy(metric->help, help, sizeof(metric->help) - 1);
+
+    return metric;
+}
+
+
+/* Appends a formatted line to the buffer. The buffer is left unchanged and
+   false is returned when the line does not fit. */
+static bool append_line(char *buf, size_t buf_len, size_t *offset,
+                        const char *format, ...){
+
+    va_list args;
+    int written;
+
+    va_start(args, format);
+    written = vsnprintf(buf + *offset, buf_len - *offset, format, args);
+    va_end(args);
+
+    if(written < 0 || written >= buf_len - *offset){
+        buf[*offset] = '\0';
+        return false;
+    }
+
+    *offset += written;
+    return true;
+}
+
+
+/* Writes all bytes of the buffer to the connected socket */
+static void send_all(int socket, char *buf, size_t len){
+
+    ssize_t sent;
+
+    while(len > 0){
+        sent = send(socket, buf, len, MSG_NOSIGNAL);
+        if(sent <= 0){
+            if(sent == -1 && errno == EINTR)
+                continue;
+            return;
+        }
+        buf += sent;
+        len -= sent;
+    }
+}
+
+
+void init_metrics_registry(MetricsRegistry *registry){
+
+    pthread_mutex_init( &registry->registry_lock, 0);
+
+    registry->number_metrics = 0;
+    registry->listen_socket = -1;
+    registry->listen_port = 0;
+    registry->shutdown = false;
+}
+
+
+int register_metric_counter(MetricsRegistry *registry,
+                            char *name,
+                            char *labels,
+                            char *help,
+                            uint64_t *counter){
+
+    Metric *metric = NULL;
+
+    pthread_mutex_lock( &registry->registry_lock);
+
+    metric = add_metric(registry, METRIC_COUNTER, name, labels, help);
+    if(metric == NULL){
+        pthread_mutex_unlock( &registry->registry_lock);
+        return metrics_registry_full;
+    }
+
+    metric->counter = counter;
+    registry->number_metrics++;
+
+    pthread_mutex_unlock( &registry->registry_lock);
+
+    return 0;
+}
+
+
+int register_metric_gauge(MetricsRegistry *registry,
+                          char *name,
+                          char *labels,
+                          char *help,
+                          MetricGaugeFunction function,
+                          void *arg){
+
+    Metric *metric = NULL;
+
+    pthread_mutex_lock( &registry->registry_lock);
+
+    metric = add_metric(registry, METRIC_GAUGE, name, labels, help);
+    if(metric == NULL){
+        pthread_mutex_unlock( &registry->registry_lock);
+        return metrics_registry_full;
+    }
+
+    metric->function = function;
+    metric->arg = arg;
+    registry->number_metrics++;
+
+    pthread_mutex_unlock( &registry->registry_lock);
+
+    return 0;
+}
+
+
+int register_metric_summary(MetricsRegistry *registry,
+                            char *name,
+                            char *labels,
+                            char *help,
+                            Histogram *histogram){
+
+    Metric *metric = NULL;
+
+    pthread_mutex_lock( &registry->registry_lock);
+
+    metric = add_metric(registry, METRIC_SUMMARY, name, labels, help);
+    if(metric == NULL){
+        pthread_mutex_unlock( &registry->registry_lock);
+        return metrics_registry_full;
+    }
+
+    metric->histogram = histogram;
+    registry->number_metrics++;
+
+    pthread_mutex_unlock( &registry->registry_lock);
+
+    return 0;
+}
+
+
+int export_metrics(MetricsRegistry *registry, char *buf, size_t buf_len){
+
+    static const char *type_names[] = {"counter", "gauge", "summary"};
+    Metric *metric = NULL;
+    char *last_family = NULL;
+    char *separator = NULL;
+    char *open_brace = NULL;
+    char *close_brace = NULL;
+    size_t offset = 0;
+    uint64_t count;
+    bool is_fit = true;
+    int i, j;
+
+    if(buf_len == 0)
+        return 0;
+
+    buf[0] = '\0';
+
+    pthread_mutex_lock( &registry->registry_lock);
+
+    for(i = 0; i < registry->number_metrics && is_fit; i++){
+
+        metric = &registry->metrics[i];
+
+        if(metric->type == METRIC_SUMMARY &&
+           __atomic_load_n(&metric->histogram->total_count,
+                           __ATOMIC_RELAXED) == 0)
+            continue;
+
+        if(last_family == NULL || strcmp(last_family, metric->name) != 0){
+
+            is_fit = append_line(buf, buf_len, &offset,
+                                 "# HELP %s %s\n# TYPE %s %s\n",
+                                 metric->name, metric->help,
+                                 metric->name, type_names[metric->type]);
+            last_family = metric->name;
+        }
+
+        /* Braces are omitted for metrics without labels */
+        if(strlen(metric->labels) > 0){
+            separator = ",";
+            open_brace = "{";
+            close_brace = "}";
+        }else{
+            separator = "";
+            open_brace = "";
+            close_brace = "";
+        }
+
+        switch(metric->type){
+
+            case METRIC_COUNTER:
+
+                is_fit = is_fit &&
+                    append_line(buf, buf_len, &offset, "%s%s%s%s %llu\n",
+                                metric->name, open_brace, metric->labels,
+                                close_brace,
+                                (unsigned long long)
+                                __atomic_load_n(metric->counter,
+                                                __ATOMIC_RELAXED));
+                break;
+
+            case METRIC_GAUGE:
+
+                is_fit = is_fit &&
+                    append_line(buf, buf_len, &offset, "%s%s%s%s %.15g\n",
+                                metric->name, open_brace, metric->labels,
+                                close_brace,
+                                metric->function(metric->arg));
+                break;
+
+            case METRIC_SUMMARY:
+
+                for(j = 0; j < sizeof(summary_quantiles) / sizeof(double);
+                    j++){
+
+                    is_fit = is_fit &&
+                        append_line(buf, buf_len, &offset,
+                                    "%s{%s%squantile=\"%g\"} %.9f\n",
+                                    metric->name, metric->labels, separator,
+                                    summary_quantiles[j],
+                                    (double)histogram_percentile(
+                                        metric->histogram,
+                                        summary_quantiles[j] * 100) /
+                                    NS_EACH_SECOND);
+                }
+
+                count = __atomic_load_n(&metric->histogram->total_count,
+                                        __ATOMIC_RELAXED);
+
+                is_fit = is_fit &&
+                    append_line(buf, buf_len, &offset,
+                                "%s_sum%s%s%s %.9f\n%s_count%s%s%s %llu\n",
+                                metric->name, open_brace, metric->labels,
+                                close_brace,
+                                (double)__atomic_load_n(
+                                    &metric->histogram->total_sum,
+                                    __ATOMIC_RELAXED) /
+                                NS_EACH_SECOND,
+                                metric->name, open_brace, metric->labels,
+                                close_brace, (unsigned long long)count);
+                break;
+        }
+    }
+
+    pthread_mutex_unlock( &registry->registry_lock);
+
+    return (int)offset;
+}
+
+
+int start_metrics_listener(MetricsRegistry *registry, int port){
+
+    struct sockaddr_in si_listen;
+    int optval = 1;
+
+    registry->listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if(registry->listen_socket == -1)
+        return metrics_socket_error;
+
+    setsockopt(registry->listen_socket, SOL_SOCKET, SO_REUSEADDR, &optval,
+               sizeof(optval));
+
+    /* Metrics are only exported to the local host */
+    memset(&si_listen, 0, sizeof(si_listen));
+    si_listen.sin_family = AF_INET;
+    si_listen.sin_port = htons(port);
+    si_listen.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if(bind(registry->listen_socket, (struct sockaddr *)&si_listen,
+            sizeof(si_listen)) == -1){
+        close(registry->listen_socket);
+        registry->listen_socket = -1;
+        return metrics_bind_error;
+    }
+
+    if(listen(registry->listen_socket, METRICS_LISTEN_BACKLOG) == -1){
+        close(registry->listen_socket);
+        registry->listen_socket = -1;
+        return metrics_listen_error;
+    }
+
+    registry->listen_port = port;
+    registry->shutdown = false;
+
+    if(pthread_create(&registry->listener_thread, NULL,
+                      metrics_listener_routine, (void *)registry) != 0){
+        close(registry->listen_socket);
+        registry->listen_socket = -1;
+        return metrics_thread_error;
+    }
+
+    return 0;
+}
+
+
+void *metrics_listener_routine(void *metrics_registry){
+
+    MetricsRegistry *registry = (MetricsRegistry *)metrics_registry;
+    char request[METRICS_REQUEST_BUFFER_SIZE];
+    char header[METRICS_REQUEST_BUFFER_SIZE];
+    char *body = NULL;
+    int body_len;
+    int header_len;
+    int client_socket;
+    fd_set read_fds;
+    struct timeval timeout;
+
+    apply_thread_role(THREAD_ROLE_BACKGROUND);
+
+    body = malloc(METRICS_BUFFER_SIZE);
+    if(body == NULL)
+        return (void *)NULL;
+
+    while(registry->shutdown == false){
+
+        FD_ZERO(&read_fds);
+        FD_SET(registry->listen_socket, &read_fds);
+
+        timeout.tv_sec = METRICS_SELECT_TIMEOUT_IN_MS / 1000;
+        timeout.tv_usec = (METRICS_SELECT_TIMEOUT_IN_MS % 1000) * 1000;
+
+        if(select(registry->listen_socket + 1, &read_fds, NULL, NULL,
+                  &timeout) <= 0)
+            continue;
+
+        client_socket = accept(registry->listen_socket, NULL, NULL);
+        if(client_socket == -1)
+            continue;
+
+        timeout.tv_sec = METRICS_REQUEST_TIMEOUT_IN_SEC;
+        timeout.tv_usec = 0;
+        setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                   sizeof(timeout));
+
+        /* Every request is answered with the metrics, so the request itself
+           is only drained. */
+        recv(client_socket, request, sizeof(request), 0);
+
+        body_len = export_metrics(registry, body, METRICS_BUFFER_SIZE);
+
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\n" \
+                              "Content-Type: text/plain; version=0.0.4\r\n" \
+                              "Content-Length: %d\r\n" \
+                              "Connection: close\r\n\r\n",
+                              body_len);
+
+        send_all(client_socket, header, header_len);
+        send_all(client_socket, body, body_len);
+
+        close(client_socket);
+    }
+
+    free(body);
+
+    return (void *)NULL;
+}
+
+
+void stop_metrics_listener(MetricsRegistry *registry){
+
+    if(registry->listen_socket == -1)
+        return;
+
+    registry->shutdown = true;
+
+    pthread_join(registry->listener_thread, NULL);
+
+    close(registry->listen_socket);
+    registry->listen_socket = -1;
+}
@@ -0,0 +1,343 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Metrics.h
+
+  File Description:
+
+     This file contains the declarations of the metrics registry. Counters
+     are plain 64-bit integers owned by the modules which update them with
+     relaxed atomic additions. Gauges are functions called only when the
+     metrics are exported. The registry exports all metrics in the
+     Prometheus text format through a HTTP listener bound to the loopback
+     interface, so that the hot path never pays for the export.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+
+#include "Clock.h"
+#include "Histogram.h"
+#include "ThreadProfile.h"
+
+/* The maximum number of metrics in the registry */
+#define MAX_NUMBER_METRICS 256
+
+/* Number of characters of the name of a metric */
+#define LENGTH_OF_METRIC_NAME 64
+
+/* Number of characters of the labels of a metric */
+#define LENGTH_OF_METRIC_LABELS 64
+
+/* Number of characters of the help text of a metric */
+#define LENGTH_OF_METRIC_HELP 128
+
+/* The size in bytes of the buffer to export all metrics */
+#define METRICS_BUFFER_SIZE 65536
+
+/* The size in bytes of the buffer to read requests */
+#define METRICS_REQUEST_BUFFER_SIZE 1024
+
+/* The number of pending connections to the metrics listener */
+#define METRICS_LISTEN_BACKLOG 4
+
+/* The time interval in milliseconds for select() to break the block, so
+   that the listener notices the shutdown flag */
+#define METRICS_SELECT_TIMEOUT_IN_MS 1000
+
+/* The time interval in seconds to wait for the request of a connection */
+#define METRICS_REQUEST_TIMEOUT_IN_SEC 1
+
+
+/* The kind of value a metric exports */
+typedef enum _MetricType {
+
+    /* A 64-bit integer that only increases */
+    METRIC_COUNTER = 0,
+
+    /* A value computed by a function when the metrics are exported */
+    METRIC_GAUGE = 1,
+
+    /* The quantiles of a histogram of nanoseconds, exported in seconds */
+    METRIC_SUMMARY = 2
+
+} MetricType;
+
+/* The function to compute the value of a gauge */
+typedef double (*MetricGaugeFunction)(void *arg);
+
+/* A metric in the registry */
+typedef struct {
+
+    MetricType type;
+
+    char name[LENGTH_OF_METRIC_NAME];
+
+    /* The labels in the form of key="value",... or empty */
+    char labels[LENGTH_OF_METRIC_LABELS];
+
+    char help[LENGTH_OF_METRIC_HELP];
+
+    /* The counter of METRIC_COUNTER */
+    uint64_t *counter;
+
+    /* The function and its argument of METRIC_GAUGE */
+    MetricGaugeFunction function;
+    void *arg;
+
+    /* The histogram of METRIC_SUMMARY */
+    Histogram *histogram;
+
+} Metric;
+
+/* The registry of metrics and the listener to export them */
+typedef struct {
+
+    /* The lock for registering and exporting metrics */
+    pthread_mutex_t registry_lock;
+
+    int number_metrics;
+
+    Metric metrics[MAX_NUMBER_METRICS];
+
+    int listen_socket;
+
+    int listen_port;
+
+    pthread_t listener_thread;
+
+    /* The flag set to true when the listener needs to stop */
+    bool shutdown;
+
+} MetricsRegistry;
+
+
+enum{
+    metrics_registry_full = -1,
+    metrics_socket_error = -2,
+    metrics_bind_error = -3,
+    metrics_listen_error = -4,
+    metrics_thread_error = -5
+    };
+
+
+/*
+  metric_counter_add:
+
+     This function adds a value to a counter. It is lock-free and can be
+     called by multiple threads concurrently.
+
+  Parameters:
+
+     counter - A pointer to the counter.
+     value - The value to be added.
+
+  Return value:
+
+     None
+ */
+static inline void metric_counter_add(uint64_t *counter, uint64_t value){
+
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+/*
+  init_metrics_registry:
+
+     This function initializes an empty registry of metrics.
+
+  Parameters:
+
+     registry - A pointer to the registry.
+
+  Return value:
+
+     None
+ */
+void init_metrics_registry(MetricsRegistry *registry);
+
+/*
+  register_metric_counter:
+
+     This function adds a counter to the registry. Metrics with the same
+     name must be registered one after another.
+
+  Parameters:
+
+     registry - A pointer to the registry.
+     name - The name of the metric.
+     labels - The labels of the metric or NULL.
+     help - The description of the metric.
+     counter - A pointer to the counter.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the registry is full.
+ */
+int register_metric_counter(MetricsRegistry *registry,
+                            char *name,
+                            char *labels,
+                            char *help,
+                            uint64_t *counter);
+
+/*
+  register_metric_gauge:
+
+     This function adds a gauge to the registry. Metrics with the same name
+     must be registered one after another.
+
+  Parameters:
+
+     registry - A pointer to the registry.
+     name - The name of the metric.
+     labels - The labels of the metric or NULL.
+     help - The description of the metric.
+     function - The function to compute the value of the gauge.
+     arg - The argument of the function.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the registry is full.
+ */
+int register_metric_gauge(MetricsRegistry *registry,
+                          char *name,
+                          char *labels,
+                          char *help,
+                          MetricGaugeFunction function,
+                          void *arg);
+
+/*
+  register_metric_summary:
+
+     This function adds a histogram of nanoseconds to the registry. Metrics
+     with the same name must be registered one after another. Histograms
+     without any recorded value are not exported.
+
+  Parameters:
+
+     registry - A pointer to the registry.
+     name - The name of the metric.
+     labels - The labels of the metric or NULL.
+     help - The description of the metric.
+     histogram - A pointer to the histogram.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the registry is full.
+ */
+int register_metric_summary(MetricsRegistry *registry,
+                            char *name,
+                            char *labels,
+                            char *help,
+                            Histogram *histogram);
+
+/*
+  export_metrics:
+
+     This function writes all metrics in the registry in the Prometheus text
+     format.
+
+  Parameters:
+
+     registry - A pointer to the registry.
+     buf - The output buffer.
+     buf_len - The size in bytes of the output buffer.
+
+  Return value:
+
+     int - The number of bytes written, not including the terminating null
+           byte. The output is truncated at a line when the buffer is full.
+ */
+int export_metrics(MetricsRegistry *registry, char *buf, size_t buf_len);
+
+/*
+  start_metrics_listener:
+
+     This function binds a TCP socket to the specified port of the loopback
+     interface and starts the thread which answers every HTTP request on it
+     with the exported metrics.
+
+  Parameters:
+
+     registry - A pointer to the registry.
+     port - The port to listen on.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , something wrong.
+ */
+int start_metrics_listener(MetricsRegistry *registry, int port);
+
+/*
+  metrics_listener_routine:
+
+     The thread for answering HTTP requests for the metrics.
+
+  Parameters:
+
+     metrics_registry - A pointer to the registry.
+
+  Return value:
+
+     None
+ */
+void *metrics_listener_routine(void *metrics_registry);
+
+/*
+  stop_metrics_listener:
+
+     This function stops the listener thread and closes its socket.
+
+  Parameters:
+
+     registry - A pointer to the registry.
+
+  Return value:
+
+     None
+ */
+void stop_metrics_listener(MetricsRegistry *registry);
+
+#endif
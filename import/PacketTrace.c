@@ -0,0 +1,159 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     PacketTrace.c
+
+  File Description:
+
+     This file contains the programs of the packet traces.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "PacketTrace.h"
+
+
+int open_packet_trace_writer(PacketTrace *trace, char *file_name){
+
+    PacketTraceHeader header;
+
+    memset(trace, 0, sizeof(PacketTrace));
+
+    trace->file = fopen(file_name, "wb");
+    if(trace->file == NULL)
+        return packet_trace_open_error;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACKET_TRACE_MAGIC, strlen(PACKET_TRACE_MAGIC));
+    header.version = PACKET_TRACE_VERSION;
+    header.byte_order_mark = PACKET_TRACE_BYTE_ORDER_MARK;
+
+    if(fwrite(&header, sizeof(header), 1, trace->file) != 1){
+
+        fclose(trace->file);
+        trace->file = NULL;
+        return packet_trace_write_error;
+    }
+
+    return 0;
+}
+
+
+int write_packet_trace_record(PacketTrace *trace,
+                              uint64_t time_in_ns,
+                              uint32_t address,
+                              unsigned int port,
+                              char *content,
+                              int size){
+
+    PacketTraceRecordHeader record_header;
+
+    if(size < 0 || size > MESSAGE_LENGTH)
+        return packet_trace_format_error;
+
+    if(trace->record_count == 0)
+        trace->first_time_in_ns = time_in_ns;
+
+    record_header.time_in_ns = time_in_ns - trace->first_time_in_ns;
+    record_header.address = address;
+    record_header.port = (uint16_t)port;
+    record_header.size = (uint16_t)size;
+
+    if(fwrite(&record_header, sizeof(record_header), 1, trace->file) != 1 ||
+       fwrite(content, 1, size, trace->file) != size)
+        return packet_trace_write_error;
+
+    trace->record_count++;
+
+    return 0;
+}
+
+
+int open_packet_trace_reader(PacketTrace *trace, char *file_name){
+
+    PacketTraceHeader header;
+
+    memset(trace, 0, sizeof(PacketTrace));
+
+    trace->file = fopen(file_name, "rb");
+    if(trace->file == NULL)
+        return packet_trace_open_error;
+
+    if(fread(&header, sizeof(header), 1, trace->file) != 1 ||
+       memcmp(header.magic, PACKET_TRACE_MAGIC,
+              strlen(PACKET_TRACE_MAGIC)) != 0 ||
+       header.version != PACKET_TRACE_VERSION ||
+       header.byte_order_mark != PACKET_TRACE_BYTE_ORDER_MARK){
+
+        fclose(trace->file);
+        trace->file = NULL;
+        return packet_trace_format_error;
+    }
+
+    return 0;
+}
+
+
+int read_packet_trace_record(PacketTrace *trace, PacketTraceRecord *record){
+
+    PacketTraceRecordHeader record_header;
+    struct in_addr address;
+
+    if(fread(&record_header, sizeof(record_header), 1, trace->file) != 1)
+        return feof(trace->file) ? packet_trace_end :
+                                   packet_trace_format_error;
+
+    if(record_header.size > MESSAGE_LENGTH)
+        return packet_trace_format_error;
+
+    if(fread(record->content, 1, record_header.size, trace->file) !=
+       record_header.size)
+        return packet_trace_format_error;
+
+    record->content[record_header.size] = '\0';
+    record->size = record_header.size;
+    record->port = record_header.port;
+    record->time_in_ns = record_header.time_in_ns;
+
+    address.s_addr = record_header.address;
+    memset(record->address, 0, sizeof(record->address));
+    inet_ntop(AF_INET, &address, record->address, sizeof(record->address));
+
+    trace->record_count++;
+
+    return 0;
+}
+
+
+void close_packet_trace(PacketTrace *trace){
+
+    if(trace->file != NULL){
+
+        fclose(trace->file);
+        trace->file = NULL;
+    }
+}
@@ -0,0 +1,235 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     PacketTrace.h
+
+  File Description:
+
+     This file contains the declarations of the packet traces, which record
+     the datagrams received from the socket so that they can be replayed
+     later with the same timing. A trace is a binary file beginning with a
+     header followed by one record for each datagram:
+
+        uint64_t  time in nanoseconds since the first record
+        uint32_t  IPv4 source address in network byte order
+        uint16_t  source port
+        uint16_t  size of the datagram
+        char[]    the datagram itself
+
+     The fields are written in the byte order of the gateway, which the
+     header records, so a trace is replayed on the same kind of board it was
+     captured on.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef PACKET_TRACE_H
+#define PACKET_TRACE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+#include "Common.h"
+#include "pkt_Queue.h"
+
+/* The magic number at the beginning of every trace */
+#define PACKET_TRACE_MAGIC "BDTRACE"
+
+#define PACKET_TRACE_VERSION 1
+
+/* The value written to the header in the byte order of the gateway */
+#define PACKET_TRACE_BYTE_ORDER_MARK 0x01020304
+
+
+/* The header of a trace file */
+typedef struct {
+
+    char magic[8];
+
+    uint32_t version;
+
+    uint32_t byte_order_mark;
+
+} PacketTraceHeader;
+
+/* The fixed part of a record, followed by size bytes of the datagram */
+typedef struct __attribute__((packed)) {
+
+    uint64_t time_in_ns;
+
+    uint32_t address;
+
+    uint16_t port;
+
+    uint16_t size;
+
+} PacketTraceRecordHeader;
+
+/* A datagram read from a trace */
+typedef struct {
+
+    /* The time in nanoseconds since the first datagram of the trace */
+    uint64_t time_in_ns;
+
+    char address[NETWORK_ADDR_LENGTH];
+
+    unsigned int port;
+
+    int size;
+
+    char content[MESSAGE_LENGTH + 1];
+
+} PacketTraceRecord;
+
+typedef struct {
+
+    FILE *file;
+
+    /* The uptime in nanoseconds at which the first datagram was written */
+    uint64_t first_time_in_ns;
+
+    /* The number of records written or read */
+    uint64_t record_count;
+
+} PacketTrace;
+
+
+enum{
+    packet_trace_open_error = -1,
+    packet_trace_format_error = -2,
+    packet_trace_write_error = -3,
+    packet_trace_end = -4
+    };
+
+
+/*
+  open_packet_trace_writer:
+
+     This function creates a trace file and writes its header.
+
+  Parameters:
+
+     trace - A pointer to the trace.
+     file_name - The name of the trace file.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the file cannot be created.
+ */
+int open_packet_trace_writer(PacketTrace *trace, char *file_name);
+
+/*
+  write_packet_trace_record:
+
+     This function appends a datagram to the trace. Records are buffered
+     and reach the file when the buffer fills up or the trace is closed.
+
+  Parameters:
+
+     trace - A pointer to the trace.
+     time_in_ns - The uptime in nanoseconds at which the datagram was
+                  received.
+     address - The IPv4 source address in network byte order.
+     port - The source port.
+     content - The datagram.
+     size - The size of the datagram.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the record cannot be written.
+ */
+int write_packet_trace_record(PacketTrace *trace,
+                              uint64_t time_in_ns,
+                              uint32_t address,
+                              unsigned int port,
+                              char *content,
+                              int size);
+
+/*
+  open_packet_trace_reader:
+
+     This function opens a trace file and checks its header.
+
+  Parameters:
+
+     trace - A pointer to the trace.
+     file_name - The name of the trace file.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the file cannot be opened or is not a trace
+                        captured on this kind of board.
+ */
+int open_packet_trace_reader(PacketTrace *trace, char *file_name);
+
+/*
+  read_packet_trace_record:
+
+     This function reads the next datagram from the trace.
+
+  Parameters:
+
+     trace - A pointer to the trace.
+     record - A pointer to the record to read into. The content is
+              terminated by a null character.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If return packet_trace_end, there are no more records.
+           Otherwise, the trace is truncated or corrupted.
+ */
+int read_packet_trace_record(PacketTrace *trace, PacketTraceRecord *record);
+
+/*
+  close_packet_trace:
+
+     This function flushes and closes the trace file.
+
+  Parameters:
+
+     trace - A pointer to the trace.
+
+  Return value:
+
+     None
+ */
+void close_packet_trace(PacketTrace *trace);
+
+#endif
@@ -0,0 +1,207 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ThreadProfile.c
+
+  File Description:
+
+     This file contains the programs of the threading profile.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+/* For the CPU sets of the threads */
+#define _GNU_SOURCE
+
+#include "ThreadProfile.h"
+
+
+/* The profile applied by the threads, set once before they start */
+static ThreadProfile thread_profile;
+
+#ifdef __linux__
+/* The CPUs of the process when the profile is set. A thread inherits the
+   CPUs of the thread creating it, so a role without its own CPUs is put
+   back on these. */
+static cpu_set_t process_cpus;
+#endif
+
+/* The number of times the profile of a role could not be applied */
+static uint64_t failure_count = 0;
+
+
+void set_thread_profile(ThreadProfile *profile){
+
+    memcpy(&thread_profile, profile, sizeof(ThreadProfile));
+
+#ifdef __linux__
+    if(sched_getaffinity(0, sizeof(cpu_set_t), &process_cpus) != 0)
+        CPU_ZERO(&process_cpus);
+#endif
+}
+
+
+int apply_thread_role(ThreadRole role){
+
+#ifdef __linux__
+    struct sched_param param;
+    cpu_set_t cpus;
+    int minimal_priority;
+    int maximal_priority;
+    int return_value = 0;
+    int cpu;
+
+    if(thread_profile.is_enabled == false || role < 0 ||
+       role >= MAX_THREAD_ROLE)
+        return 0;
+
+    if(thread_profile.cpu_masks[role] == 0){
+
+        memcpy(&cpus, &process_cpus, sizeof(cpu_set_t));
+
+    }else{
+
+        CPU_ZERO(&cpus);
+        for(cpu = 0; cpu < MAX_THREAD_PROFILE_CPUS; cpu++){
+            if(thread_profile.cpu_masks[role] & ((uint64_t)1 << cpu))
+                CPU_SET(cpu, &cpus);
+        }
+    }
+
+    if(CPU_COUNT(&cpus) > 0 &&
+       pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus) != 0)
+        return_value = thread_profile_affinity_error;
+
+    memset(&param, 0, sizeof(param));
+
+    if(thread_profile.policy != SCHED_OTHER &&
+       (role == THREAD_ROLE_IO || role == THREAD_ROLE_DISPATCH)){
+
+        minimal_priority = sched_get_priority_min(thread_profile.policy);
+        maximal_priority = sched_get_priority_max(thread_profile.policy);
+
+        param.sched_priority = THREAD_PROFILE_RT_PRIORITY_BASE -
+                               thread_profile.nice[role];
+        if(param.sched_priority < minimal_priority)
+            param.sched_priority = minimal_priority;
+        if(param.sched_priority > maximal_priority)
+            param.sched_priority = maximal_priority;
+
+        if(pthread_setschedparam(pthread_self(), thread_profile.policy,
+                                 &param) != 0)
+            return_value = thread_profile_scheduling_error;
+
+    }else{
+
+        /* A thread created by a real-time thread inherits its policy */
+        if(thread_profile.policy != SCHED_OTHER &&
+           pthread_setschedparam(pthread_self(), SCHED_OTHER, &param) != 0)
+            return_value = thread_profile_scheduling_error;
+
+        /* The nice value belongs to the thread on Linux */
+        if(setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid),
+                       thread_profile.nice[role]) != 0)
+            return_value = thread_profile_scheduling_error;
+    }
+
+    if(return_value != 0)
+        __atomic_fetch_add(&failure_count, 1, __ATOMIC_RELAXED);
+
+    return return_value;
+#else
+    return 0;
+#endif
+}
+
+
+int parse_cpu_list(char *cpu_list, uint64_t *cpu_mask){
+
+    char *current = cpu_list;
+    char *end = NULL;
+    long first;
+    long last;
+    long cpu;
+
+    *cpu_mask = 0;
+
+    while(*current != '\0'){
+
+        first = strtol(current, &end, 10);
+        if(end == current || first < 0 || first >= MAX_THREAD_PROFILE_CPUS)
+            return thread_profile_cpu_list_error;
+
+        last = first;
+        current = end;
+
+        if(*current == '-'){
+
+            current++;
+            last = strtol(current, &end, 10);
+            if(end == current || last < first || 
+               last >= MAX_THREAD_PROFILE_CPUS)
+                return thread_profile_cpu_list_error;
+
+            current = end;
+        }
+
+        for(cpu = first; cpu <= last; cpu++)
+            *cpu_mask |= (uint64_t)1 << cpu;
+
+        if(*current == ',')
+            current++;
+        else if(*current != '\0')
+            return thread_profile_cpu_list_error;
+    }
+
+    return 0;
+}
+
+
+int lock_process_memory(void){
+
+#ifdef __linux__
+    pthread_attr_t attr;
+
+    if(pthread_getattr_default_np(&attr) == 0){
+
+        pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE_WITH_LOCKED_MEMORY);
+        pthread_setattr_default_np(&attr);
+        pthread_attr_destroy(&attr);
+    }
+
+    if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        return thread_profile_lock_memory_error;
+#endif
+
+    return 0;
+}
+
+
+uint64_t get_thread_profile_failure_count(void){
+
+    return __atomic_load_n(&failure_count, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,212 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ThreadProfile.h
+
+  File Description:
+
+     This file contains the declarations of the threading profile, which
+     pins the threads of each role to a set of CPUs and gives them a
+     scheduling policy and priority, so that the threads carrying packets
+     are not delayed by the other processes of the board. Every thread
+     applies the profile of its role when it starts. Until a profile is
+     set, threads keep the default attributes.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef THREAD_PROFILE_H
+#define THREAD_PROFILE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+/* The real-time priority of a thread with nice value 0. A thread with a
+   lower nice value gets a higher real-time priority, e.g. nice -4 becomes
+   priority 14. */
+#define THREAD_PROFILE_RT_PRIORITY_BASE 10
+
+/* The number of CPUs which can be listed in a profile */
+#define MAX_THREAD_PROFILE_CPUS 64
+
+/* The stack size of the threads created after the memory is locked. Every
+   page of a locked stack is resident, so the default of 8 MB would take
+   the memory of the board for stacks. */
+#define THREAD_STACK_SIZE_WITH_LOCKED_MEMORY (1024 * 1024)
+
+
+/* The roles of threads, each with its own CPUs and priority */
+typedef enum _ThreadRole {
+
+    /* The threads receiving, parsing and sending packets */
+    THREAD_ROLE_IO = 0,
+
+    /* The thread dispatching buffer nodes to the worker threads */
+    THREAD_ROLE_DISPATCH = 1,
+
+    /* The worker threads of the thread pool */
+    THREAD_ROLE_WORKER = 2,
+
+    /* The threads running periodical tasks, such as reports and probes */
+    THREAD_ROLE_BACKGROUND = 3,
+
+    MAX_THREAD_ROLE = 4
+
+} ThreadRole;
+
+typedef struct {
+
+    /* A flag indicating whether threads apply the profile of their roles */
+    bool is_enabled;
+
+    /* The CPUs the threads of each role run on, where bit n stands for 
+       CPU n. An empty mask leaves the threads on every CPU. */
+    uint64_t cpu_masks[MAX_THREAD_ROLE];
+
+    /* The scheduling policy of the io and dispatch threads, i.e.
+       SCHED_OTHER, SCHED_FIFO or SCHED_RR. The worker and background
+       threads are always scheduled by SCHED_OTHER, so that a long job
+       cannot starve the board. */
+    int policy;
+
+    /* The nice value of the threads of each role. Under a real-time policy
+       it is mapped to the real-time priority. */
+    int nice[MAX_THREAD_ROLE];
+
+} ThreadProfile;
+
+
+enum{
+    thread_profile_affinity_error = -1,
+    thread_profile_scheduling_error = -2,
+    thread_profile_cpu_list_error = -3,
+    thread_profile_lock_memory_error = -4
+    };
+
+
+/*
+  set_thread_profile:
+
+     This function sets the profile applied by the threads started
+     afterwards.
+
+  Parameters:
+
+     profile - A pointer to the profile to be copied.
+
+  Return value:
+
+     None
+ */
+void set_thread_profile(ThreadProfile *profile);
+
+/*
+  apply_thread_role:
+
+     This function applies the profile of a role to the calling thread. It
+     does nothing when the profile is not enabled. Failures, such as
+     raising the priority without the CAP_SYS_NICE capability, are counted
+     and leave the thread running with its attributes unchanged.
+
+  Parameters:
+
+     role - The role of the calling thread.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the CPUs or the scheduling cannot be set.
+ */
+int apply_thread_role(ThreadRole role);
+
+/*
+  parse_cpu_list:
+
+     This function parses a list of CPUs, such as "2-3,5", into a mask of
+     CPUs. An empty list gives an empty mask.
+
+  Parameters:
+
+     cpu_list - The list of CPUs.
+     cpu_mask - A pointer to the mask.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the list is malformed.
+ */
+int parse_cpu_list(char *cpu_list, uint64_t *cpu_mask);
+
+/*
+  lock_process_memory:
+
+     This function locks the pages of the process in memory, including the
+     pages mapped later, so that no thread waits for a page fault. It also
+     shrinks the stacks of the threads created afterwards to
+     THREAD_STACK_SIZE_WITH_LOCKED_MEMORY. It should be called before any
+     thread is started.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the memory cannot be locked.
+ */
+int lock_process_memory(void);
+
+/*
+  get_thread_profile_failure_count:
+
+     This function returns the number of times the profile of a role could
+     not be applied to a thread.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     uint64_t - The number of failures.
+ */
+uint64_t get_thread_profile_failure_count(void);
+
+#endif
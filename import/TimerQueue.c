@@ -0,0 +1,314 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     TimerQueue.c
+
+  File Description:
+
+     This file contains the programs of the timer queue.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "TimerQueue.h"
+
+
+static bool is_earlier(TimerQueue *queue, int position_a, int position_b){
+
+    return queue->timers[queue->heap[position_a]].deadline_in_ns <
+           queue->timers[queue->heap[position_b]].deadline_in_ns;
+}
+
+
+static void swap_heap(TimerQueue *queue, int position_a, int position_b){
+
+    int timer_id = queue->heap[position_a];
+
+    queue->heap[position_a] = queue->heap[position_b];
+    queue->heap[position_b] = timer_id;
+
+    queue->heap_position[queue->heap[position_a]] = position_a;
+    queue->heap_position[queue->heap[position_b]] = position_b;
+}
+
+
+static void sift_up(TimerQueue *queue, int position){
+
+    int parent;
+
+    while(position > 0){
+
+        parent = (position - 1) / 2;
+        if(!is_earlier(queue, position, parent))
+            break;
+
+        swap_heap(queue, position, parent);
+        position = parent;
+    }
+}
+
+
+static void sift_down(TimerQueue *queue, int position){
+
+    int child;
+
+    while((child = 2 * position + 1) < queue->number_scheduled){
+
+        if(child + 1 < queue->number_scheduled &&
+           is_earlier(queue, child + 1, child))
+            child++;
+
+        if(!is_earlier(queue, child, position))
+            break;
+
+        swap_heap(queue, position, child);
+        position = child;
+    }
+}
+
+
+static void push_timer(TimerQueue *queue, int timer_id){
+
+    int position = queue->number_scheduled++;
+
+    queue->heap[position] = timer_id;
+    queue->heap_position[timer_id] = position;
+
+    sift_up(queue, position);
+}
+
+
+static void remove_timer_at(TimerQueue *queue, int position){
+
+    int last = --queue->number_scheduled;
+
+    queue->heap_position[queue->heap[position]] = -1;
+
+    if(position == last)
+        return;
+
+    queue->heap[position] = queue->heap[last];
+    queue->heap_position[queue->heap[position]] = position;
+
+    sift_down(queue, position);
+    sift_up(queue, position);
+}
+
+
+/* Converts an uptime in nanoseconds to the time to wait until */
+static void to_timespec(uint64_t time_in_ns, struct timespec *time){
+
+    time->tv_sec = time_in_ns / NS_EACH_SECOND;
+    time->tv_nsec = time_in_ns % NS_EACH_SECOND;
+}
+
+
+int init_timer_queue(TimerQueue *queue){
+
+    pthread_condattr_t condattr;
+    int i;
+
+    memset(queue, 0, sizeof(TimerQueue));
+
+    for(i = 0; i < MAX_NUMBER_TIMERS; i++)
+        queue->heap_position[i] = -1;
+
+    queue->running_timer = -1;
+
+    /* Deadlines are on the monotonic clock, so that they are not moved by
+       the synchronization of the system time */
+    if(pthread_mutex_init( &queue->timer_lock, 0) != 0 ||
+       pthread_condattr_init( &condattr) != 0 ||
+       pthread_condattr_setclock( &condattr, CLOCK_MONOTONIC) != 0 ||
+       pthread_cond_init( &queue->timer_cond, &condattr) != 0)
+        return timer_queue_init_error;
+
+    pthread_condattr_destroy( &condattr);
+
+    return 0;
+}
+
+
+int add_timer(TimerQueue *queue,
+              TimerFunction function,
+              void *arg,
+              int first_delay_in_ms,
+              int interval_in_ms){
+
+    int timer_id;
+    Timer *timer = NULL;
+
+    pthread_mutex_lock( &queue->timer_lock);
+
+    for(timer_id = 0; timer_id < MAX_NUMBER_TIMERS; timer_id++){
+        if(queue->timers[timer_id].in_use == false)
+            break;
+    }
+
+    if(timer_id == MAX_NUMBER_TIMERS){
+        pthread_mutex_unlock( &queue->timer_lock);
+        return timer_queue_full;
+    }
+
+    timer = &queue->timers[timer_id];
+    timer->in_use = true;
+    timer->deadline_in_ns = get_clock_time_in_ns() +
+                            (uint64_t)first_delay_in_ms * NS_EACH_MS;
+    timer->interval_in_ns = (uint64_t)interval_in_ms * NS_EACH_MS;
+    timer->is_rescheduled = false;
+    timer->function = function;
+    timer->arg = arg;
+
+    push_timer(queue, timer_id);
+
+    pthread_cond_signal( &queue->timer_cond);
+
+    pthread_mutex_unlock( &queue->timer_lock);
+
+    return timer_id;
+}
+
+
+int reschedule_timer(TimerQueue *queue, int timer_id, int delay_in_ms){
+
+    Timer *timer = NULL;
+
+    if(timer_id < 0 || timer_id >= MAX_NUMBER_TIMERS)
+        return timer_not_found;
+
+    pthread_mutex_lock( &queue->timer_lock);
+
+    timer = &queue->timers[timer_id];
+
+    if(timer->in_use == false){
+        pthread_mutex_unlock( &queue->timer_lock);
+        return timer_not_found;
+    }
+
+    timer->deadline_in_ns = get_clock_time_in_ns() +
+                            (uint64_t)delay_in_ms * NS_EACH_MS;
+
+    if(queue->running_timer == timer_id){
+
+        /* The timer is pushed back after its function returns */
+        timer->is_rescheduled = true;
+
+    }else{
+
+        if(queue->heap_position[timer_id] >= 0)
+            remove_timer_at(queue, queue->heap_position[timer_id]);
+
+        push_timer(queue, timer_id);
+
+        pthread_cond_signal( &queue->timer_cond);
+    }
+
+    pthread_mutex_unlock( &queue->timer_lock);
+
+    return 0;
+}
+
+
+void run_timer_queue(TimerQueue *queue, bool *is_running){
+
+    struct timespec wait_until;
+    uint64_t now;
+    uint64_t wait_deadline;
+    int timer_id;
+    Timer *timer = NULL;
+
+    pthread_mutex_lock( &queue->timer_lock);
+
+    while(*is_running == true){
+
+        now = get_clock_time_in_ns();
+
+        if(queue->number_scheduled == 0 ||
+           queue->timers[queue->heap[0]].deadline_in_ns > now){
+
+            wait_deadline = now + TIMER_QUEUE_MAX_WAIT_IN_MS * NS_EACH_MS;
+
+            if(queue->number_scheduled > 0 &&
+               queue->timers[queue->heap[0]].deadline_in_ns < wait_deadline)
+                wait_deadline = queue->timers[queue->heap[0]].deadline_in_ns;
+
+            to_timespec(wait_deadline, &wait_until);
+
+            pthread_cond_timedwait( &queue->timer_cond, &queue->timer_lock,
+                                    &wait_until);
+            continue;
+        }
+
+        timer_id = queue->heap[0];
+        timer = &queue->timers[timer_id];
+
+        remove_timer_at(queue, 0);
+
+        timer->is_rescheduled = false;
+        queue->running_timer = timer_id;
+
+        /* The function may add or reschedule timers */
+        pthread_mutex_unlock( &queue->timer_lock);
+
+        timer->function(timer->arg);
+
+        pthread_mutex_lock( &queue->timer_lock);
+
+        queue->running_timer = -1;
+
+        if(timer->is_rescheduled == true){
+
+            push_timer(queue, timer_id);
+
+        }else if(timer->interval_in_ns > 0){
+
+            /* Periodic timers keep their phase. When the function overran
+               whole periods, the missed deadlines are skipped instead of
+               being run back to back. */
+            timer->deadline_in_ns += timer->interval_in_ns;
+
+            now = get_clock_time_in_ns();
+            if(timer->deadline_in_ns <= now)
+                timer->deadline_in_ns = now + timer->interval_in_ns;
+
+            push_timer(queue, timer_id);
+
+        }else{
+
+            timer->in_use = false;
+        }
+    }
+
+    pthread_mutex_unlock( &queue->timer_lock);
+}
+
+
+void release_timer_queue(TimerQueue *queue){
+
+    pthread_cond_destroy( &queue->timer_cond);
+    pthread_mutex_destroy( &queue->timer_lock);
+}
@@ -0,0 +1,212 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     TimerQueue.h
+
+  File Description:
+
+     This file contains the declarations of the timer queue. Timers are kept
+     in a binary min-heap ordered by their deadlines on the monotonic clock.
+     The thread running the queue sleeps on a condition variable until the
+     earliest deadline or until a timer is added or rescheduled, and then
+     calls the functions of the timers due. Periodic timers are rescheduled
+     from their previous deadlines, so they do not drift.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef TIMER_QUEUE_H
+#define TIMER_QUEUE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "Clock.h"
+
+/* The maximum number of timers in a queue */
+#define MAX_NUMBER_TIMERS 32
+
+/* The maximum time in milliseconds the queue sleeps, so that the thread
+   running the queue notices the flag to stop */
+#define TIMER_QUEUE_MAX_WAIT_IN_MS 1000
+
+
+/* The function called when a timer is due */
+typedef void (*TimerFunction)(void *arg);
+
+/* A timer in the queue */
+typedef struct {
+
+    bool in_use;
+
+    /* The uptime in nanoseconds at which the timer is due */
+    uint64_t deadline_in_ns;
+
+    /* The period in nanoseconds of a periodic timer, or 0 for a timer which
+       is due once */
+    uint64_t interval_in_ns;
+
+    /* A flag indicating whether the timer is rescheduled by its own
+       function */
+    bool is_rescheduled;
+
+    TimerFunction function;
+
+    void *arg;
+
+} Timer;
+
+typedef struct {
+
+    /* The lock for the timers and the heap */
+    pthread_mutex_t timer_lock;
+
+    /* The condition signaled when the earliest deadline may have changed */
+    pthread_cond_t timer_cond;
+
+    Timer timers[MAX_NUMBER_TIMERS];
+
+    /* The ids of the scheduled timers in a min-heap by deadline */
+    int heap[MAX_NUMBER_TIMERS];
+
+    /* The position of each timer in the heap, or -1 if not scheduled */
+    int heap_position[MAX_NUMBER_TIMERS];
+
+    int number_scheduled;
+
+    /* The id of the timer whose function is being called, or -1 */
+    int running_timer;
+
+} TimerQueue;
+
+
+enum{
+    timer_queue_full = -1,
+    timer_not_found = -2,
+    timer_queue_init_error = -3
+    };
+
+
+/*
+  init_timer_queue:
+
+     This function initializes an empty timer queue.
+
+  Parameters:
+
+     queue - A pointer to the timer queue.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , something wrong.
+ */
+int init_timer_queue(TimerQueue *queue);
+
+/*
+  add_timer:
+
+     This function adds a timer to the queue.
+
+  Parameters:
+
+     queue - A pointer to the timer queue.
+     function - The function called when the timer is due.
+     arg - The argument of the function.
+     first_delay_in_ms - The time in milliseconds from now to the first
+                         deadline.
+     interval_in_ms - The period in milliseconds of the timer, or 0 if the
+                      timer is due once.
+
+  Return value:
+
+     int : The id of the timer if not negative.
+           If negative, the queue is full.
+ */
+int add_timer(TimerQueue *queue,
+              TimerFunction function,
+              void *arg,
+              int first_delay_in_ms,
+              int interval_in_ms);
+
+/*
+  reschedule_timer:
+
+     This function moves the next deadline of a timer. It can be called by
+     the function of the timer itself and by other threads.
+
+  Parameters:
+
+     queue - A pointer to the timer queue.
+     timer_id - The id of the timer.
+     delay_in_ms - The time in milliseconds from now to the next deadline.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the timer is not found.
+ */
+int reschedule_timer(TimerQueue *queue, int timer_id, int delay_in_ms);
+
+/*
+  run_timer_queue:
+
+     This function calls the functions of the timers when they are due, one
+     at a time, until the flag becomes false.
+
+  Parameters:
+
+     queue - A pointer to the timer queue.
+     is_running - A pointer to the flag which keeps the queue running.
+
+  Return value:
+
+     None
+ */
+void run_timer_queue(TimerQueue *queue, bool *is_running);
+
+/*
+  release_timer_queue:
+
+     This function releases the lock and the condition of the queue.
+
+  Parameters:
+
+     queue - A pointer to the timer queue.
+
+  Return value:
+
+     None
+ */
+void release_timer_queue(TimerQueue *queue);
+
+#endif
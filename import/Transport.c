@@ -0,0 +1,180 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Transport.c
+
+  File Description:
+
+     This file contains the programs of the transports.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "Transport.h"
+
+
+static int udp_transport_send(void *context,
+                              char *address,
+                              unsigned int port,
+                              char *content,
+                              int size){
+
+    return udp_addpkt((pudp_config)context, address, port, content, size);
+}
+
+
+static int udp_transport_receive(void *context, int receiver, sPkt *pkt){
+
+    return udp_getrecv_from((pudp_config)context, receiver, pkt);
+}
+
+
+/* Adds a pkt without dropping it when the queue is full */
+static int add_pkt_waiting(pkt_ptr pkt_queue,
+                           char *address,
+                           unsigned int port,
+                           char *content,
+                           int size){
+
+    int return_value;
+
+    while((return_value = addpkt(pkt_queue, address, port, content, size))
+          == pkt_Queue_FULL)
+        sched_yield();
+
+    return return_value;
+}
+
+
+static int loopback_transport_send(void *context,
+                                   char *address,
+                                   unsigned int port,
+                                   char *content,
+                                   int size){
+
+    LoopbackTransport *loopback = (LoopbackTransport *)context;
+
+    if(add_pkt_waiting(&loopback->outbound_queue, address, port, content,
+                       size) != pkt_Queue_SUCCESS)
+        return addpkt_msg_oversize;
+
+    __atomic_fetch_add(&loopback->sent_count, 1, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+
+static int loopback_transport_receive(void *context, 
+                                      int receiver, 
+                                      sPkt *pkt){
+
+    LoopbackTransport *loopback = (LoopbackTransport *)context;
+
+    return get_pkt_into(&loopback->inbound_queue, pkt);
+}
+
+
+int transport_send(Transport *transport,
+                   char *address,
+                   unsigned int port,
+                   char *content,
+                   int size){
+
+    return transport->send(transport->context, address, port, content, size);
+}
+
+
+int transport_receive(Transport *transport, int receiver, sPkt *pkt){
+
+    return transport->receive(transport->context, receiver, pkt);
+}
+
+
+void init_udp_transport(Transport *transport, pudp_config udp_config){
+
+    transport->context = udp_config;
+    transport->send = udp_transport_send;
+    transport->receive = udp_transport_receive;
+    transport->number_receivers = udp_config->number_receivers;
+}
+
+
+int init_loopback_transport(Transport *transport, LoopbackTransport *loopback){
+
+    int return_value;
+
+    loopback->injected_count = 0;
+    loopback->sent_count = 0;
+
+    /* The harness is the only producer of the inbound queue and the gateway
+       receives on one thread, while any worker of the gateway sends */
+    return_value = init_Packet_Queue_with_type(&loopback->inbound_queue,
+                                               PKT_QUEUE_SPSC);
+    if(return_value != pkt_Queue_SUCCESS)
+        return return_value;
+
+    return_value = init_Packet_Queue_with_type(&loopback->outbound_queue,
+                                               PKT_QUEUE_MPSC);
+    if(return_value != pkt_Queue_SUCCESS)
+        return return_value;
+
+    transport->context = loopback;
+    transport->send = loopback_transport_send;
+    transport->receive = loopback_transport_receive;
+    transport->number_receivers = 1;
+
+    return 0;
+}
+
+
+int inject_loopback_message(LoopbackTransport *loopback,
+                            char *address,
+                            unsigned int port,
+                            char *content,
+                            int size){
+
+    if(add_pkt_waiting(&loopback->inbound_queue, address, port, content,
+                       size) != pkt_Queue_SUCCESS)
+        return addpkt_msg_oversize;
+
+    __atomic_fetch_add(&loopback->injected_count, 1, __ATOMIC_RELAXED);
+
+    return 0;
+}
+
+
+int collect_loopback_message(LoopbackTransport *loopback, sPkt *pkt){
+
+    return get_pkt_into(&loopback->outbound_queue, pkt);
+}
+
+
+void release_loopback_transport(LoopbackTransport *loopback){
+
+    Free_Packet_Queue(&loopback->inbound_queue);
+    Free_Packet_Queue(&loopback->outbound_queue);
+}
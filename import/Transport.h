@@ -0,0 +1,238 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Transport.h
+
+  File Description:
+
+     This file contains the declarations of the transports, through which
+     the gateway sends and receives messages without knowing how they are
+     carried. The UDP transport frames the messages and carries them over
+     the sockets of a UDP configuration. The loopback transport keeps them
+     in memory: messages injected by a test harness are received by the
+     gateway, and messages sent by the gateway are collected for the
+     harness, so that the whole gateway runs in one process without
+     network.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "UDP_API.h"
+#include "pkt_Queue.h"
+
+
+/* The function adding a message to be sent to the address and port */
+typedef int (*TransportSendFunction)(void *context,
+                                     char *address,
+                                     unsigned int port,
+                                     char *content,
+                                     int size);
+
+/* The function getting the next message received by a receiver into the
+   pkt */
+typedef int (*TransportReceiveFunction)(void *context, int receiver, 
+                                        sPkt *pkt);
+
+typedef struct {
+
+    /* The state of the transport passed to its functions */
+    void *context;
+
+    TransportSendFunction send;
+
+    TransportReceiveFunction receive;
+
+    /* The number of receivers, each receiving its own share of the messages
+       in order, so that each can be drained by its own thread */
+    int number_receivers;
+
+} Transport;
+
+/* The queues of the loopback transport */
+typedef struct {
+
+    /* The messages injected by the harness to be received by the gateway */
+    spkt_ptr inbound_queue;
+
+    /* The messages sent by the gateway to be collected by the harness */
+    spkt_ptr outbound_queue;
+
+    /* The number of messages injected and sent */
+    uint64_t injected_count;
+    uint64_t sent_count;
+
+} LoopbackTransport;
+
+
+/*
+  transport_send:
+
+     This function adds a message to be sent through the transport.
+
+  Parameters:
+
+     transport - A pointer to the transport.
+     address - The address the message is sent to.
+     port - The port the message is sent to.
+     content - The content of the message.
+     size - The size of the content.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the message cannot be sent.
+ */
+int transport_send(Transport *transport,
+                   char *address,
+                   unsigned int port,
+                   char *content,
+                   int size);
+
+/*
+  transport_receive:
+
+     This function gets the next message received by a receiver of the
+     transport.
+
+  Parameters:
+
+     transport - A pointer to the transport.
+     receiver - The index of the receiver, from 0 to number_receivers - 1.
+     pkt - A pointer to the pkt to copy the message into.
+
+  Return value:
+
+     int : If return pkt_Queue_SUCCESS, a message is received.
+           If return pkt_Queue_is_NULL, no message is received and the
+           is_null flag of the pkt is set.
+ */
+int transport_receive(Transport *transport, int receiver, sPkt *pkt);
+
+/*
+  init_udp_transport:
+
+     This function lets the transport carry messages over the sockets of an
+     initialized UDP configuration, with one receiver for each receive 
+     socket.
+
+  Parameters:
+
+     transport - A pointer to the transport.
+     udp_config - A pointer to the UDP configuration.
+
+  Return value:
+
+     None
+ */
+void init_udp_transport(Transport *transport, pudp_config udp_config);
+
+/*
+  init_loopback_transport:
+
+     This function initializes the queues of a loopback transport and lets
+     the transport carry messages through them, with one receiver.
+
+  Parameters:
+
+     transport - A pointer to the transport.
+     loopback - A pointer to the loopback transport.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the queues cannot be initialized.
+ */
+int init_loopback_transport(Transport *transport, LoopbackTransport *loopback);
+
+/*
+  inject_loopback_message:
+
+     This function adds a message to be received by the gateway as if it
+     came from the address and port. When the inbound queue is full, it
+     waits for the gateway to receive, so that no message is dropped.
+
+  Parameters:
+
+     loopback - A pointer to the loopback transport.
+     address - The address the message comes from.
+     port - The port the message comes from.
+     content - The content of the message.
+     size - The size of the content.
+
+  Return value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the message is too large.
+ */
+int inject_loopback_message(LoopbackTransport *loopback,
+                            char *address,
+                            unsigned int port,
+                            char *content,
+                            int size);
+
+/*
+  collect_loopback_message:
+
+     This function gets the next message sent by the gateway.
+
+  Parameters:
+
+     loopback - A pointer to the loopback transport.
+     pkt - A pointer to the pkt to copy the message into.
+
+  Return value:
+
+     int : If return pkt_Queue_SUCCESS, a message is collected.
+           If return pkt_Queue_is_NULL, no message is sent.
+ */
+int collect_loopback_message(LoopbackTransport *loopback, sPkt *pkt);
+
+/*
+  release_loopback_transport:
+
+     This function releases the queues of a loopback transport.
+
+  Parameters:
+
+     loopback - A pointer to the loopback transport.
+
+  Return value:
+
+     None
+ */
+void release_loopback_transport(LoopbackTransport *loopback);
+
+#endif
@@ -33,17 +33,51 @@
   Authors:
      Gary Xiao      , garyh0205@hotmail.com
  */
+
+/* For aligned_alloc, which -std=gnu99 does not declare. Defining it turns
+   off the default features such as SO_REUSEPORT, so they are kept on. */
+#define _ISOC11_SOURCE
+#define _DEFAULT_SOURCE
+
 #include "UDP_API.h"
 #include "libEncrypt.h"
+#include "BeDIS.h"
 
 
 int udp_initial(pudp_config udp_config, int recv_port)
 {
 
+    return udp_initial_with_receivers(udp_config, recv_port, 1, 
+                                      MAX_QUEUE_LENGTH);
+}
+
+int udp_initial_with_receivers(pudp_config udp_config, int recv_port, 
+                               int number_receivers, int queue_capacity)
+{
+
     int return_value;
 
     int timeout;
 
+    int reuse_port = 1;
+
+    int i;
+
+    sudp_receiver *receiver;
+
+    if(number_receivers < 1 || number_receivers > MAX_NUMBER_RECEIVE_SOCKETS)
+        return receiver_number_error;
+
+    /* The received queues are aligned to cache lines */
+    udp_config -> receivers = aligned_alloc(CACHE_LINE_SIZE, 
+                                            number_receivers * 
+                                            sizeof(sudp_receiver));
+    if(udp_config -> receivers == NULL)
+        return receiver_number_error;
+
+    memset(udp_config -> receivers, 0, 
+           number_receivers * sizeof(sudp_receiver));
+
 #ifdef _WIN32
      udp_config -> sockVersion = MAKEWORD(2,2);
 
@@ -54,47 +88,110 @@ int udp_initial(pudp_config udp_config, int recv_port)
     memset((char *) &udp_config -> si_server, 0,
            sizeof(udp_config -> si_server));
 
-    if (return_value = init_Packet_Queue( &udp_config -> pkt_Queue) != 
-        pkt_Queue_SUCCESS)
-        return return_value;
+    /* Pkts are added by any thread and sent by the send thread only */
+    if ((return_value = init_Packet_Queue_with_capacity( 
+                            &udp_config -> pkt_Queue, PKT_QUEUE_MPSC,
+                            queue_capacity)) != 
+        pkt_Queue_SUCCESS){
 
-    if (return_value = init_Packet_Queue( &udp_config -> Received_Queue) != 
-        pkt_Queue_SUCCESS)
+        free(udp_config -> receivers);
+        udp_config -> receivers = NULL;
         return return_value;
+    }
+
+    /* Pkts are received by the receive thread of the socket only and got by
+       the thread processing them only */
+    for(i = 0; i < number_receivers; i++){
+
+        if ((return_value = init_Packet_Queue_with_capacity( 
+                                &udp_config -> receivers[i].Received_Queue, 
+                                PKT_QUEUE_SPSC, queue_capacity)) != 
+            pkt_Queue_SUCCESS){
+
+            /* Free the queues initialized before the failed one */
+            while(i-- > 0)
+                Free_Packet_Queue( &udp_config -> receivers[i].Received_Queue);
+            Free_Packet_Queue( &udp_config -> pkt_Queue);
+            free(udp_config -> receivers);
+            udp_config -> receivers = NULL;
+            return return_value;
+        }
+    }
 
     /* create a send UDP socket */
     if ((udp_config -> send_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP))
         == -1)
         return send_socket_error;
 
-    /* create a recv UDP socket */
-    if ((udp_config -> recv_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP))
-        == -1)
-        return recv_socket_error;
-
-
-    timeout = UDP_SELECT_TIMEOUT; // sec
-
-    setsockopt(udp_config -> recv_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout,
-               sizeof(timeout));
-
     udp_config -> si_server.sin_family = AF_INET;
     udp_config -> si_server.sin_port = htons(recv_port);
     udp_config -> si_server.sin_addr.s_addr = htonl(INADDR_ANY);
 
     udp_config -> shutdown = false;
 
+    udp_config -> send_queue_latency = NULL;
+
+    udp_config -> crypto_failure_count = 0;
+
+    udp_config -> send_failure_count = 0;
+
+    pthread_mutex_init( &udp_config -> capture_lock, 0);
+
+    udp_config -> capture_trace = NULL;
+
+    udp_config -> replay_trace = NULL;
+
+    udp_config -> is_replay_claimed = false;
+
+    udp_config -> replayed_count = 0;
+
     udp_config -> recv_port = recv_port;
 
-    /* bind recv socket to the port */
-    if( bind(udp_config -> recv_socket, (struct sockaddr *)&udp_config ->
-             si_server, sizeof(udp_config -> si_server) ) == -1)
-        return recv_socket_bind_error;
+    udp_config -> number_receivers = number_receivers;
+
+    timeout = UDP_SELECT_TIMEOUT; // sec
+
+    for(i = 0; i < number_receivers; i++){
+
+        receiver = &udp_config -> receivers[i];
 
-    /* The thread is used for receiving data */
-    pthread_create(&udp_config -> udp_receive_thread, NULL,    
-                   udp_recv_pkt_routine, (void*) udp_config);
-    pthread_detach(udp_config -> udp_receive_thread);
+        receiver -> udp_config = udp_config;
+
+        /* create a recv UDP socket */
+        if ((receiver -> recv_socket = socket(AF_INET, SOCK_DGRAM, 
+                                              IPPROTO_UDP)) == -1)
+            return recv_socket_error;
+
+        setsockopt(receiver -> recv_socket, SOL_SOCKET, SO_RCVTIMEO, 
+                   &timeout, sizeof(timeout));
+
+#ifdef SO_REUSEPORT
+        /* Every socket is bound to the port before the first datagram, so
+           none of them is left out of the hashing */
+        if(number_receivers > 1 &&
+           setsockopt(receiver -> recv_socket, SOL_SOCKET, SO_REUSEPORT, 
+                      &reuse_port, sizeof(reuse_port)) == -1)
+            return set_socketopt_error;
+#else
+        if(number_receivers > 1)
+            return set_socketopt_error;
+#endif
+
+        /* bind recv socket to the port */
+        if( bind(receiver -> recv_socket, (struct sockaddr *)&udp_config ->
+                 si_server, sizeof(udp_config -> si_server) ) == -1)
+            return recv_socket_bind_error;
+    }
+
+    /* The threads are used for receiving data */
+    for(i = 0; i < number_receivers; i++){
+
+        receiver = &udp_config -> receivers[i];
+
+        pthread_create(&receiver -> udp_receive_thread, NULL,    
+                       udp_recv_pkt_routine, (void*) receiver);
+        pthread_detach(receiver -> udp_receive_thread);
+    }
 
     /* The thread is used for sending data */
     pthread_create(&udp_config -> udp_send_thread, NULL, udp_send_pkt_routine, 
@@ -119,15 +216,15 @@ int udp_addpkt_without_encoding(pudp_config udp_config, char *address, unsigned
 sPkt udp_getrecv_without_encoding(pudp_config udp_config)
 {
 
-    sPkt tmp = get_pkt(&udp_config -> Received_Queue);
+    sPkt tmp = get_pkt(&udp_config -> receivers[0].Received_Queue);
 
     return tmp;
 }
 
-int udp_addpkt(pudp_config udp_config, char *address, unsigned int port, 
-               char *content, int size)
+int udp_encode_message(char *content, char *message, int message_size)
 {
     int ret = 0;
+    int size = 0;
     char content_sha256[LENGTH_OF_SHA256];
     char ciphertext[LENGTH_OF_ENCODED_WIFI_MESSAGE];
 
@@ -137,47 +234,95 @@ int udp_addpkt(pudp_config udp_config, char *address, unsigned int port,
     memset(ciphertext, 0, sizeof(ciphertext));
     ret = AES_ECB_Encoder_With_Token_Prefix(content_sha256, ciphertext, sizeof(ciphertext));
 
-    strcat(ciphertext, DELIMITER_SEMICOLON);
-    strcat(ciphertext, content);
-    size = strlen(ciphertext);
-    
-    if(size > MESSAGE_LENGTH)
-        return addpkt_msg_oversize;
+    size = snprintf(message, message_size, "%s%s%s", ciphertext, 
+                    DELIMITER_SEMICOLON, content);
 
-    addpkt(&udp_config -> pkt_Queue, address, port, ciphertext, size);
+    if(size < 0 || size >= message_size || size > MESSAGE_LENGTH)
+        return addpkt_msg_oversize;
 
-    return 0;
+    return size;
 }
 
 
-sPkt udp_getrecv(pudp_config udp_config)
+int udp_decode_message(char *message)
 {
     int ret = 0;
     char content_sha256[LENGTH_OF_SHA256];
     char decodedtext[LENGTH_OF_ENCODED_WIFI_MESSAGE];
     char *ciphertext = NULL;
     char *save_ptr = NULL;
-    sPkt empty_pkt;
- 
+    int size = 0;
 
-    sPkt tmp = get_pkt(&udp_config -> Received_Queue);
-
-    if(tmp.is_null == true)
-        return tmp;
-
-    ciphertext = strtok_save(tmp.content, DELIMITER_SEMICOLON, &save_ptr);
+    ciphertext = strtok_save(message, DELIMITER_SEMICOLON, &save_ptr);
     memset(decodedtext, 0, sizeof(decodedtext));
-    if(1 != AES_ECB_Decoder_With_Token_Prefix(ciphertext, decodedtext, sizeof(decodedtext)))
-        return empty_pkt;
+    if(ciphertext == NULL || save_ptr == NULL ||
+       1 != AES_ECB_Decoder_With_Token_Prefix(ciphertext, decodedtext, sizeof(decodedtext)))
+        return udp_decode_error;
 
     memset(content_sha256, 0, sizeof(content_sha256));
     ret = SHA_256_Hash(save_ptr, content_sha256, sizeof(content_sha256));
         
     if(0 != strncmp(decodedtext, content_sha256, strlen(content_sha256)))
-        return empty_pkt;
+        return udp_decode_error;
+
+    size = strlen(save_ptr);
+    memmove(message, save_ptr, size + 1);
+
+    return size;
+}
+
+
+int udp_addpkt(pudp_config udp_config, char *address, unsigned int port, 
+               char *content, int size)
+{
+    char ciphertext[LENGTH_OF_ENCODED_WIFI_MESSAGE];
+
+    size = udp_encode_message(content, ciphertext, sizeof(ciphertext));
+    
+    if(size < 0)
+        return addpkt_msg_oversize;
+
+    addpkt(&udp_config -> pkt_Queue, address, port, ciphertext, size);
+
+    return 0;
+}
+
+
+int udp_getrecv_into(pudp_config udp_config, sPkt *pkt)
+{
+
+    return udp_getrecv_from(udp_config, 0, pkt);
+}
+
+
+int udp_getrecv_from(pudp_config udp_config, int receiver, sPkt *pkt)
+{
+
+    if(get_pkt_into(&udp_config -> receivers[receiver].Received_Queue, pkt) 
+       != pkt_Queue_SUCCESS)
+        return pkt_Queue_is_NULL;
+
+    pkt -> content_size = udp_decode_message(pkt -> content);
+
+    if(pkt -> content_size < 0){
+
+        __atomic_fetch_add(&udp_config -> crypto_failure_count, 1, 
+                           __ATOMIC_RELAXED);
+
+        /* Only the flag is read from a null pkt */
+        pkt -> is_null = true;
+        return pkt_Queue_is_NULL;
+    }
+
+    return pkt_Queue_SUCCESS;
+}
+
+
+sPkt udp_getrecv(pudp_config udp_config)
+{
+    sPkt tmp;
 
-    strcpy(tmp.content, save_ptr);
-    tmp.content_size = strlen(tmp.content);
+    udp_getrecv_into(udp_config, &tmp);
 
     return tmp;
 }
@@ -192,16 +337,25 @@ void *udp_send_pkt_routine(void *udpconfig)
 
     struct sockaddr_in si_send;
 
+    apply_thread_role(THREAD_ROLE_IO);
+
     while((udp_config -> shutdown) == false)
     {
 
         if(!(is_null( &udp_config -> pkt_Queue)))
         {
 
-            current_send_pkt = get_pkt(&udp_config -> pkt_Queue);
+            get_pkt_into(&udp_config -> pkt_Queue, &current_send_pkt);
 
             if(current_send_pkt.is_null == false)
             {
+                if(udp_config -> send_queue_latency != NULL)
+                {
+                    histogram_record(udp_config -> send_queue_latency,
+                                     get_clock_time_in_ns() - 
+                                     current_send_pkt.enqueue_time_in_ns);
+                }
+
                 memset(&si_send, 0, sizeof(si_send));
                 si_send.sin_family = AF_INET;
                 si_send.sin_port   = htons(current_send_pkt.port);
@@ -219,6 +373,8 @@ void *udp_send_pkt_routine(void *udpconfig)
                     current_send_pkt.content_size, 0,
                     (struct sockaddr *)&si_send, sizeof(struct sockaddr)) == -1)
                 {
+                    __atomic_fetch_add(&udp_config -> send_failure_count, 1, 
+                                       __ATOMIC_RELAXED);
 #ifdef debugging
                     zlog_info(category_debug, "sendto error.[%s]\n", strerror(errno));
 #endif
@@ -246,10 +402,90 @@ void *udp_send_pkt_routine(void *udpconfig)
 }
 
 
-void *udp_recv_pkt_routine(void *udpconfig)
+/* Sleeps until the uptime in nanoseconds, yielding instead for the last
+   REPLAY_SPIN_TIME_IN_US so that the pkt is not added a tick late */
+static void wait_until_replay_time(uint64_t due_time_in_ns)
 {
 
-    pudp_config udp_config = (pudp_config) udpconfig;
+    uint64_t now = get_clock_time_in_ns();
+    struct timespec wait_time;
+
+    if(due_time_in_ns > now + REPLAY_SPIN_TIME_IN_US * NS_EACH_US){
+
+        due_time_in_ns -= REPLAY_SPIN_TIME_IN_US * NS_EACH_US;
+        wait_time.tv_sec = due_time_in_ns / NS_EACH_SECOND;
+        wait_time.tv_nsec = due_time_in_ns % NS_EACH_SECOND;
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wait_time, NULL);
+
+        due_time_in_ns += REPLAY_SPIN_TIME_IN_US * NS_EACH_US;
+    }
+
+    while(get_clock_time_in_ns() < due_time_in_ns)
+        sched_yield();
+}
+
+
+/* Adds the pkts of the trace being replayed to the received queue of the
+   receive socket, and releases the trace when it ends */
+static void replay_trace(sudp_receiver *receiver)
+{
+
+    pudp_config udp_config = receiver -> udp_config;
+    PacketTrace *trace = udp_config -> replay_trace;
+    PacketTraceRecord *record = malloc(sizeof(PacketTraceRecord));
+    uint64_t start_time_in_ns = get_clock_time_in_ns();
+
+    while(record != NULL && udp_config -> shutdown == false &&
+          read_packet_trace_record(trace, record) == 0){
+
+        if(udp_config -> replay_speed > 0){
+
+            wait_until_replay_time(start_time_in_ns + 
+                                   (uint64_t)(record -> time_in_ns / 
+                                              udp_config -> replay_speed));
+
+        }else{
+
+            /* As fast as possible, but without dropping pkts the socket 
+               would not have dropped */
+            while(is_full( &receiver -> Received_Queue) == true &&
+                  udp_config -> shutdown == false)
+                sched_yield();
+        }
+
+        addpkt( &receiver -> Received_Queue, record -> address, 
+               record -> port, record -> content, record -> size);
+
+        __atomic_fetch_add( &udp_config -> replayed_count, 1, 
+                           __ATOMIC_RELAXED);
+    }
+
+#ifdef debugging
+    zlog_info(category_debug, "Replayed [%llu] pkts in [%llu] ms",
+              (unsigned long long)trace -> record_count,
+              (unsigned long long)((get_clock_time_in_ns() - 
+                                    start_time_in_ns) / NS_EACH_MS));
+#endif
+
+    free(record);
+
+    close_packet_trace(trace);
+    free(trace);
+
+    __atomic_store_n( &udp_config -> replay_trace, NULL, __ATOMIC_RELEASE);
+
+    __atomic_store_n( &udp_config -> is_replay_claimed, false, 
+                     __ATOMIC_RELEASE);
+}
+
+
+void *udp_recv_pkt_routine(void *udpreceiver)
+{
+
+    sudp_receiver *receiver = (sudp_receiver *) udpreceiver;
+
+    pudp_config udp_config = receiver -> udp_config;
 
     int recv_len;
 
@@ -265,11 +501,22 @@ void *udp_recv_pkt_routine(void *udpconfig)
 
     int socketaddr_len = sizeof(si_recv);
 
+    apply_thread_role(THREAD_ROLE_IO);
 
     /* keep listening for data */
     while((udp_config -> shutdown) == false)
     {
 
+        /* Only one receive thread replays the trace */
+        if(__atomic_load_n( &udp_config -> replay_trace, __ATOMIC_ACQUIRE)
+           != NULL &&
+           __atomic_exchange_n( &udp_config -> is_replay_claimed, true, 
+                               __ATOMIC_ACQ_REL) == false){
+
+            replay_trace(receiver);
+            continue;
+        }
+
         memset(&si_recv, 0, sizeof(si_recv));
 
         memset(&recv_buf, 0, sizeof(char) * MESSAGE_LENGTH);
@@ -279,7 +526,7 @@ void *udp_recv_pkt_routine(void *udpconfig)
         zlog_info(category_debug, "recv pkt.");
 #endif
         /* try to receive some data, this is a non-blocking call */
-        if ((recv_len = recvfrom(udp_config -> recv_socket, recv_buf,
+        if ((recv_len = recvfrom(receiver -> recv_socket, recv_buf,
              MESSAGE_LENGTH, 0, (struct sockaddr *) &si_recv, 
              (socklen_t *)&socketaddr_len)) == -1)
         {
@@ -300,6 +547,20 @@ void *udp_recv_pkt_routine(void *udpconfig)
 
             port = ntohs(si_recv.sin_port);
 
+            /* The lock is only taken while capturing */
+            if(udp_config -> capture_trace != NULL){
+
+                pthread_mutex_lock( &udp_config -> capture_lock);
+
+                if(udp_config -> capture_trace != NULL)
+                    write_packet_trace_record(udp_config -> capture_trace,
+                                              get_clock_time_in_ns(),
+                                              si_recv.sin_addr.s_addr, port,
+                                              recv_buf, recv_len);
+
+                pthread_mutex_unlock( &udp_config -> capture_lock);
+            }
+
 #ifdef debugging
             /* print details of the client/peer and the data received */
             printf("Received packet from %s:%d\n", address_ntoa, port);
@@ -308,7 +569,7 @@ void *udp_recv_pkt_routine(void *udpconfig)
             printf("]\n");
             printf("Data Length %d\n", recv_len);
 #endif
-            addpkt(&udp_config -> Received_Queue, address_ntoa, port,
+            addpkt(&receiver -> Received_Queue, address_ntoa, port,
                    recv_buf, recv_len);
         }
 #ifdef debugging
@@ -324,26 +585,119 @@ void *udp_recv_pkt_routine(void *udpconfig)
 }
 
 
+int udp_start_capture(pudp_config udp_config, char *file_name)
+{
+
+    PacketTrace *trace = malloc(sizeof(PacketTrace));
+
+    if(trace == NULL)
+        return packet_trace_open_error;
+
+    if(open_packet_trace_writer(trace, file_name) != 0){
+        free(trace);
+        return packet_trace_open_error;
+    }
+
+    pthread_mutex_lock( &udp_config -> capture_lock);
+
+    if(udp_config -> capture_trace != NULL){
+
+        close_packet_trace(udp_config -> capture_trace);
+        free(udp_config -> capture_trace);
+    }
+
+    udp_config -> capture_trace = trace;
+
+    pthread_mutex_unlock( &udp_config -> capture_lock);
+
+    return 0;
+}
+
+
+void udp_stop_capture(pudp_config udp_config)
+{
+
+    pthread_mutex_lock( &udp_config -> capture_lock);
+
+    if(udp_config -> capture_trace != NULL){
+
+        close_packet_trace(udp_config -> capture_trace);
+        free(udp_config -> capture_trace);
+
+        udp_config -> capture_trace = NULL;
+    }
+
+    pthread_mutex_unlock( &udp_config -> capture_lock);
+}
+
+
+int udp_start_replay(pudp_config udp_config, char *file_name, double speed)
+{
+
+    PacketTrace *trace = NULL;
+    struct sockaddr_in si_wakeup;
+
+    if(__atomic_load_n( &udp_config -> replay_trace, __ATOMIC_ACQUIRE) 
+       != NULL)
+        return packet_trace_open_error;
+
+    trace = malloc(sizeof(PacketTrace));
+    if(trace == NULL)
+        return packet_trace_open_error;
+
+    if(open_packet_trace_reader(trace, file_name) != 0){
+        free(trace);
+        return packet_trace_format_error;
+    }
+
+    udp_config -> replay_speed = speed;
+
+    /* The receive thread takes the trace over from here */
+    __atomic_store_n( &udp_config -> replay_trace, trace, __ATOMIC_RELEASE);
+
+    /* An empty datagram wakes a receive thread up from its socket */
+    memset(&si_wakeup, 0, sizeof(si_wakeup));
+    si_wakeup.sin_family = AF_INET;
+    si_wakeup.sin_port = htons(udp_config -> recv_port);
+    si_wakeup.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    sendto(udp_config -> send_socket, "", 0, 0, 
+           (struct sockaddr *)&si_wakeup, sizeof(si_wakeup));
+
+    return 0;
+}
+
+
 int udp_release(pudp_config udp_config)
 {
 
+    int i;
+
     udp_config -> shutdown = true;
 
+    udp_stop_capture(udp_config);
+
 #ifdef _WIN32
     closesocket(udp_config -> send_socket);
 
-    closesocket(udp_config -> recv_socket);
+    for(i = 0; i < udp_config -> number_receivers; i++)
+        closesocket(udp_config -> receivers[i].recv_socket);
     
     WSACleanup();
 #else
     close(udp_config -> send_socket);
 
-    close(udp_config -> recv_socket);
+    for(i = 0; i < udp_config -> number_receivers; i++)
+        close(udp_config -> receivers[i].recv_socket);
 #endif
 
     Free_Packet_Queue( &udp_config -> pkt_Queue);
 
-    Free_Packet_Queue( &udp_config -> Received_Queue);
+    for(i = 0; i < udp_config -> number_receivers; i++)
+        Free_Packet_Queue( &udp_config -> receivers[i].Received_Queue);
+
+    /* The receive threads may still be leaving recvfrom, so the receivers
+       are kept until the process ends, as the received queues are */
 
     return 0;
 }
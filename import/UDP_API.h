@@ -42,6 +42,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <pthread.h>
+#include <sched.h>
 #include <errno.h>
 
 #ifdef _MSC_VER
@@ -55,7 +56,10 @@
 #endif
 
 #include "Common.h"
+#include "Histogram.h"
+#include "PacketTrace.h"
 #include "pkt_Queue.h"
+#include "ThreadProfile.h"
 
 
 /* The time interval in seconds for Select() break the block */
@@ -67,6 +71,13 @@
 /* The time in milliseconds for the receive thread to sleep when it is idle */
 #define RECEIVE_THREAD_IDLE_SLEEP_TIME 50
 
+/* The time in microseconds before the due time of a replayed pkt at which
+   the receive thread stops sleeping and yields until the pkt is due */
+#define REPLAY_SPIN_TIME_IN_US 200
+
+/* The maximal number of sockets receiving on the same port */
+#define MAX_NUMBER_RECEIVE_SOCKETS 16
+
 #define DELIMITER_SEMICOLON ";"
 
 #define LENGTH_OF_SHA256 512
@@ -76,7 +87,24 @@
 /* When debugging is needed */
 //#define debugging
 
+struct _sudp_config;
+
+/* A socket receiving on the port of the UDP connection, with its own thread
+   and received queue */
 typedef struct {
+
+    int recv_socket;
+
+    pthread_t udp_receive_thread;
+
+    spkt_ptr Received_Queue;
+
+    /* The UDP connection the socket belongs to */
+    struct _sudp_config *udp_config;
+
+} sudp_receiver;
+
+typedef struct _sudp_config {
     
 #ifdef _WIN32
     WSADATA wsaData;
@@ -88,16 +116,59 @@ typedef struct {
 
     int optval;
 
-    int  send_socket, recv_socket;
+    int  send_socket;
 
     int recv_port;
 
-    pthread_t udp_send_thread, udp_receive_thread;
+    pthread_t udp_send_thread;
 
    /* The flag set to true whwn the process need to stop */
     bool shutdown;
 
-    spkt_ptr pkt_Queue, Received_Queue;
+    spkt_ptr pkt_Queue;
+
+    /* The sockets receiving on recv_port. When there are more than one, 
+       they share the port by SO_REUSEPORT and the kernel hashes the 
+       datagrams to them by source address and port, so the datagrams from 
+       one sender are always received by the same socket in order. */
+    int number_receivers;
+
+    /* The array of number_receivers receive sockets. It is allocated by 
+       udp_initial, because each received queue takes the memory of 
+       MAX_QUEUE_LENGTH pkts. */
+    sudp_receiver *receivers;
+
+    /* The histogram to record the time pkts wait in the send queue, or NULL
+       if the time is not recorded */
+    Histogram *send_queue_latency;
+
+    /* The number of received pkts dropped because their token or hash 
+       cannot be verified */
+    uint64_t crypto_failure_count;
+
+    /* The number of pkts failed to be sent by the socket */
+    uint64_t send_failure_count;
+
+    /* The lock for starting and stopping the capture */
+    pthread_mutex_t capture_lock;
+
+    /* The trace the pkts received from the socket are captured to, or NULL
+       if the pkts are not captured */
+    PacketTrace *capture_trace;
+
+    /* The trace replayed by a receive thread instead of receiving from 
+       its socket, or NULL if no trace is being replayed */
+    PacketTrace *replay_trace;
+
+    /* The flag set to true by the receive thread replaying the trace */
+    bool is_replay_claimed;
+
+    /* The speed of the replay relative to the capture, or 0 if the trace is
+       replayed as fast as the receive queue is drained */
+    double replay_speed;
+
+    /* The number of pkts replayed from traces */
+    uint64_t replayed_count;
 
 } sudp_config;
 
@@ -110,7 +181,9 @@ enum{
    recv_socket_error = -3,
    set_socketopt_error = -4,
    recv_socket_bind_error = -5,
-   addpkt_msg_oversize = -6
+   addpkt_msg_oversize = -6,
+   udp_decode_error = -7,
+   receiver_number_error = -8
    };
 
 
@@ -132,6 +205,32 @@ enum{
 int udp_initial(pudp_config udp_config, int recv_port);
 
 
+/*
+  udp_initial_with_receivers
+
+     For initialize UDP Socket with a number of sockets receiving on the 
+     port, each with its own receive thread and received queue.
+
+  Parameter:
+
+     udp_config       : The pointer points to the structure contains all 
+                        variables for the UDP connection.
+     recv_port        : The port to receive on.
+     number_receivers : The number of receive sockets, from 1 to 
+                        MAX_NUMBER_RECEIVE_SOCKETS.
+     queue_capacity   : The number of pkts in the send queue and in each
+                        received queue, a power of two from 2 to 
+                        MAX_QUEUE_LENGTH.
+
+  Return Value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , somthing wrong.
+ */
+int udp_initial_with_receivers(pudp_config udp_config, int recv_port, 
+                               int number_receivers, int queue_capacity);
+
+
 /*
   udp_addpkt_without_encoding
 
@@ -172,6 +271,47 @@ int udp_addpkt_without_encoding(pudp_config udp_config, char *address, unsigned
  */
 sPkt udp_getrecv_without_encoding(pudp_config udp_config);
 
+/*
+  udp_encode_message
+
+     This function frames the content as it is sent over Wi-Fi: the SHA-256 
+     hash of the content encrypted with the token prefix, a semicolon and the
+     content.
+
+  Parameter:
+
+     content      : The pointer points to the content to be framed.
+     message      : The pointer points to the buffer of the framed message.
+     message_size : The size of the buffer.
+
+  Return Value:
+
+     int : The size of the framed message if not negative.
+           If return addpkt_msg_oversize, the message does not fit.
+ */
+int udp_encode_message(char *content, char *message, int message_size);
+
+
+/*
+  udp_decode_message
+
+     This function verifies a message framed by udp_encode_message and moves
+     its content to the beginning of the message.
+
+  Parameter:
+
+     message : The pointer points to the received message, terminated by a 
+               null character.
+
+  Return Value:
+
+     int : The size of the content if not negative.
+           If return udp_decode_error, the token or the hash cannot be 
+           verified.
+ */
+int udp_decode_message(char *message);
+
+
 /*
   udp_addpkt
 
@@ -212,6 +352,52 @@ int udp_addpkt(pudp_config udp_config, char *address, unsigned int port,
 sPkt udp_getrecv(pudp_config udp_config);
 
 
+/*
+  udp_getrecv_into
+
+     This function is used for get received packet from the received queue
+     of the first receive socket into a pkt of the caller, without copying 
+     the pkt when it is returned.
+
+  Parameter:
+
+     udp_config : The pointer points to the  structure contains all variables   
+                  for the UDP connection.
+     pkt        : The pointer points to the pkt to copy the packet into.
+
+  Return Value:
+
+     int : If return pkt_Queue_SUCCESS, a packet is got.
+           If return pkt_Queue_is_NULL, the received queue is empty or the
+           packet cannot be verified, and the is_null flag of the pkt is 
+           set.
+ */
+int udp_getrecv_into(pudp_config udp_config, sPkt *pkt);
+
+
+/*
+  udp_getrecv_from
+
+     This function is used for get received packet from the received queue
+     of a receive socket into a pkt of the caller.
+
+  Parameter:
+
+     udp_config : The pointer points to the  structure contains all variables   
+                  for the UDP connection.
+     receiver   : The index of the receive socket.
+     pkt        : The pointer points to the pkt to copy the packet into.
+
+  Return Value:
+
+     int : If return pkt_Queue_SUCCESS, a packet is got.
+           If return pkt_Queue_is_NULL, the received queue is empty or the
+           packet cannot be verified, and the is_null flag of the pkt is 
+           set.
+ */
+int udp_getrecv_from(pudp_config udp_config, int receiver, sPkt *pkt);
+
+
 /*
   udp_send_pkt_routine
 
@@ -232,18 +418,83 @@ void *udp_send_pkt_routine(void *udpconfig);
 /*
   udp_recv_pkt_routine
 
-     The thread for receiving packets.
+     The thread for receiving packets from a receive socket.
 
   Parameter:
 
-     udpconfig: The pointer points to the structure contains all variables for  
-                the UDP connection.
+     udpreceiver: The pointer points to the receive socket.
+
+  Return Value:
+
+     None
+ */
+void *udp_recv_pkt_routine(void *udpreceiver);
+
+
+/*
+  udp_start_capture
+
+     This function starts capturing the pkts received from the socket to a
+     trace, with the time they are received and their source addresses.
+
+  Parameter:
+
+     udp_config : The pointer points to the structure contains all variables
+                  for the UDP connection.
+     file_name  : The name of the trace file to be created.
+
+  Return Value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the trace cannot be created.
+ */
+int udp_start_capture(pudp_config udp_config, char *file_name);
+
+
+/*
+  udp_stop_capture
+
+     This function stops capturing and closes the trace, if any.
+
+  Parameter:
+
+     udp_config : The pointer points to the structure contains all variables
+                  for the UDP connection.
 
   Return Value:
 
      None
  */
-void *udp_recv_pkt_routine(void *udpconfig);
+void udp_stop_capture(pudp_config udp_config);
+
+
+/*
+  udp_start_replay
+
+     This function lets a receive thread replay a trace into its received
+     queue instead of receiving from its socket. Pkts are added at the times
+     they were captured scaled by the speed, and pkts arriving at the socket
+     meanwhile are left to the socket buffer. When the trace ends, the 
+     receive thread goes back to the socket. With more than one receive 
+     socket, the whole trace is replayed by whichever receive thread is 
+     woken up first, so the pkts of every sender keep their order.
+
+  Parameter:
+
+     udp_config : The pointer points to the structure contains all variables
+                  for the UDP connection.
+     file_name  : The name of the trace file.
+     speed      : The speed relative to the capture, such as 1 for the
+                  captured timing and 10 for ten times faster, or 0 to add
+                  the pkts as fast as the received queue is drained.
+
+  Return Value:
+
+     int : If return 0, everything work successfully.
+           If not 0   , the trace cannot be opened or another trace is 
+                        being replayed.
+ */
+int udp_start_replay(pudp_config udp_config, char *file_name, double speed);
 
 
 /*
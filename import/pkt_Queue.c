@@ -36,28 +36,274 @@
 #include "pkt_Queue.h"
 
 
+/* Raise the high-water mark of the queue to the length if it is larger */
+static void update_high_water_mark(pkt_ptr pkt_queue, int length)
+{
+
+    int high_water_mark = __atomic_load_n(&pkt_queue -> high_water_mark, 
+                                          __ATOMIC_RELAXED);
+
+    while(length > high_water_mark)
+    {
+        if(__atomic_compare_exchange_n(&pkt_queue -> high_water_mark, 
+                                       &high_water_mark, length, true, 
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+    }
+}
+
+
+/* Copy a pkt into a location of the ring. Only the used part of the content 
+   is copied and terminated, instead of clearing the whole content. */
+static void write_pkt(pPkt pkt, char *address, unsigned int port, 
+                      char *content, int content_size)
+{
+
+    pkt -> is_null = false;
+
+    strncpy(pkt -> address, address, NETWORK_ADDR_LENGTH);
+
+    pkt -> port = port;
+
+    strncpy(pkt -> content, content, content_size);
+
+    if(content_size < MESSAGE_LENGTH)
+        pkt -> content[content_size] = '\0';
+
+    pkt -> content_size = content_size;
+
+    pkt -> enqueue_time_in_ns = get_clock_time_in_ns();
+}
+
+
+/* Copy a pkt out of a location of the ring, in the same way as write_pkt */
+static void read_pkt(pPkt pkt, pPkt destination)
+{
+
+    destination -> is_null = false;
+
+    memcpy(destination -> address, pkt -> address, NETWORK_ADDR_LENGTH);
+
+    destination -> port = pkt -> port;
+
+    memcpy(destination -> content, pkt -> content, pkt -> content_size);
+
+    if(pkt -> content_size < MESSAGE_LENGTH)
+        destination -> content[pkt -> content_size] = '\0';
+
+    destination -> content_size = pkt -> content_size;
+
+    destination -> enqueue_time_in_ns = pkt -> enqueue_time_in_ns;
+}
+
+
+/* Reserve a location for a new pkt. The location is returned as the value 
+   of tail it was reserved at, or -1 if the pkt queue is full. */
+static int64_t reserve_location(pkt_ptr pkt_queue)
+{
+
+    uint64_t position;
+
+    uint64_t sequence;
+
+    int64_t difference;
+
+    switch(pkt_queue -> type)
+    {
+        case PKT_QUEUE_SPSC:
+
+            /* Only this thread writes tail, and the acquire load of head 
+               makes sure the consumer has finished copying the location */
+            position = __atomic_load_n(&pkt_queue -> tail, __ATOMIC_RELAXED);
+
+            if(position - __atomic_load_n(&pkt_queue -> head, 
+                                          __ATOMIC_ACQUIRE) >= 
+               pkt_queue -> capacity)
+                return -1;
+
+            return (int64_t)position;
+
+        case PKT_QUEUE_MPSC:
+
+            position = __atomic_load_n(&pkt_queue -> tail, __ATOMIC_RELAXED);
+
+            while(true)
+            {
+                sequence = __atomic_load_n(
+                    &pkt_queue -> sequence[position & pkt_queue -> index_mask], 
+                    __ATOMIC_ACQUIRE);
+
+                difference = (int64_t)(sequence - position);
+
+                if(difference == 0)
+                {
+                    /* The location is free, reserve it unless another 
+                       producer has reserved it first */
+                    if(__atomic_compare_exchange_n(&pkt_queue -> tail, 
+                                                   &position, position + 1, 
+                                                   true, __ATOMIC_RELAXED, 
+                                                   __ATOMIC_RELAXED))
+                        return (int64_t)position;
+                }
+                else if(difference < 0)
+                {
+                    /* The consumer has not got the pkt a lap ago */
+                    return -1;
+                }
+                else
+                {
+                    position = __atomic_load_n(&pkt_queue -> tail, 
+                                               __ATOMIC_RELAXED);
+                }
+            }
+
+        default:
+
+            position = pkt_queue -> tail;
+
+            if(position - pkt_queue -> head >= pkt_queue -> capacity)
+                return -1;
+
+            return (int64_t)position;
+    }
+}
+
+
+/* Make the pkt written to a reserved location visible to the consumer */
+static void publish_location(pkt_ptr pkt_queue, uint64_t position)
+{
+
+    switch(pkt_queue -> type)
+    {
+        case PKT_QUEUE_SPSC:
+
+            __atomic_store_n(&pkt_queue -> tail, position + 1, 
+                             __ATOMIC_RELEASE);
+            break;
+
+        case PKT_QUEUE_MPSC:
+
+            __atomic_store_n(
+                &pkt_queue -> sequence[position & pkt_queue -> index_mask], 
+                position + 1, __ATOMIC_RELEASE);
+            break;
+
+        default:
+
+            pkt_queue -> tail = position + 1;
+            break;
+    }
+}
+
+
+/* Find the location of the first pkt. The location is returned as the value 
+   of head, or -1 if no pkt is ready to be got. */
+static int64_t first_location(pkt_ptr pkt_queue)
+{
+
+    uint64_t position = __atomic_load_n(&pkt_queue -> head, 
+                                        __ATOMIC_RELAXED);
+
+    switch(pkt_queue -> type)
+    {
+        case PKT_QUEUE_SPSC:
+
+            if(position == __atomic_load_n(&pkt_queue -> tail, 
+                                           __ATOMIC_ACQUIRE))
+                return -1;
+
+            return (int64_t)position;
+
+        case PKT_QUEUE_MPSC:
+
+            /* The location may be reserved but not yet published */
+            if(__atomic_load_n(
+                   &pkt_queue -> sequence[position & pkt_queue -> index_mask], 
+                   __ATOMIC_ACQUIRE) != position + 1)
+                return -1;
+
+            return (int64_t)position;
+
+        default:
+
+            if(position == pkt_queue -> tail)
+                return -1;
+
+            return (int64_t)position;
+    }
+}
+
+
+/* Give the location of the first pkt back to the producers */
+static void release_location(pkt_ptr pkt_queue, uint64_t position)
+{
+
+    if(pkt_queue -> type == PKT_QUEUE_MPSC)
+    {
+        /* The location can be reserved again a lap later */
+        __atomic_store_n(&pkt_queue -> sequence[position & pkt_queue -> index_mask],
+                         position + pkt_queue -> capacity, __ATOMIC_RELEASE);
+    }
+
+    __atomic_store_n(&pkt_queue -> head, position + 1, __ATOMIC_RELEASE);
+}
+
+
 /* Initialize and free Queue */
 
 
 int init_Packet_Queue(pkt_ptr pkt_queue)
+{
+
+    return init_Packet_Queue_with_type(pkt_queue, PKT_QUEUE_LOCKED);
+}
+
+
+int init_Packet_Queue_with_type(pkt_ptr pkt_queue, PktQueueType type)
+{
+
+    return init_Packet_Queue_with_capacity(pkt_queue, type, MAX_QUEUE_LENGTH);
+}
+
+
+int init_Packet_Queue_with_capacity(pkt_ptr pkt_queue, PktQueueType type,
+                                    int capacity)
 {
     /* The variable for initializing the pkt queue  */
     int num;
 
+    if(capacity < 2 || capacity > MAX_QUEUE_LENGTH || 
+       (capacity & (capacity - 1)) != 0)
+        return pkt_Queue_capacity_error;
+
     pthread_mutex_init( &pkt_queue -> mutex, 0);
 
     pthread_mutex_lock( &pkt_queue -> mutex);
 
     pkt_queue -> is_free = false;
 
-    pkt_queue -> front = -1;
+    pkt_queue -> type = type;
+
+    pkt_queue -> capacity = capacity;
+
+    pkt_queue -> index_mask = capacity - 1;
+
+    pkt_queue -> head = 0;
 
-    pkt_queue -> rear  = -1;
+    pkt_queue -> tail = 0;
+
+    pkt_queue -> full_drop_count = 0;
+
+    pkt_queue -> high_water_mark = 0;
 
     /* Initialize all flags in the pkt queue  */
-    for(num = 0;num < MAX_QUEUE_LENGTH; num ++)
+    for(num = 0;num < capacity; num ++)
+    {
         pkt_queue -> Queue[num].is_null = true;
 
+        pkt_queue -> sequence[num] = num;
+    }
+
     pthread_mutex_unlock( &pkt_queue -> mutex);
 
     return pkt_Queue_SUCCESS;
@@ -72,14 +318,14 @@ int Free_Packet_Queue(pkt_ptr pkt_queue)
 
     pthread_mutex_lock( &pkt_queue -> mutex);
 
-    pkt_queue -> is_free = true;
+    __atomic_store_n(&pkt_queue -> is_free, true, __ATOMIC_RELEASE);
 
     /* Delete all pkts in the pkt queue */
-    while (is_null(pkt_queue) == false)
+    while (first_location(pkt_queue) != -1)
         delpkt(pkt_queue);
 
     /* Reset all flags in the pkt queue */
-    for(num = 0;num < MAX_QUEUE_LENGTH; num ++)
+    for(num = 0;num < pkt_queue -> capacity; num ++)
         pkt_queue -> Queue[num].is_null = true;
 
     pthread_mutex_unlock( &pkt_queue -> mutex);
@@ -98,16 +344,20 @@ int addpkt(pkt_ptr pkt_queue, char *address, unsigned int port,
            char *content, int content_size)
 {
 
-    int current_idx;
+    int64_t position;
+
+    bool is_locked = (pkt_queue -> type == PKT_QUEUE_LOCKED);
 
     if(content_size > MESSAGE_LENGTH)
         return MESSAGE_OVERSIZE;
 
-    pthread_mutex_lock( &pkt_queue -> mutex);
+    if(is_locked)
+        pthread_mutex_lock( &pkt_queue -> mutex);
 
-    if(pkt_queue -> is_free == true)
+    if(__atomic_load_n(&pkt_queue -> is_free, __ATOMIC_ACQUIRE) == true)
     {
-        pthread_mutex_unlock( &pkt_queue -> mutex);
+        if(is_locked)
+            pthread_mutex_unlock( &pkt_queue -> mutex);
         return pkt_Queue_is_free;
     }
 
@@ -126,55 +376,27 @@ int addpkt(pkt_ptr pkt_queue, char *address, unsigned int port,
     printf("---------------------------\n");
 #endif
 
-    if(is_full(pkt_queue) == true)
+    position = reserve_location(pkt_queue);
+
+    if(position == -1)
     {
         /* If the pkt queue is full */
-        pthread_mutex_unlock( &pkt_queue -> mutex);
+        __atomic_fetch_add(&pkt_queue -> full_drop_count, 1, 
+                           __ATOMIC_RELAXED);
+        if(is_locked)
+            pthread_mutex_unlock( &pkt_queue -> mutex);
         return pkt_Queue_FULL;
     }
-    else if(is_null(pkt_queue) == true)
-    {
-        /* If there is no pkt in the pkt queue */
-        pkt_queue -> front = 0;
-        pkt_queue -> rear  = 0;
-    }
-    else if( pkt_queue -> rear == MAX_QUEUE_LENGTH - 1)
-    {
-        /* If the rear points to the end of the queue reset the location to the 
-           first location of the pkt queue 
-         */
-        pkt_queue -> rear = 0;
-    }
-    else
-    {
-        /* If the rear not points to the end of the pkt queue move to the next 
-           location of the pkt queue 
-         */
-        pkt_queue -> rear ++;
-    }
-
-    current_idx = pkt_queue -> rear;
-
-    pkt_queue -> Queue[current_idx].is_null = false;
 
-    memset(pkt_queue -> Queue[current_idx].address, 0, 
-           NETWORK_ADDR_LENGTH * sizeof(char));
+    write_pkt(&pkt_queue -> Queue[position & pkt_queue -> index_mask], address, 
+              port, content, content_size);
 
-    strncpy(pkt_queue -> Queue[current_idx].address, address, 
-            NETWORK_ADDR_LENGTH);
+    publish_location(pkt_queue, position);
 
-    pkt_queue -> Queue[current_idx].port = port;
-
-    memset(pkt_queue -> Queue[current_idx].content, 0, 
-           MESSAGE_LENGTH * sizeof(char));
-
-    strncpy(pkt_queue -> Queue[current_idx].content, content, 
-            content_size);
-
-    pkt_queue -> Queue[current_idx].content_size = content_size;
+    update_high_water_mark(pkt_queue, queue_len(pkt_queue));
 
 #ifdef debugging
-    display_pkt("addedpkt", pkt_queue, current_idx);
+    display_pkt("addedpkt", pkt_queue, position & pkt_queue -> index_mask);
 
     printf("= pkt_queue len  =\n");
 
@@ -183,7 +405,8 @@ int addpkt(pkt_ptr pkt_queue, char *address, unsigned int port,
     printf("==================\n");
 #endif
 
-    pthread_mutex_unlock( &pkt_queue -> mutex);
+    if(is_locked)
+        pthread_mutex_unlock( &pkt_queue -> mutex);
 
     return pkt_Queue_SUCCESS;
 
@@ -195,30 +418,51 @@ sPkt get_pkt(pkt_ptr pkt_queue)
 
     sPkt tmp;
 
-    pthread_mutex_lock( &pkt_queue -> mutex);
-
-    memset(&tmp, 0, sizeof(tmp));
-
-    if(is_null(pkt_queue) == true)
+    if(get_pkt_into(pkt_queue, &tmp) == pkt_Queue_is_NULL)
     {
         /* If the pkt queue is null, return a blank pkt */
+        memset(&tmp, 0, sizeof(tmp));
+
         tmp.is_null = true;
+    }
 
-        pthread_mutex_unlock( &pkt_queue -> mutex);
-        return tmp;
+    return tmp;
+}
+
+
+int get_pkt_into(pkt_ptr pkt_queue, pPkt pkt)
+{
+
+    int64_t position;
+
+    bool is_locked = (pkt_queue -> type == PKT_QUEUE_LOCKED);
+
+    if(is_locked)
+        pthread_mutex_lock( &pkt_queue -> mutex);
+
+    position = first_location(pkt_queue);
+
+    if(position == -1)
+    {
+        pkt -> is_null = true;
+
+        if(is_locked)
+            pthread_mutex_unlock( &pkt_queue -> mutex);
+        return pkt_Queue_is_NULL;
     }
 
 #ifdef debugging
-    display_pkt("Get_pkt", pkt_queue, pkt_queue -> front);
+    display_pkt("Get_pkt", pkt_queue, position & pkt_queue -> index_mask);
 #endif
 
-    tmp = pkt_queue -> Queue[pkt_queue -> front];
+    read_pkt(&pkt_queue -> Queue[position & pkt_queue -> index_mask], pkt);
 
     delpkt(pkt_queue);
 
-    pthread_mutex_unlock( &pkt_queue -> mutex);
+    if(is_locked)
+        pthread_mutex_unlock( &pkt_queue -> mutex);
 
-    return tmp;
+    return pkt_Queue_SUCCESS;
 }
 
 
@@ -228,39 +472,20 @@ sPkt get_pkt(pkt_ptr pkt_queue)
 int delpkt(pkt_ptr pkt_queue) 
 {
 
-    int current_idx;
+    int64_t position = first_location(pkt_queue);
 
-    if(is_null(pkt_queue) == true) 
+    if(position == -1) 
     {
         return pkt_Queue_SUCCESS;
     }
 
-    current_idx = pkt_queue -> front;
-
 #ifdef debugging
-    display_pkt("deledpkt", pkt_queue, current_idx);
+    display_pkt("deledpkt", pkt_queue, position & pkt_queue -> index_mask);
 #endif
 
-    pkt_queue -> Queue[current_idx].is_null = true;
-
-    memset(pkt_queue -> Queue[current_idx].content, 0, 
-           MESSAGE_LENGTH * sizeof(char));
-
-    memset(pkt_queue -> Queue[current_idx].address, 0, 
-           NETWORK_ADDR_LENGTH * sizeof(char));
-
-    pkt_queue -> Queue[current_idx].port = 0;
-
-    if(current_idx == pkt_queue -> rear)
-    {
-        pkt_queue -> front = -1;
+    pkt_queue -> Queue[position & pkt_queue -> index_mask].is_null = true;
 
-        pkt_queue -> rear  = -1;
-    }
-    else if(current_idx == MAX_QUEUE_LENGTH - 1)
-        pkt_queue -> front = 0;
-    else
-        pkt_queue -> front += 1;
+    release_location(pkt_queue, position);
 
 #ifdef debugging
 
@@ -282,7 +507,7 @@ int display_pkt(char *display_title, pkt_ptr pkt_queue, int pkt_num)
 
     pPkt current_pkt;
 
-    if(pkt_num < 0 || pkt_num >= MAX_QUEUE_LENGTH)
+    if(pkt_num < 0 || pkt_num >= pkt_queue -> capacity)
     {
         return pkt_Queue_display_over_range;
     }
@@ -320,60 +545,42 @@ int display_pkt(char *display_title, pkt_ptr pkt_queue, int pkt_num)
 bool is_null(pkt_ptr pkt_queue)
 {
 
-    if (pkt_queue->front == -1 && pkt_queue->rear == -1)
-        return true;
-
-    return false;
+    return queue_len(pkt_queue) == 0;
 }
 
 
 bool is_full(pkt_ptr pkt_queue)
 {
 
-    if(pkt_queue -> front == pkt_queue -> rear + 1)
-        
-        return true;
-
-    else if(pkt_queue -> front == 0 && 
-            pkt_queue -> rear == MAX_QUEUE_LENGTH - 1)
-        
-        return true;
-
-    else
-        
-        return false;
+    return queue_len(pkt_queue) >= pkt_queue -> capacity;
 }
 
 
 int queue_len(pkt_ptr pkt_queue)
 {
 
-    if (pkt_queue -> front == 0 && pkt_queue -> rear == 0)
-        return 1;
+    uint64_t head;
 
-    else if(pkt_queue -> front == -1 && pkt_queue -> rear == -1)
-        return 0;
+    uint64_t tail;
 
-    else if (pkt_queue -> front == pkt_queue -> rear)
-        return 1;
+    /* head is read first, so that a pkt got in between cannot make the 
+       length negative */
+    head = __atomic_load_n(&pkt_queue -> head, __ATOMIC_ACQUIRE);
 
-    else if (pkt_queue -> rear > pkt_queue -> front){
+    tail = __atomic_load_n(&pkt_queue -> tail, __ATOMIC_ACQUIRE);
 
-        int len = (pkt_queue -> rear - pkt_queue -> front + 1);
-        return len;
-    }
+    if(tail - head > pkt_queue -> capacity)
+        return pkt_queue -> capacity;
 
-    else if (pkt_queue -> front > pkt_queue -> rear){
+    return (int)(tail - head);
+}
 
-        int len = ((MAX_QUEUE_LENGTH - pkt_queue -> front) + 
-                   pkt_queue -> rear + 1);
-        return len;
-    }
 
-    else
-        return queue_len_error;
+int reset_high_water_mark(pkt_ptr pkt_queue)
+{
 
-    return queue_len_error;
+    return __atomic_exchange_n(&pkt_queue -> high_water_mark, 
+                               queue_len(pkt_queue), __ATOMIC_RELAXED);
 }
 
 
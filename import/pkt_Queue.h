@@ -14,6 +14,15 @@
 
      This file contains the header of function declarations used in pkt_Queue.c
 
+     The pkt queue is a ring of up to MAX_QUEUE_LENGTH pkts addressed by two
+     counters which only increase: head counts the pkts got from the queue 
+     and tail the pkts added to it, so the queue is empty when they are equal
+     and full when they are the capacity of the queue apart. Besides the queue guarded 
+     by the mutex, a queue with a single producer and a single consumer, and 
+     a queue with multiple producers and a single consumer, are synchronized 
+     without locks. The counters are kept in separate cache lines, so that 
+     the producers and the consumer do not invalidate each other's line.
+
   Version:
 
      2.0, 20190608
@@ -41,6 +50,8 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
+#include "Clock.h"
 
 #ifdef _WIN32
 #include <windows.h>
@@ -59,9 +70,18 @@
  */
 #define MESSAGE_LENGTH 65507
 
-/* The maximum length of the pkt Queue. */
+/* The maximum length of the pkt Queue, which is also the capacity of a 
+   queue initialized without one. It must be a power of two, so that the 
+   counters of the queue are mapped to the ring with a mask. */
 #define MAX_QUEUE_LENGTH 512
 
+#if (MAX_QUEUE_LENGTH & (MAX_QUEUE_LENGTH - 1)) != 0
+#error "MAX_QUEUE_LENGTH must be a power of two"
+#endif
+
+/* The size in bytes of a cache line */
+#define CACHE_LINE_SIZE 64
+
 enum{ 
     pkt_Queue_SUCCESS = 0, 
     pkt_Queue_FULL = -1, 
@@ -69,10 +89,29 @@ enum{
     pkt_Queue_is_free = -3, 
     pkt_Queue_is_NULL = -4, 
     pkt_Queue_display_over_range = -5, 
-    MESSAGE_OVERSIZE = -6
+    MESSAGE_OVERSIZE = -6,
+    pkt_Queue_capacity_error = -7
     };
 
 
+/* The kinds of synchronization of the pkt queue */
+typedef enum _PktQueueType {
+
+    /* Any number of threads add and get pkts under the mutex */
+    PKT_QUEUE_LOCKED = 0,
+
+    /* A single thread adds pkts and a single thread gets pkts, without 
+       locks */
+    PKT_QUEUE_SPSC = 1,
+
+    /* Any number of threads add pkts and a single thread gets pkts, without 
+       locks. The producers reserve locations by compare-and-swap on tail and
+       publish the pkts through the sequence numbers of the locations. */
+    PKT_QUEUE_MPSC = 2
+
+} PktQueueType;
+
+
 /* packet format */
 typedef struct pkt {
 
@@ -91,6 +130,9 @@ typedef struct pkt {
     /* The size of the current pkt */
     int  content_size;
 
+    /* The uptime in nanoseconds at which the pkt was added to the queue */
+    uint64_t enqueue_time_in_ns;
+
 } sPkt;
 
 typedef sPkt *pPkt;
@@ -98,11 +140,28 @@ typedef sPkt *pPkt;
 
 typedef struct pkt_header {
 
-    /* front store the location of the first of thr Pkt Queue */
-    int front;
+    /* The number of pkts got from the queue. It is written by the consumer 
+       only. */
+    uint64_t head __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    /* The number of pkts added to the queue, or reserved by the producers of 
+       a PKT_QUEUE_MPSC queue */
+    uint64_t tail __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    /* The kind of synchronization of the queue */
+    PktQueueType type __attribute__((aligned(CACHE_LINE_SIZE)));
+
+    /* The number of pkts the queue holds, a power of two no larger than 
+       MAX_QUEUE_LENGTH */
+    int capacity;
 
-    /* rear  store the location of the end of the Pkt Queue */
-    int rear;
+    /* The mask mapping a counter of the queue to a location in the ring */
+    uint64_t index_mask;
+
+    /* The sequence number of each location of a PKT_QUEUE_MPSC queue. It is
+       the value of tail at which the location can be reserved, or that value 
+       plus one once the pkt in the location is published. */
+    uint64_t sequence[MAX_QUEUE_LENGTH];
 
     /* The array is used to store pkts. */
     sPkt Queue[MAX_QUEUE_LENGTH];
@@ -110,9 +169,17 @@ typedef struct pkt_header {
     /* If the pkt queue is initialized, the flag will set to false */
     bool is_free;
 
-    /* The mutex is used to read/write lock before processing the pkt queue */
+    /* The mutex is used to read/write lock before processing the pkt queue 
+       of PKT_QUEUE_LOCKED, and to free the pkt queue of any kind */
     pthread_mutex_t mutex;
 
+    /* The number of pkts dropped because the pkt queue is full */
+    uint64_t full_drop_count;
+
+    /* The largest number of pkts in the queue since the high-water mark was
+       reset */
+    int high_water_mark;
+
 } spkt_ptr;
 
 typedef spkt_ptr *pkt_ptr;
@@ -120,7 +187,7 @@ typedef spkt_ptr *pkt_ptr;
 
 /* init_Packet_Queue
 
-      Initialize the queue for storing pkts.
+      Initialize the queue for storing pkts under the mutex.
 
   Parameter:
 
@@ -135,6 +202,48 @@ typedef spkt_ptr *pkt_ptr;
 int init_Packet_Queue(pkt_ptr pkt_queue);
 
 
+/* init_Packet_Queue_with_type
+
+      Initialize the queue for storing pkts with the kind of synchronization 
+      matching the threads which add and get pkts.
+
+  Parameter:
+
+      pkt_queue : The pointer points to the pkt queue.
+      type      : The kind of synchronization of the queue.
+
+  Return Value:
+
+      int: If return 0, everything work successful.
+           If not 0, Something wrong during init mutex.
+
+ */
+int init_Packet_Queue_with_type(pkt_ptr pkt_queue, PktQueueType type);
+
+
+/* init_Packet_Queue_with_capacity
+
+      Initialize the queue for storing pkts with the kind of synchronization 
+      and the number of pkts it holds. A smaller capacity bounds the time 
+      pkts wait in the queue when the consumer falls behind.
+
+  Parameter:
+
+      pkt_queue : The pointer points to the pkt queue.
+      type      : The kind of synchronization of the queue.
+      capacity  : The number of pkts in the queue, a power of two from 2 to
+                  MAX_QUEUE_LENGTH.
+
+  Return Value:
+
+      int: If return 0, everything work successful.
+           If pkt_Queue_capacity_error, the capacity is invalid.
+
+ */
+int init_Packet_Queue_with_capacity(pkt_ptr pkt_queue, PktQueueType type,
+                                    int capacity);
+
+
 /*
   Free_Packet_Queue
 
@@ -198,10 +307,33 @@ int addpkt(pkt_ptr pkt_queue, char *address, unsigned int port,
 sPkt get_pkt(pkt_ptr pkt_queue);
 
 
+/* get_pkt_into
+
+      Get the first pkt of the pkt queue into a pkt of the caller. Unlike 
+      get_pkt, the pkt is not returned by value, so only the used part of the
+      content is copied.
+
+  Parameter:
+
+      pkt_queue : The pointer points to the pkt queue we going to get 
+                  a pkt from.
+      pkt       : The pointer points to the pkt to store the first pkt.
+
+  Return Value:
+
+      int: If return 0, the first pkt is got.
+           If return pkt_Queue_is_NULL, the pkt queue is null and the 
+           is_null flag of the pkt is set to true.
+
+ */
+int get_pkt_into(pkt_ptr pkt_queue, pPkt pkt);
+
+
 /*
   delpkt
 
-      Delete the first of the packet queue.
+      Delete the first of the packet queue. It is called by the consumer, 
+      holding the mutex if the queue is PKT_QUEUE_LOCKED.
 
   Parameter:
 
@@ -223,7 +355,7 @@ int delpkt(pkt_ptr pkt_queue);
 
       display_title : The title we want to show in front of the packet content.
       pkt           : The packet we want to see it's content.
-      pkt_num       : Choose whitch pkts we want to display.
+      pkt_num       : Choose whitch location of the ring we want to display.
 
   Return Value:
 
@@ -251,7 +383,7 @@ bool is_null(pkt_ptr pkt_queue);
 
 
 /*
-  is_null
+  is_full
 
       check if pkt_Queue is full.
 
@@ -284,6 +416,24 @@ bool is_full(pkt_ptr pkt_queue);
 int queue_len(pkt_ptr pkt_queue);
 
 
+/*
+  reset_high_water_mark
+
+      Get the largest number of pkts in the queue since the last reset and
+      start over from the current length of the queue.
+
+  Parameter:
+
+      pkt_queue : The pointer points to the pkt queue.
+
+  Return Value:
+
+      int : The high-water mark of the queue.
+
+ */
+int reset_high_water_mark(pkt_ptr pkt_queue);
+
+
 /*
 
   print_content
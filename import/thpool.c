@@ -190,7 +190,6 @@ void thpool_destroy(thpool_ *thpool_p){
 
     mp_destroy(&thpool_p->mempool);
 
-    free(thpool_p -> threads);
     free(thpool_p);
 
     thpool_p = NULL;
@@ -234,6 +233,8 @@ static void *thread_do(thread *thread_p){
     /* Assure all threads have been created before starting serving */
     thpool_p = thread_p -> thpool_p;
 
+    apply_thread_role(THREAD_ROLE_WORKER);
+
     /* Mark thread as alive (initialized) */
     pthread_mutex_lock(&thpool_p -> thcount_lock);
     thpool_p->num_threads_alive += 1;
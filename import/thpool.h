@@ -55,6 +55,7 @@
 #include <errno.h>
 #include <time.h>
 #include "Mempool.h"
+#include "ThreadProfile.h"
 
 
 /* The number of slots for the memory pool */
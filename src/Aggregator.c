@@ -0,0 +1,304 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Aggregator.c
+
+  File Description:
+
+     This file contains the programs to aggregate tracked object data reported
+     by LBeacons. LBeacons in the same area report the same objects in every
+     scan cycle. The gateway keeps the state of each object last forwarded to
+     the server and forwards only the objects whose state changes.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#include "Aggregator.h"
+
+
+/* Returns the next semicolon-separated token and terminates it in place.
+   Unlike strtok, empty tokens are returned as empty strings. */
+static char *next_token(char **cursor){
+
+    char *token = *cursor;
+    char *delimiter = NULL;
+
+    if(token == NULL || *token == '\0')
+        return NULL;
+
+    delimiter = strchr(token, DELIMITER_SEMICOLON[0]);
+    if(delimiter == NULL){
+        *cursor = token + strlen(token);
+    }else{
+        *delimiter = '\0';
+        *cursor = delimiter + 1;
+    }
+
+    return token;
+}
+
+
+static unsigned int hash_object(char *lbeacon_uuid, char *mac_address){
+
+    unsigned int hash = 5381;
+    char *c;
+
+    for(c = lbeacon_uuid; *c != '\0'; c++)
+        hash = hash * 33 + (unsigned char)*c;
+
+    for(c = mac_address; *c != '\0'; c++)
+        hash = hash * 33 + (unsigned char)*c;
+
+    return hash;
+}
+
+
+/* Finds the state of the object reported by the LBeacon. When the object is
+   not in the table, the first slot which is never used or holds a lost object
+   is taken over. is_new is set when the returned state is newly taken over or
+   the object was lost. Returns NULL when the table is full. */
+static ObjectState *find_object_state(TrackedObjectAggregator *aggregator,
+                                      char *lbeacon_uuid,
+                                      char *mac_address,
+                                      int current_time,
+                                      bool *is_new){
+
+    unsigned int index;
+    unsigned int probe;
+    ObjectState *state = NULL;
+    ObjectState *reusable = NULL;
+
+    index = hash_object(lbeacon_uuid, mac_address) &
+            (AGGREGATOR_TABLE_SIZE - 1);
+
+    for(probe = 0; probe < AGGREGATOR_TABLE_SIZE; probe++){
+
+        state = &aggregator->object_states[
+            (index + probe) & (AGGREGATOR_TABLE_SIZE - 1)];
+
+        if(state->in_use == false){
+            if(reusable == NULL)
+                reusable = state;
+            break;
+        }
+
+        if(strncmp(state->mac_address, mac_address,
+                   LENGTH_OF_MAC_ADDRESS) == 0 &&
+           strncmp(state->lbeacon_uuid, lbeacon_uuid,
+                   LENGTH_OF_UUID) == 0){
+
+            *is_new = (current_time - state->last_seen_time >
+                       aggregator->lost_object_timeout_in_sec);
+            return state;
+        }
+
+        if(reusable == NULL &&
+           current_time - state->last_seen_time >
+           aggregator->lost_object_timeout_in_sec){
+            reusable = state;
+        }
+    }
+
+    if(reusable == NULL)
+        return NULL;
+
+    reusable->in_use = true;
+    memset(reusable->lbeacon_uuid, 0, sizeof(reusable->lbeacon_uuid));
+    strncpy(reusable->lbeacon_uuid, lbeacon_uuid, LENGTH_OF_UUID - 1);
+    memset(reusable->mac_address, 0, sizeof(reusable->mac_address));
+    strncpy(reusable->mac_address, mac_address, LENGTH_OF_MAC_ADDRESS - 1);
+
+    *is_new = true;
+    return reusable;
+}
+
+
+ErrorCode init_tracked_object_aggregator(TrackedObjectAggregator *aggregator,
+                                         int rssi_threshold,
+                                         int full_snapshot_interval_in_sec,
+                                         int lost_object_timeout_in_sec){
+
+    pthread_mutex_init( &aggregator->table_lock, 0);
+
+    aggregator->rssi_threshold = rssi_threshold;
+    aggregator->full_snapshot_interval_in_sec = full_snapshot_interval_in_sec;
+    aggregator->lost_object_timeout_in_sec = lost_object_timeout_in_sec;
+
+    memset(aggregator->object_states, 0, sizeof(aggregator->object_states));
+
+    return WORK_SUCCESSFULLY;
+}
+
+
+ErrorCode aggregate_tracked_object_data(TrackedObjectAggregator *aggregator,
+                                        char *API_version,
+                                        char *content,
+                                        char *output,
+                                        size_t output_size,
+                                        int *number_forwarded){
+
+    char buf[WIFI_MESSAGE_LENGTH];
+    char records_buf[WIFI_MESSAGE_LENGTH];
+    char *cursor = NULL;
+    char *lbeacon_uuid = NULL;
+    char *lbeacon_timestamp = NULL;
+    char *lbeacon_ip = NULL;
+    char *object_type = NULL;
+    char *object_number = NULL;
+    char *fields[TRACKED_OBJECT_FIELDS_PER_RECORD];
+    ObjectState *state = NULL;
+    bool is_new = false;
+    bool is_forwarded = false;
+    int number_objects = 0;
+    int number_records = 0;
+    int rssi = 0;
+    int current_time = get_clock_time();
+    size_t output_len = 0;
+    size_t records_len = 0;
+    int written = 0;
+    int i, j;
+
+    *number_forwarded = 0;
+
+    /* The records of other versions may have another number of fields */
+    if(strncmp(API_version, AGGREGATOR_API_VERSION, 
+               LENGTH_OF_API_VERSION) != 0)
+        return E_API_PROTOCOL_FORMAT;
+
+    if(strlen(content) >= sizeof(buf))
+        return E_API_PROTOCOL_FORMAT;
+
+    strcpy(buf, content);
+    cursor = buf;
+
+    lbeacon_uuid = next_token(&cursor);
+    lbeacon_timestamp = next_token(&cursor);
+    lbeacon_ip = next_token(&cursor);
+
+    if(lbeacon_ip == NULL || strlen(lbeacon_uuid) == 0)
+        return E_API_PROTOCOL_FORMAT;
+
+    written = snprintf(output, output_size, "%s;%s;%s;",
+                       lbeacon_uuid, lbeacon_timestamp, lbeacon_ip);
+    if(written < 0 || written >= output_size)
+        return E_BUFFER_SIZE;
+    output_len = written;
+
+    pthread_mutex_lock( &aggregator->table_lock);
+
+    while((object_type = next_token(&cursor)) != NULL){
+
+        /* The content may end with a trailing delimiter */
+        if(strlen(object_type) == 0 && *cursor == '\0')
+            break;
+
+        object_number = next_token(&cursor);
+        if(object_number == NULL ||
+           is_numeric(object_type) == false ||
+           is_numeric(object_number) == false){
+
+            pthread_mutex_unlock( &aggregator->table_lock);
+            return E_API_PROTOCOL_FORMAT;
+        }
+
+        number_objects = atoi(object_number);
+        number_records = 0;
+        records_len = 0;
+        records_buf[0] = '\0';
+
+        for(i = 0; i < number_objects; i++){
+
+            for(j = 0; j < TRACKED_OBJECT_FIELDS_PER_RECORD; j++){
+                fields[j] = next_token(&cursor);
+                if(fields[j] == NULL){
+                    pthread_mutex_unlock( &aggregator->table_lock);
+                    return E_API_PROTOCOL_FORMAT;
+                }
+            }
+
+            rssi = atoi(fields[INDEX_OF_RSSI_IN_RECORD]);
+            is_new = false;
+
+            state = find_object_state(aggregator, lbeacon_uuid, fields[0],
+                                      current_time, &is_new);
+
+            if(state == NULL || is_new){
+                is_forwarded = true;
+            }else if(atoi(fields[INDEX_OF_PANIC_BUTTON_IN_RECORD]) != 0){
+                is_forwarded = true;
+            }else if(abs(rssi - state->last_rssi) >=
+                     aggregator->rssi_threshold){
+                is_forwarded = true;
+            }else if(current_time - state->last_forwarded_time >=
+                     aggregator->full_snapshot_interval_in_sec){
+                is_forwarded = true;
+            }else{
+                is_forwarded = false;
+            }
+
+            if(state != NULL){
+                state->last_seen_time = current_time;
+                if(is_forwarded){
+                    state->last_rssi = rssi;
+                    state->last_forwarded_time = current_time;
+                }
+            }
+
+            if(is_forwarded == false)
+                continue;
+
+            for(j = 0; j < TRACKED_OBJECT_FIELDS_PER_RECORD; j++){
+                written = snprintf(records_buf + records_len,
+                                   sizeof(records_buf) - records_len,
+                                   "%s;", fields[j]);
+                if(written < 0 ||
+                   written >= sizeof(records_buf) - records_len){
+                    pthread_mutex_unlock( &aggregator->table_lock);
+                    return E_BUFFER_SIZE;
+                }
+                records_len += written;
+            }
+            number_records++;
+        }
+
+        written = snprintf(output + output_len, output_size - output_len,
+                           "%s;%d;%s", object_type, number_records,
+                           records_buf);
+        if(written < 0 || written >= output_size - output_len){
+            pthread_mutex_unlock( &aggregator->table_lock);
+            return E_BUFFER_SIZE;
+        }
+        output_len += written;
+
+        *number_forwarded += number_records;
+    }
+
+    pthread_mutex_unlock( &aggregator->table_lock);
+
+    return WORK_SUCCESSFULLY;
+}
@@ -0,0 +1,175 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Aggregator.h
+
+  File Description:
+
+     This is the header file containing the declarations of functions and
+     variables used in the Aggregator.c file.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#ifndef AGGREGATOR_H
+#define AGGREGATOR_H
+
+#include "BeDIS.h"
+
+/* Number of slots in the table of tracked object states. The value must be a
+   power of two, because slots are located by masking the hash value. */
+#define AGGREGATOR_TABLE_SIZE 8192
+
+/* Number of fields of each object record in the tracked_object_data payload:
+   mac_address;initial_timestamp;final_timestamp;rssi;panic_button;battery */
+#define TRACKED_OBJECT_FIELDS_PER_RECORD 6
+
+/* The gateway API version of the LBeacons whose records have the layout
+   above. Payloads of other versions are forwarded verbatim. */
+#define AGGREGATOR_API_VERSION BOT_GATEWAY_API_VERSION_LATEST
+
+/* The index of the rssi field within an object record */
+#define INDEX_OF_RSSI_IN_RECORD 3
+
+/* The index of the panic_button field within an object record */
+#define INDEX_OF_PANIC_BUTTON_IN_RECORD 4
+
+/* The last forwarded state of an object seen by a LBeacon */
+typedef struct {
+
+    /* A flag indicating whether this slot has ever been occupied */
+    bool in_use;
+
+    /* The UUID of the LBeacon reporting the object */
+    char lbeacon_uuid[LENGTH_OF_UUID];
+
+    /* The MAC address of the object */
+    char mac_address[LENGTH_OF_MAC_ADDRESS];
+
+    /* The rssi forwarded to the server most recently */
+    int last_rssi;
+
+    /* The uptime at which the object was reported most recently */
+    int last_seen_time;
+
+    /* The uptime at which the object was forwarded most recently */
+    int last_forwarded_time;
+
+} ObjectState;
+
+/* The table of object states used to forward only changes of tracked object
+   data to the server */
+typedef struct {
+
+    /* A per table lock */
+    pthread_mutex_t table_lock;
+
+    /* The minimal change of rssi which makes an object be forwarded */
+    int rssi_threshold;
+
+    /* The longest time in seconds an unchanged object is held back before it
+       is forwarded again as part of the full snapshot */
+    int full_snapshot_interval_in_sec;
+
+    /* The time in seconds after which an object not reported anymore is
+       considered lost. A lost object is forwarded as a new one when it is
+       reported again. Nothing is sent when an object is lost, because the
+       payload has no record for it. The server detects the loss by the
+       absence of the object, which is forwarded at least every full
+       snapshot interval while it is reported. */
+    int lost_object_timeout_in_sec;
+
+    ObjectState object_states[AGGREGATOR_TABLE_SIZE];
+
+} TrackedObjectAggregator;
+
+
+/*
+  init_tracked_object_aggregator:
+
+     This function initializes the table of object states and the parameters
+     deciding which objects are forwarded.
+
+  Parameters:
+
+     aggregator - A pointer to the aggregator.
+     rssi_threshold - The minimal change of rssi to forward an object.
+     full_snapshot_interval_in_sec - The longest time in seconds an unchanged
+                                     object is held back.
+     lost_object_timeout_in_sec - The time in seconds after which an object
+                                  not reported anymore is considered lost.
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error if the function
+                 fails or WORK SUCCESSFULLY otherwise
+ */
+ErrorCode init_tracked_object_aggregator(TrackedObjectAggregator *aggregator,
+                                         int rssi_threshold,
+                                         int full_snapshot_interval_in_sec,
+                                         int lost_object_timeout_in_sec);
+
+/*
+  aggregate_tracked_object_data:
+
+     This function parses the content of a tracked_object_data packet from a
+     LBeacon and writes the content with only the objects to be forwarded to
+     the output buffer. An object is forwarded when it is new or was lost, when
+     its panic button is pressed, when its rssi changes by at least the rssi
+     threshold, or when it has not been forwarded for the full snapshot
+     interval. The output keeps the format of the input, so the server handles
+     it like any other tracked_object_data packet. Only payloads of
+     AGGREGATOR_API_VERSION are aggregated, because the records of other
+     versions may have another number of fields.
+
+  Parameters:
+
+     aggregator - A pointer to the aggregator.
+     API_version - The gateway API version of the LBeacon, such as "1.3".
+     content - The content of the tracked_object_data packet, starting with
+               the UUID of the LBeacon.
+     output - The buffer to store the aggregated content.
+     output_size - The size of the output buffer.
+     number_forwarded - The number of objects written to the output buffer.
+
+  Return value:
+
+     ErrorCode - E_API_PROTOCOL_FORMAT if the API version is not 
+                 AGGREGATOR_API_VERSION or the content cannot be parsed, in
+                 which case the content should be forwarded as it is,
+                 E_BUFFER_SIZE if the output buffer is not big enough, and
+                 WORK_SUCCESSFULLY otherwise.
+ */
+ErrorCode aggregate_tracked_object_data(TrackedObjectAggregator *aggregator,
+                                        char *API_version,
+                                        char *content,
+                                        char *output,
+                                        size_t output_size,
+                                        int *number_forwarded);
+
+#endif
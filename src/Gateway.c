@@ -44,20 +44,44 @@
 #include "Gateway.h"
 
 
+/* The names of the stages of the gateway pipeline in the logs */
+static const char *latency_stage_names[MAX_LATENCY_STAGE] = {
+    "udp_receive_queue",
+    "parse",
+    "buffer_list",
+    "job_queue",
+    "process",
+    "forward",
+    "udp_send_queue"
+};
+
+#ifndef GATEWAY_HARNESS
 int main(int argc, char **argv){
 
+    return run_gateway();
+}
+#endif
+
+
+ErrorCode run_gateway(){
+
     int return_value;
-    int last_join_request_time = 0;
-    int uptime;
-    int last_dump_active_lbeacon_time = 0;
+    int number_restored_lbeacons;
 
     /* The main thread of the communication Unit */
     pthread_t CommUnit_thread;
 
-    /* The thread to listen for messages from Wi-Fi interface */
-    pthread_t wifi_listener;
+    /* The threads to listen for messages from Wi-Fi interface, one for each
+       receiver of the transport */
+    pthread_t wifi_listeners[MAX_NUMBER_RECEIVE_SOCKETS];
+    int receiver;
+
+    /* The thread to probe the liveness of LBeacons */
+    pthread_t lbeacon_prober_thread;
+
+    /* The thread to report LBeacons joined to the server */
+    pthread_t join_report_thread;
 
-    char *temp_lbeacon_uuid = NULL;   
     struct sigaction sigint_handler;
 
     /* Initialize zlog */
@@ -74,6 +98,8 @@ int main(int argc, char **argv){
         if (!category_debug)
             zlog_fini();
 #endif
+
+        category_performance = zlog_get_category(LOG_CATEGORY_PERFORMANCE);
     }
 
 #ifdef debugging
@@ -90,6 +116,27 @@ int main(int argc, char **argv){
         return E_OPEN_FILE;
     }
 
+    /* Set before any thread is started */
+    if(init_thread_profile() != WORK_SUCCESSFULLY){
+        zlog_error(category_health_report, 
+                   "Invalid thread profile, threads keep default attributes");
+    #ifdef debugging
+        zlog_error(category_debug, 
+                   "Invalid thread profile, threads keep default attributes");
+    #endif
+    }
+
+    if(config.is_async_logging == true &&
+       start_async_logger(&gateway_async_logger, 
+                          config.is_log_format_deferred) != 0){
+        zlog_error(category_health_report, 
+                   "Async logger initialization Fail, logging synchronously");
+    #ifdef debugging
+        zlog_error(category_debug, 
+                   "Async logger initialization Fail, logging synchronously");
+    #endif
+    }
+
     /* Initialize all global flags */
     NSI_initialization_complete      = false;
     CommUnit_initialization_complete = false;
@@ -99,6 +146,61 @@ int main(int argc, char **argv){
     /* Initialize the address map*/
     init_Address_Map( &LBeacon_address_map);
 
+    evicted_lbeacon_count = 0;
+    set_eviction_function_of_Address_Map(&LBeacon_address_map, 
+                                         lbeacon_evicted, NULL);
+
+    /* The coalescer also splits join reports too large for one message */
+    init_join_report_coalescer(&join_report_coalescer,
+                               &LBeacon_address_map,
+                               config.join_report_window_in_ms,
+                               config.is_differential_registry_sync,
+                               config.area_id,
+                               config.serial_id,
+                               send_message_to_server);
+
+    /* Restore the LBeacons joined before the restart, so that commands from
+       the server reach them without waiting for their join requests */
+    number_restored_lbeacons = 
+        load_Address_Map(ADDRESS_MAP_CHECKPOINT_FILE_NAME, 
+                         &LBeacon_address_map,
+                         config.address_map_time_duration_in_sec);
+#ifdef debugging
+    zlog_info(category_debug, "Restored [%d] Lbeacons from the checkpoint",
+              number_restored_lbeacons);
+#endif
+
+    active_lbeacon_snapshot = NULL;
+    if(config.is_dump_active_lbeacon_to_shared_memory == true){
+
+        active_lbeacon_snapshot = 
+            open_active_entry_snapshot(ACTIVE_LBEACON_SHM_NAME);
+
+        if(active_lbeacon_snapshot == NULL){
+            zlog_error(category_health_report, 
+                       "Cannot map the snapshot of active Lbeacons");
+        #ifdef debugging
+            zlog_error(category_debug, 
+                       "Cannot map the snapshot of active Lbeacons");
+        #endif
+        }
+    }
+
+    /* Initialize the states of tracked objects */
+    init_tracked_object_aggregator(
+        &tracked_object_aggregator,
+        config.aggregation_rssi_threshold,
+        config.aggregation_full_snapshot_interval_in_sec,
+        config.aggregation_lost_object_timeout_in_sec);
+
+    init_performance_report();
+
+    /* Load the inputs of the health report and watch for their changes */
+    init_health_state_cache(&health_state_cache,
+                            SELF_CHECK_RESULT_FILE_NAME,
+                            VERSION_FILE_NAME,
+                            ABNORMAL_LBEACON_FILE_NAME);
+
     /* Initialize buffer_list_heads and add to the head into the priority list.
      */
 
@@ -144,8 +246,8 @@ int main(int argc, char **argv){
     /* Create the config from input config file */
 
     /* Initialize the memory pool */
-    if(mp_init( &node_mempool, sizeof(BufferNode), SLOTS_IN_MEM_POOL_BUFFER_NODE)
-       != MEMORY_POOL_SUCCESS){
+    if(mp_init( &node_mempool, sizeof(BufferNode), 
+                config.slots_in_mem_pool_buffer_node) != MEMORY_POOL_SUCCESS){
         zlog_error(category_health_report, "Mempool Initialization Fail");
 #ifdef debugging
         zlog_error(category_debug, "Mempool Initialization Fail");
@@ -169,24 +271,108 @@ int main(int argc, char **argv){
     zlog_info(category_debug, "Wi-Fi initialization Success");
 #endif
 
+    udp_config.send_queue_latency = 
+        &latency_histograms[LATENCY_UDP_SEND_QUEUE][undefined];
+
+    /* The registry is initialized even when metrics are not exported, so
+       that stopping its listener at the end finds no listener */
+    init_metrics_registry(&gateway_metrics);
+
+    /* Export metrics to the local host */
+    if(config.metrics_port > 0){
+
+        if(register_gateway_metrics() != WORK_SUCCESSFULLY ||
+           start_metrics_listener(&gateway_metrics, config.metrics_port) 
+           != 0){
+
+            zlog_error(category_health_report, 
+                       "Metrics listener initialization Fail");
+#ifdef debugging
+            zlog_error(category_debug, 
+                       "Metrics listener initialization Fail");
+#endif
+        }
+    }
+
     /* Create threads for sending and receiving data from and to LBeacons and
        the server. */
-    /* Two static threads to listen for messages from LBeacon or Sever */
-    return_value = startThread( &wifi_listener, (void *)process_wifi_receive,
-                               NULL);
+    /* Static threads to listen for messages from LBeacon or Sever, each 
+       parsing the messages of its own receiver */
+    for(receiver = 0; receiver < gateway_transport.number_receivers; 
+        receiver++){
+
+        return_value = startThread( &wifi_listeners[receiver], 
+                                    process_wifi_receive,
+                                    (void *)(intptr_t)receiver);
+
+        if(return_value != WORK_SUCCESSFULLY){
+            initialization_failed = true;
+            zlog_error(category_health_report, 
+                       "wifi_listener initialization Fail");
+#ifdef debugging
+            zlog_error(category_debug,  "wifi_listener initialization Fail");
+#endif
+            return E_WIFI_INIT_FAIL;
+        }
+    }
+
+#ifdef debugging
+    zlog_info(category_debug, "wifi_listener initialization Success");
+#endif
+
+    return_value = start_health_state_cache_thread(&health_state_cache);
 
     if(return_value != WORK_SUCCESSFULLY){
-        initialization_failed = true;
-        zlog_error(category_health_report, "wifi_listener initialization Fail");
+        zlog_error(category_health_report, 
+                   "health_state_cache_thread Create Fail");
 #ifdef debugging
-        zlog_error(category_debug,  "wifi_listener initialization Fail");
+        zlog_error(category_debug, "health_state_cache_thread Create Fail");
 #endif
-        return E_WIFI_INIT_FAIL;
     }
 
+    /* Probe LBeacons in the gateway instead of the ping_ip.sh script */
+    if(config.lbeacon_probe_interval_in_sec > 0){
+
+        return_value = init_lbeacon_prober(
+            &lbeacon_prober,
+            &LBeacon_address_map,
+            &health_state_cache,
+            config.lbeacon_probe_interval_in_sec,
+            config.lbeacon_probe_rate_per_sec,
+            config.address_map_time_duration_in_sec);
+
+        if(return_value == WORK_SUCCESSFULLY){
+            return_value = startThread( &lbeacon_prober_thread, 
+                                        lbeacon_prober_routine,
+                                        &lbeacon_prober);
+        }
+
+        if(return_value != WORK_SUCCESSFULLY){
+            zlog_error(category_health_report, 
+                       "lbeacon_prober_thread Create Fail");
 #ifdef debugging
-    zlog_info(category_debug, "wifi_listener initialization Success");
+            zlog_error(category_debug, "lbeacon_prober_thread Create Fail");
+#endif
+        }
+    }
+
+    /* Report LBeacons joined within a window together */
+    if(config.join_report_window_in_ms > 0){
+
+        return_value = startThread( &join_report_thread, 
+                                    join_report_routine,
+                                    &join_report_coalescer);
+
+        if(return_value != WORK_SUCCESSFULLY){
+            zlog_error(category_health_report, 
+                       "join_report_thread Create Fail");
+#ifdef debugging
+            zlog_error(category_debug, "join_report_thread Create Fail");
 #endif
+            /* Fall back to reporting every LBeacon joined immediately */
+            config.join_report_window_in_ms = 0;
+        }
+    }
 
     NSI_initialization_complete = true;
 
@@ -219,6 +405,20 @@ int main(int argc, char **argv){
         }
     }
 
+    /* The main thread runs the periodical timers */
+    apply_thread_role(THREAD_ROLE_BACKGROUND);
+
+    if(get_thread_profile_failure_count() > 0){
+        zlog_error(category_health_report, 
+                   "Cannot apply the thread profile to [%llu] threads",
+                   (unsigned long long)get_thread_profile_failure_count());
+    #ifdef debugging
+        zlog_error(category_debug, 
+                   "Cannot apply the thread profile to [%llu] threads",
+                   (unsigned long long)get_thread_profile_failure_count());
+    #endif
+    }
+
     /* Register handler function for SIGINT signal */
     sigint_handler.sa_handler = ctrlc_handler;
     sigemptyset(&sigint_handler.sa_mask);
@@ -233,48 +433,61 @@ int main(int argc, char **argv){
     
     server_latest_polling_time = 0;
     last_join_request_time = 0;
-  
-    /* The while loop that keeps the program running */
-    while(ready_to_work == true){
+    last_checkpoint_address_map_time = 0;
+    checkpointed_address_map_generation = 0;
 
-        uptime = get_clock_time();
+    /* Schedule the periodic work of the gateway */
+    if(init_timer_queue(&gateway_timers) != 0){
+        zlog_error(category_health_report, "Initialize timers Fail");
+#ifdef debugging
+        zlog_error(category_debug, "Initialize timers Fail");
+#endif
+        return E_INITIALIZATION_FAIL;
+    }
 
-        if( ( uptime - server_latest_polling_time > 
-              INTERVAL_RECEIVE_MESSAGE_FROM_SERVER_IN_SEC ) && 
-            ( uptime - last_join_request_time >
-              INTERVAL_FOR_RECONNECT_SERVER_IN_SEC ) ){
+    join_request_timer_id = add_timer(&gateway_timers, 
+                                      join_request_timer_routine, 
+                                      NULL, 0, 0);
 
-           if(WORK_SUCCESSFULLY == send_join_request(true, temp_lbeacon_uuid))
-            {
-                last_join_request_time = uptime;
-            }
-        }else if( uptime - last_dump_active_lbeacon_time >
-                  INTERVAL_FOR_DUMP_ACTIVE_LBEACONS_IN_SEC){
-                   
-            /* Maintain Lbeacon AddressMap */
-            release_not_used_entry_from_Address_Map(
-                &LBeacon_address_map,
-                config.address_map_time_duration_in_sec);
-            
-            /* Dump active Lbeacons to let shell script try network connection */
-            dump_ip_of_active_entry_from_Address_Map(
-                ACTIVE_LBEACON_FILE_NAME,
-                &LBeacon_address_map,
-                config.address_map_time_duration_in_sec);           
-            
-            last_dump_active_lbeacon_time = uptime;
-            
-        }else{
-            sleep_t(NORMAL_WAITING_TIME_IN_MS);
-        }
-        
-    }
+    expire_address_map_timer_id = add_timer(
+        &gateway_timers, expire_address_map_timer_routine, NULL, 
+        get_next_expiry_in_ms_from_Address_Map(
+            &LBeacon_address_map, 
+            config.address_map_time_duration_in_sec), 
+        0);
+
+    add_timer(&gateway_timers, maintain_address_map_timer_routine, NULL, 
+              0, config.interval_for_dump_active_lbeacons_in_sec * 1000);
+
+    add_timer(&gateway_timers, latency_report_timer_routine, NULL,
+              config.interval_for_latency_report_in_sec * 1000,
+              config.interval_for_latency_report_in_sec * 1000);
+
+    /* Run the timers until the program is going to be ended */
+    run_timer_queue(&gateway_timers, &ready_to_work);
+
+    release_timer_queue(&gateway_timers);
+
+    save_Address_Map(ADDRESS_MAP_CHECKPOINT_FILE_NAME, &LBeacon_address_map);
+
+    if(config.join_report_window_in_ms > 0)
+        release_join_report_coalescer(&join_report_coalescer);
+
+    stop_metrics_listener(&gateway_metrics);
+
+    release_health_state_cache(&health_state_cache);
+
+    if(config.lbeacon_probe_interval_in_sec > 0)
+        release_lbeacon_prober(&lbeacon_prober);
 
     /* The program is going to be ended. Free the connection of Wifi */
     Wifi_free();
 
     mp_destroy(&node_mempool);
 
+    /* Write the messages left by the threads */
+    stop_async_logger(&gateway_async_logger);
+
 #ifdef debugging
     zlog_info(category_debug, "Gateway exit successfullly");
 #endif
@@ -287,59 +500,172 @@ ErrorCode get_gateway_config(GatewayConfig *config,
                              CommonConfig *common_config,
                              char *file_name) {
 
-    FILE *file = fopen(file_name, "r");
-    char config_message[CONFIG_BUFFER_SIZE];
-    
-    if (file == NULL) {
+    ConfigEntry entries[] = {
+        CONFIG_BOOL("is_geofence", config->is_geofence, "0"),
+        CONFIG_STRING("area_id", config->area_id, NULL),
+        CONFIG_STRING("serial_id", config->serial_id, NULL),
+        CONFIG_INT("number_worker_thread", 
+                   common_config->number_worker_threads, "20", 0, 256),
+        CONFIG_INT("min_age_out_of_date_packet_in_sec",
+                   common_config->min_age_out_of_date_packet_in_sec, 
+                   "10", 1, INT_MAX),
+        CONFIG_STRING("server_ip", config->server_ip, NULL),
+        CONFIG_INT("send_port", config->send_port, NULL, 1, 65535),
+        CONFIG_INT("recv_port", config->recv_port, NULL, 1, 65535),
+        CONFIG_INT("critical_priority", 
+                   common_config->time_critical_priority, "-4", -20, 19),
+        CONFIG_INT("high_priority", common_config->high_priority, 
+                   "-2", -20, 19),
+        CONFIG_INT("normal_priority", common_config->normal_priority, 
+                   "0", -20, 19),
+        CONFIG_INT("low_priority", common_config->low_priority, 
+                   "2", -20, 19),
+        CONFIG_INT("address_map_time_duration_in_sec",
+                   config->address_map_time_duration_in_sec, 
+                   "60", 1, INT_MAX),
+        CONFIG_BOOL("aggregate_tracked_object_data",
+                    config->is_aggregate_tracked_object_data, "0"),
+        CONFIG_INT("aggregation_rssi_threshold",
+                   config->aggregation_rssi_threshold, "5", 0, 255),
+        CONFIG_INT("aggregation_full_snapshot_interval_in_sec",
+                   config->aggregation_full_snapshot_interval_in_sec, 
+                   "10", 0, INT_MAX),
+        CONFIG_INT("aggregation_lost_object_timeout_in_sec",
+                   config->aggregation_lost_object_timeout_in_sec, 
+                   "30", 0, INT_MAX),
+        CONFIG_INT("metrics_port", config->metrics_port, "0", 0, 65535),
+        CONFIG_BOOL("report_performance_in_health_report",
+                    config->is_report_performance_in_health_report, "0"),
+        CONFIG_INT("lbeacon_probe_interval_in_sec",
+                   config->lbeacon_probe_interval_in_sec, "0", 0, INT_MAX),
+        CONFIG_INT("lbeacon_probe_rate_per_sec",
+                   config->lbeacon_probe_rate_per_sec, "200", 1, 1000000),
+        CONFIG_BOOL("dump_active_lbeacon_to_shared_memory",
+                    config->is_dump_active_lbeacon_to_shared_memory, "0"),
+        CONFIG_INT("join_report_window_in_ms",
+                   config->join_report_window_in_ms, "200", 0, INT_MAX),
+        CONFIG_BOOL("differential_registry_sync",
+                    config->is_differential_registry_sync, "0"),
+        CONFIG_STRING("capture_file_name", config->capture_file_name, ""),
+        CONFIG_STRING("replay_file_name", config->replay_file_name, ""),
+        CONFIG_DOUBLE("replay_speed", config->replay_speed, "1", 0, 1000),
+        CONFIG_INT("number_receive_sockets", config->number_receive_sockets,
+                   "1", 1, MAX_NUMBER_RECEIVE_SOCKETS),
+        CONFIG_BOOL("thread_profile", config->is_thread_profile_enabled, 
+                    "0"),
+        CONFIG_STRING("io_cpu_list", config->io_cpu_list, ""),
+        CONFIG_STRING("worker_cpu_list", config->worker_cpu_list, ""),
+        CONFIG_STRING("thread_scheduling_policy", 
+                      config->thread_scheduling_policy, "other"),
+        CONFIG_BOOL("lock_memory", config->is_memory_locked, "0"),
+        CONFIG_BOOL("async_logging", config->is_async_logging, "0"),
+        CONFIG_BOOL("deferred_log_format", config->is_log_format_deferred, 
+                    "0"),
+        CONFIG_INT("slots_in_mem_pool_buffer_node",
+                   config->slots_in_mem_pool_buffer_node,
+                   CONFIG_DEFAULT(SLOTS_IN_MEM_POOL_BUFFER_NODE), 
+                   64, 1048576),
+        CONFIG_INT("pkt_queue_length", config->pkt_queue_length,
+                   CONFIG_DEFAULT(MAX_QUEUE_LENGTH), 2, MAX_QUEUE_LENGTH),
+        CONFIG_INT("interval_receive_message_from_server_in_sec",
+                   config->interval_receive_message_from_server_in_sec,
+                   CONFIG_DEFAULT(INTERVAL_RECEIVE_MESSAGE_FROM_SERVER_IN_SEC),
+                   1, INT_MAX / 2),
+        CONFIG_INT("interval_for_reconnect_server_in_sec",
+                   config->interval_for_reconnect_server_in_sec,
+                   CONFIG_DEFAULT(INTERVAL_FOR_RECONNECT_SERVER_IN_SEC),
+                   1, INT_MAX / 2),
+        CONFIG_INT("interval_for_dump_active_lbeacons_in_sec",
+                   config->interval_for_dump_active_lbeacons_in_sec,
+                   CONFIG_DEFAULT(INTERVAL_FOR_DUMP_ACTIVE_LBEACONS_IN_SEC),
+                   1, INT_MAX / 1000),
+        CONFIG_INT("interval_for_checkpoint_address_map_in_sec",
+                   config->interval_for_checkpoint_address_map_in_sec,
+                   CONFIG_DEFAULT(INTERVAL_FOR_CHECKPOINT_ADDRESS_MAP_IN_SEC),
+                   1, INT_MAX),
+        CONFIG_INT("interval_for_latency_report_in_sec",
+                   config->interval_for_latency_report_in_sec,
+                   CONFIG_DEFAULT(INTERVAL_FOR_LATENCY_REPORT_IN_SEC),
+                   1, INT_MAX / 1000),
+        /* Read by heartbeat.sh */
+        CONFIG_IGNORED("default_gateway")
+    };
+    ErrorCode return_value;
+
+    return_value = load_config_file(file_name, entries, 
+                                    sizeof(entries) / sizeof(entries[0]));
+
+    if(return_value == E_OPEN_FILE){
         /* Error handling */
         zlog_error(category_health_report, "Open config file fail.");
         return E_OPEN_FILE;
     }
-        
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    config->is_geofence = atoi(config_message);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    memcpy(config->area_id, config_message, sizeof(config->area_id));
+    if(return_value != WORK_SUCCESSFULLY)
+        return return_value;
+
+    /* The counters of the pkt queues are mapped to their rings by a mask */
+    if((config->pkt_queue_length & (config->pkt_queue_length - 1)) != 0){
+
+        zlog_error(category_health_report, 
+                   "pkt_queue_length [%d] is not a power of two",
+                   config->pkt_queue_length);
+        return E_INPUT_PARAMETER;
+    }
+
     zlog_debug(category_debug, "area_id = [%s]", config->area_id);
-    
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    memcpy(config->serial_id, config_message, sizeof(config->serial_id));
     zlog_debug(category_debug, "serial_id = [%s]", config->serial_id);
     
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    common_config->number_worker_threads = atoi(config_message);
-
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    common_config->min_age_out_of_date_packet_in_sec = atoi(config_message);
+    return WORK_SUCCESSFULLY;
+}
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    memcpy(config->server_ip, config_message, sizeof(config->server_ip));
+ErrorCode init_thread_profile(){
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    config->send_port = atoi(config_message);
+    ThreadProfile profile;
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    config->recv_port = atoi(config_message);
+    memset(&profile, 0, sizeof(profile));
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    common_config->time_critical_priority = atoi(config_message);
+    if(config.is_memory_locked == true && lock_process_memory() != 0){
+        zlog_error(category_health_report, "Locking memory Fail");
+    #ifdef debugging
+        zlog_error(category_debug, "Locking memory Fail");
+    #endif
+    }
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    common_config->high_priority = atoi(config_message);
+    if(config.is_thread_profile_enabled == false)
+        return WORK_SUCCESSFULLY;
+
+    if(parse_cpu_list(config.io_cpu_list, 
+                      &profile.cpu_masks[THREAD_ROLE_IO]) != 0 ||
+       parse_cpu_list(config.worker_cpu_list, 
+                      &profile.cpu_masks[THREAD_ROLE_WORKER]) != 0)
+        return E_INPUT_PARAMETER;
+
+    profile.cpu_masks[THREAD_ROLE_DISPATCH] = 
+        profile.cpu_masks[THREAD_ROLE_IO];
+    profile.cpu_masks[THREAD_ROLE_BACKGROUND] = 
+        profile.cpu_masks[THREAD_ROLE_WORKER];
+
+    if(strcmp(config.thread_scheduling_policy, "fifo") == 0)
+        profile.policy = SCHED_FIFO;
+    else if(strcmp(config.thread_scheduling_policy, "rr") == 0)
+        profile.policy = SCHED_RR;
+    else if(strcmp(config.thread_scheduling_policy, "other") == 0 ||
+            strlen(config.thread_scheduling_policy) == 0)
+        profile.policy = SCHED_OTHER;
+    else
+        return E_INPUT_PARAMETER;
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    common_config->normal_priority = atoi(config_message);
+    /* The priorities of the buffer lists are reused for the threads */
+    profile.nice[THREAD_ROLE_IO] = common_config.time_critical_priority;
+    profile.nice[THREAD_ROLE_DISPATCH] = common_config.high_priority;
+    profile.nice[THREAD_ROLE_WORKER] = common_config.normal_priority;
+    profile.nice[THREAD_ROLE_BACKGROUND] = common_config.low_priority;
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    common_config->low_priority = atoi(config_message);
-    
-    fetch_next_string(file, config_message, sizeof(config_message)); 
-    config->address_map_time_duration_in_sec = atoi(config_message);
+    profile.is_enabled = true;
 
-    fclose(file);
+    set_thread_profile(&profile);
 
-    
     return WORK_SUCCESSFULLY;
 }
 
@@ -359,6 +685,8 @@ void *NSI_routine(void *_buffer_node){
     
     char API_version[LENGTH_OF_API_VERSION];
 
+    record_latency_at_routine_start(temp);
+
     memset(API_version, 0, sizeof(API_version));
     sprintf(API_version, "%.1f", temp->API_version);
     
@@ -382,14 +710,14 @@ void *NSI_routine(void *_buffer_node){
 
     /* put the pkt type into content */
 
-    zlog_debug(category_debug, "uuid=[%s], " \
-                               "LBeacon_datetime=[%d], " \
-                               "net_address=[%s], " \
-                               "join_result=[%d]",
-                               uuid,
-                               Lbeacon_timestamp,
-                               temp->net_address,
-                               join_status);
+    async_zlog_debug(category_debug, "uuid=[%s], " \
+                                     "LBeacon_datetime=[%d], " \
+                                     "net_address=[%s], " \
+                                     "join_result=[%d]",
+                                     uuid,
+                                     Lbeacon_timestamp,
+                                     temp->net_address,
+                                     join_status);
   
     memset(buf, 0, sizeof(buf));
     sprintf(buf, "%d;%d;%s;%s;%d;%s;%d;", from_gateway,
@@ -404,6 +732,9 @@ void *NSI_routine(void *_buffer_node){
     strcpy(temp->content, buf);
     temp->content_size = strlen(temp-> content);
 
+    record_latency_at_routine_end(temp, false);
+    temp->enqueue_time_in_ns = get_clock_time_in_ns();
+
     pthread_mutex_lock(&NSI_send_buffer_list_head.list_lock);
 
     insert_list_tail( &temp->buffer_entry,
@@ -411,7 +742,10 @@ void *NSI_routine(void *_buffer_node){
 
     pthread_mutex_unlock( &NSI_send_buffer_list_head.list_lock);
  
-    send_join_request(false, uuid);
+    if(join_status == JOIN_ACK && config.join_report_window_in_ms > 0)
+        queue_join_report(&join_report_coalescer, uuid);
+    else
+        send_join_request(false, uuid);
 
     return (void *)NULL;
 }
@@ -427,6 +761,7 @@ void *BHM_routine(void *_buffer_node){
     int Lbeacon_timestamp;
     char API_version[LENGTH_OF_API_VERSION];
 
+    record_latency_at_routine_start(temp);
     
     memset(API_version, 0, sizeof(API_version));
     sprintf(API_version, "%.1f", temp -> API_version);
@@ -472,8 +807,12 @@ void *BHM_routine(void *_buffer_node){
             config.server_ip, 
             NETWORK_ADDR_LENGTH);
     
-    printf("Report to server [lbeacon health status]\n"); 
-    printf("message=[%s]\n", temp -> content);
+    async_zlog_info(category_debug, 
+                    "Report to server [lbeacon health status], " \
+                    "message=[%s]", temp -> content);
+
+    record_latency_at_routine_end(temp, false);
+    temp->enqueue_time_in_ns = get_clock_time_in_ns();
 
     pthread_mutex_lock(&BHM_send_buffer_list_head.list_lock);
 
@@ -492,12 +831,45 @@ void *LBeacon_routine(void *_buffer_node){
     int pkt_type = temp -> pkt_type;
     char buf[WIFI_MESSAGE_LENGTH];
     char API_version[LENGTH_OF_API_VERSION];
+    int number_forwarded = 0;
+
+    record_latency_at_routine_start(temp);
 
-    printf("Received content (tracking data) from Lbeacon\n");
+    async_zlog_info(category_debug, 
+                    "Received content (tracking data) from Lbeacon");
 
     memset(API_version, 0, sizeof(API_version));
     sprintf(API_version, "%.1f", temp -> API_version);
-    
+
+    /* Geofence gateways forward every report, because the server needs all
+       of them to detect geofence violations in time. */
+    if(config.is_aggregate_tracked_object_data && !config.is_geofence)
+    {
+        memset(buf, 0, sizeof(buf));
+
+        /* Forward the content as it is if it cannot be aggregated */
+        if(WORK_SUCCESSFULLY == 
+           aggregate_tracked_object_data(&tracked_object_aggregator,
+                                         API_version,
+                                         temp -> content,
+                                         buf,
+                                         sizeof(buf),
+                                         &number_forwarded))
+        {
+            if(number_forwarded == 0)
+            {
+                async_zlog_debug(category_debug, 
+                    "No changes of tracked objects to be forwarded");
+                record_latency_at_routine_end(temp, false);
+                mp_free( &node_mempool, temp);
+                return (void *)NULL;
+            }
+
+            strcpy(temp -> content, buf);
+            temp -> content_size = strlen(temp -> content);
+        }
+    }
+
     if(config.is_geofence)
     {
         pkt_type = time_critical_tracked_object_data;
@@ -539,11 +911,13 @@ void *LBeacon_routine(void *_buffer_node){
 
     /* Add the content of the buffer node to the UDP to be sent to the
        Server */
-    udp_addpkt(&udp_config, 
-               config.server_ip, 
-               config.send_port,
-               temp -> content,
-               temp -> content_size);
+    transport_send(&gateway_transport, 
+                   config.server_ip,
+                   config.send_port,
+                   temp -> content,
+                   temp -> content_size);
+
+    record_latency_at_routine_end(temp, true);
 
     mp_free( &node_mempool, temp);
 
@@ -555,15 +929,18 @@ void *Server_routine(void *_buffer_node){
 
     BufferNode *temp = (BufferNode *)_buffer_node;
     int pkt_type = temp->pkt_type;
+    bool is_forwarded = true;
+
+    record_latency_at_routine_start(temp);
     
     switch(pkt_type){
         case tracked_object_data:
         
-            zlog_info(category_debug, "Send tracked data request to LBeacon");
+            async_zlog_info(category_debug, 
+                            "Send tracked data request to LBeacon");
 
-            zlog_info(category_debug, "Start Broadcast to LBeacon");
-            
-            printf("Broadcast to Lbeacons [tracking data]\n");
+            async_zlog_info(category_debug, 
+                            "Start Broadcast to Lbeacons [tracking data]");
 
             broadcast_to_beacons(&LBeacon_address_map, pkt_type, 
                                  temp -> content, 
@@ -578,15 +955,15 @@ void *Server_routine(void *_buffer_node){
             
             // Use beacon_health_report as pkt_type to ask LBeacons to report
             // health report status
-            zlog_info(category_debug, "Send health report request to LBeacon");
+            async_zlog_info(category_debug, 
+                            "Send health report request to LBeacon");
             
             // Use beacon_health_report as pkt_type to ask LBeacons to report
             // health report status
             pkt_type = beacon_health_report;
             
-            zlog_info(category_debug, "Start Broadcast to LBeacon");
-
-            printf("Broadcast to Lbeacons [health status]\n");
+            async_zlog_info(category_debug, 
+                            "Start Broadcast to Lbeacons [health status]");
             
             broadcast_to_beacons(&LBeacon_address_map, pkt_type, 
                                  temp -> content, 
@@ -596,9 +973,10 @@ void *Server_routine(void *_buffer_node){
             
         case notification_alarm:
         
-            zlog_info(category_debug, "Send notification alarm request to Agent");
+            async_zlog_info(category_debug, 
+                            "Send notification alarm request to Agent");
 
-            zlog_info(category_debug, "Start Broadcast to Agent");
+            async_zlog_info(category_debug, "Start Broadcast to Agent");
             
             send_notification_alarm_to_agents(temp -> content, 
                                               temp -> content_size);
@@ -606,9 +984,12 @@ void *Server_routine(void *_buffer_node){
             break;
             
         default:
+            is_forwarded = false;
             break;
     }
 
+    record_latency_at_routine_end(temp, is_forwarded);
+
     mp_free( &node_mempool, temp);
 
     return (void *)NULL;
@@ -617,69 +998,33 @@ void *Server_routine(void *_buffer_node){
 ErrorCode send_join_request(bool report_all_lbeacons, 
                             char *single_lbeacon_uuid){
 
-    char message_buf[WIFI_MESSAGE_LENGTH];
-    char summary_buf[WIFI_MESSAGE_LENGTH];
-    char lbeacons_buf[WIFI_MESSAGE_LENGTH];
-    char one_lbeacon_buf[WIFI_MESSAGE_LENGTH];
-
-    int send_type = 0;
+    JoinReportEntry entry;
     int count = 0;
     int index = -1;
-    int n;
-
-    zlog_debug(category_debug, ">>send_join_request");
-
-    memset(message_buf, 0, sizeof(message_buf));
-    memset(summary_buf, 0, sizeof(summary_buf));
-    memset(lbeacons_buf, 0, sizeof(lbeacons_buf));
-    memset(one_lbeacon_buf, 0, sizeof(one_lbeacon_buf));
+    ErrorCode return_value;
 
-    snprintf(message_buf, sizeof(message_buf), "%d;%d;%s;", 
-             from_gateway, request_to_join, BOT_SERVER_API_VERSION_LATEST);
+    async_zlog_debug(category_debug, ">>send_join_request");
 
     if(report_all_lbeacons == true){
 
-        zlog_debug(category_debug, "report_all_lbeacons=[%d]", 
-                   report_all_lbeacons);
-        pthread_mutex_lock(&LBeacon_address_map.list_lock);
-
-        for(n = 0; n < MAX_NUMBER_NODES; n ++){
-            if (LBeacon_address_map.in_use[n] == true){
+        async_zlog_debug(category_debug, "report_all_lbeacons=[%d]", 
+                         report_all_lbeacons);
 
-                count++;
-                memset(one_lbeacon_buf, 0, sizeof(one_lbeacon_buf));
-                sprintf(one_lbeacon_buf, "%s;%d;%s;%s;", 
-                        LBeacon_address_map.address_map_list[n].uuid, 
-                        LBeacon_address_map.last_reported_timestamp[n],
-                        LBeacon_address_map.address_map_list[n].net_address,
-                        LBeacon_address_map.address_map_list[n].API_version);
+        /* The registry is sent in full or as the changes acknowledged by 
+           the server */
+        return_value = send_registry_sync(&join_report_coalescer);
 
-                if(sizeof(lbeacons_buf) <= 
-                   (strlen(lbeacons_buf) + strlen(one_lbeacon_buf))){
-   
-                    zlog_error(category_debug, 
-                               "lbeacons_buf is not big enough to " \
-                               "include one_lbeacon_buf");
-                    pthread_mutex_unlock(&LBeacon_address_map.list_lock);
-                    return E_BUFFER_SIZE;
-                }
-                strcat(lbeacons_buf, one_lbeacon_buf);
-                
-                zlog_debug(category_debug, 
-                           "lbeacons_buf=[%s]",
-                           lbeacons_buf);
-            }
-        }
+        async_zlog_debug(category_debug, "<<send_join_request");
 
-        pthread_mutex_unlock(&LBeacon_address_map.list_lock);
+        return return_value;
     }
     else if(report_all_lbeacons == false && single_lbeacon_uuid != NULL)
     {
-        zlog_debug(category_debug, 
-                   "report_all_lbeacons=[%d], " \
-                   "single_lbeacon_uuid=[%s]", 
-                   report_all_lbeacons,
-                   single_lbeacon_uuid);
+        async_zlog_debug(category_debug, 
+                         "report_all_lbeacons=[%d], " \
+                         "single_lbeacon_uuid=[%s]", 
+                         report_all_lbeacons,
+                         single_lbeacon_uuid);
 
         pthread_mutex_lock(&LBeacon_address_map.list_lock);
 
@@ -689,185 +1034,38 @@ ErrorCode send_join_request(bool report_all_lbeacons,
         if(index >= 0){
             count = 1;
 
-            memset(lbeacons_buf, 0, sizeof(lbeacons_buf));
-
-            sprintf(lbeacons_buf, "%s;%d;%s;%s;",  
-                    LBeacon_address_map.address_map_list[index].uuid, 
-                    LBeacon_address_map.last_reported_timestamp[index],
-                    LBeacon_address_map.address_map_list[index].net_address,
-                    LBeacon_address_map.address_map_list[index].API_version);
-
-            zlog_debug(category_debug, 
-                       "lbeacons_buf=[%s]",
-                       lbeacons_buf);
+            entry.address_map = LBeacon_address_map.address_map_list[index];
+            entry.last_reported_timestamp = 
+                LBeacon_address_map.last_reported_timestamp[index];
         }
 
         pthread_mutex_unlock(&LBeacon_address_map.list_lock);
     }
 
-    sprintf(summary_buf, 
-            "%d;%s%s;", 
-            count, 
-            config.area_id, 
-            config.serial_id);
-    
+    return_value = send_join_reports(&join_report_coalescer, &entry, count);
 
-    if(sizeof(message_buf) <= strlen(message_buf) + strlen(summary_buf)){
-        zlog_error(category_debug, "message_buf is not big enough to " \
-                                   "include summary_buf");
-        return E_BUFFER_SIZE;
-    }
+    async_zlog_debug(category_debug, "<<send_join_request");
 
-    strcat(message_buf, summary_buf);
-    
-    if(sizeof(message_buf) <= strlen(message_buf) + strlen(lbeacons_buf)){
-        zlog_error(category_debug, "message_buf is not big enough to " \
-                                   "include lbeacons_buf");
-        return E_BUFFER_SIZE;
-    }
-
-    strcat(message_buf, lbeacons_buf);
+    return return_value;
+}
 
-    udp_addpkt(&udp_config, 
-               config.server_ip, 
-               config.send_port,
-               message_buf, 
-               strlen(message_buf));
+ErrorCode send_message_to_server(char *message, int message_size){
 
-    zlog_debug(category_debug, "<<send_join_request");
+    if(transport_send(&gateway_transport, 
+                      config.server_ip,
+                      config.send_port,
+                      message,
+                      message_size) != 0)
+        return E_ADD_PACKET_TO_QUEUE;
 
     return WORK_SUCCESSFULLY;
 }
 
 ErrorCode handle_health_report(){
     BufferNode *new_node = NULL;
-    char message[WIFI_MESSAGE_LENGTH];
-    FILE *self_check_file = NULL;
-    char self_check_buf[WIFI_MESSAGE_LENGTH];
-    FILE *version_file = NULL;
-    char version_buf[WIFI_MESSAGE_LENGTH];
-    FILE *abnormal_lbeacon_file = NULL;
-    char abnormal_lbeacon_buf[WIFI_MESSAGE_LENGTH];
-    int count_abnormal_lbeacon = 0;
-    int retry_times = 0;
-    char message_temp[WIFI_MESSAGE_LENGTH];
-
-
-    // read self-check result
-    retry_times = FILE_OPEN_RETRY;
-    while(retry_times--){
-        self_check_file =
-            fopen(SELF_CHECK_RESULT_FILE_NAME, "r");
-
-        if(NULL != self_check_file){
-            break;
-        }
-    }
-    
-    memset(self_check_buf, 0, sizeof(self_check_buf));
-        
-    if(NULL == self_check_file){
-        zlog_error(category_health_report,
-                   "Error openning file");
-        zlog_error(category_debug,
-                   "Error openning file");
-
-        sprintf(self_check_buf, "%d", 
-                SELF_CHECK_ERROR_OPEN_FILE);
-        
-    }else{
-        fgets(self_check_buf, sizeof(self_check_buf), self_check_file);
-        trim_string_tail(self_check_buf);
-        if(strlen(self_check_buf) == 0){
-            sprintf(self_check_buf, "%d", 
-                    SELF_CHECK_ERROR_OPEN_FILE);            
-        }
-        fclose(self_check_file);
-    } 
-    
-    // read version result
-    retry_times = FILE_OPEN_RETRY;
-    while(retry_times--){
-        version_file =
-            fopen(VERSION_FILE_NAME, "r");
-
-        if(NULL != version_file){
-            break;
-        }
-    }
+    int content_size = 0;
+    int written = 0;
 
-    memset(version_buf, 0, sizeof(version_buf));
-        
-    if(NULL == version_file){
-        zlog_error(category_health_report,
-                   "Error openning file");
-        zlog_error(category_debug,
-                   "Error openning file");
-        
-        sprintf(version_buf, "%d", 
-                SELF_CHECK_ERROR_OPEN_FILE);        
-    }else{
-        fgets(version_buf, sizeof(version_buf), version_file);
-        trim_string_tail(version_buf);
-        if(strlen(version_buf) == 0){
-            sprintf(version_buf, "%d",
-                    SELF_CHECK_ERROR_OPEN_FILE);    
-        }        
-        
-        fclose(version_file);             
-    }
-     
-    // read abnormal lbeacon list 
-    retry_times = FILE_OPEN_RETRY;
-    while(retry_times--){
-        abnormal_lbeacon_file =
-            fopen(ABNORMAL_LBEACON_FILE_NAME, "r");
-
-        if(NULL != abnormal_lbeacon_file){
-            break;
-        }
-    }
-
-    memset(abnormal_lbeacon_buf, 0, sizeof(abnormal_lbeacon_buf));
-    count_abnormal_lbeacon = 0;
-    
-    if(NULL == abnormal_lbeacon_file){
-        zlog_error(category_health_report,
-                   "Error openning file");
-        zlog_error(category_debug,
-                   "Error openning file");
-                   
-        sprintf(abnormal_lbeacon_buf, "%d,;",
-                count_abnormal_lbeacon);        
-    }else{
-        memset(message_temp, 0, sizeof(message_temp));
-        while(NULL != 
-              fgets(message_temp, 
-                    sizeof(message_temp), 
-                    abnormal_lbeacon_file)){
-                  
-            trim_string_tail(message_temp);
-            
-            if(strlen(message_temp) > 0){
-                count_abnormal_lbeacon ++;
-                if(count_abnormal_lbeacon == 1){
-                    sprintf(abnormal_lbeacon_buf,
-                            "%s",
-                            message_temp);
-                }else{                  
-                    strcat(abnormal_lbeacon_buf, ",");
-                    strcat(abnormal_lbeacon_buf, message_temp);
-                }
-            }
-        }
-        
-        sprintf(message_temp, "%d,", count_abnormal_lbeacon);
-        strcat(message_temp, abnormal_lbeacon_buf);
-        strcpy(abnormal_lbeacon_buf, message_temp);
-        
-        fclose(abnormal_lbeacon_file);             
-    }
-     
     new_node = mp_alloc( &node_mempool);
     if(new_node == NULL){
         zlog_error(category_debug, "Cannot malloc memory by mp_alloc");
@@ -879,20 +1077,35 @@ ErrorCode handle_health_report(){
     /* Initialize the entry of the buffer node */
     init_entry( &new_node -> buffer_entry);
         
-    new_node->uptime_at_receive = get_clock_time();
+    new_node->receive_time_in_ns = get_clock_time_in_ns();
+    new_node->enqueue_time_in_ns = new_node->receive_time_in_ns;
     new_node->pkt_direction = from_gateway;
     new_node->pkt_type = gateway_health_report;
     new_node->API_version = atof(BOT_SERVER_API_VERSION_LATEST);
 
-    sprintf(new_node->content, "%d;%d;%s;%s%s;%s;%s;%s;", 
-            from_gateway, 
-            gateway_health_report, 
-            BOT_SERVER_API_VERSION_LATEST, 
-            config.area_id,
-            config.serial_id,            
-            self_check_buf,
-            version_buf,
-            abnormal_lbeacon_buf);
+    content_size = snprintf(new_node->content, sizeof(new_node->content), 
+                            "%d;%d;%s;%s%s;", 
+                            from_gateway, 
+                            gateway_health_report, 
+                            BOT_SERVER_API_VERSION_LATEST, 
+                            config.area_id,
+                            config.serial_id);
+
+    /* The self-check result, version and abnormal LBeacon list are read from
+       the cache, which is refreshed when the files change. */
+    written = write_health_state(&health_state_cache, 
+                                 new_node->content + content_size,
+                                 sizeof(new_node->content) - content_size);
+    if(written < 0){
+        mp_free( &node_mempool, new_node);
+        return E_BUFFER_SIZE;
+    }
+    content_size += written;
+
+    /* The performance section is left out if it does not fit */
+    if(config.is_report_performance_in_health_report == true)
+        get_performance_report(new_node->content + content_size,
+                               sizeof(new_node->content) - content_size);
      
     new_node->content_size = strlen(new_node-> content);
 
@@ -900,8 +1113,9 @@ ErrorCode handle_health_report(){
             config.server_ip, 
             NETWORK_ADDR_LENGTH);
 
-    printf("Report to server [gateway health status]\n"); 
-    printf("message=[%s]\n", new_node -> content);
+    async_zlog_info(category_debug, 
+                    "Report to server [gateway health status], " \
+                    "message=[%s]", new_node -> content);
     
     pthread_mutex_lock(&BHM_send_buffer_list_head.list_lock);
 
@@ -988,36 +1202,33 @@ void broadcast_to_beacons(AddressMapArray *address_map,
                                              
     pthread_mutex_lock( &address_map -> list_lock);
 
-    zlog_info(category_debug, "==Current in Brocast==");
+    async_zlog_info(category_debug, "==Current in Brocast==");
 
     if (size <= WIFI_MESSAGE_LENGTH){
         for(int n = 0; n < MAX_NUMBER_NODES; n++){
 
             if (address_map -> in_use[n] == true){
                 
-                printf("Lbeacon ip: [%s] UUID [%s] at timestamp [%d]\n",
-                       address_map -> address_map_list[n].net_address,
-                       address_map -> address_map_list[n].uuid,
-                       get_system_time());
-                
-                zlog_info(category_debug, "Brocast IP: [%s] UUID [%s]", 
-                                          address_map ->
-                                          address_map_list[n].net_address,
-                                          address_map ->
-                                          address_map_list[n].uuid);
+                async_zlog_info(category_debug, 
+                                "Brocast IP: [%s] UUID [%s] " \
+                                "at timestamp [%d]",
+                                address_map -> 
+                                address_map_list[n].net_address,
+                                address_map -> address_map_list[n].uuid,
+                                get_system_time());
 
                 /* Add the pkt that to be sent to the server */
-                udp_addpkt(&udp_config, 
-                           address_map -> address_map_list[n].net_address, 
-                           config.send_port,
-                           buf, 
-                           strlen(buf));
+                transport_send(&gateway_transport, 
+                               address_map -> address_map_list[n].net_address,
+                               config.send_port,
+                               buf,
+                               strlen(buf));
                             
             }
         }
     }
 
-    zlog_info(category_debug, "END Broadcast");
+    async_zlog_info(category_debug, "END Broadcast");
     pthread_mutex_unlock( &address_map -> list_lock);
 }
 
@@ -1057,8 +1268,8 @@ void send_notification_alarm_to_agents(char *message, int size){
         
         agent_port = strtok_save(NULL, DELIMITER_COMMA, &saveptr);
         if(agent_port == NULL){
-            zlog_debug(category_debug, 
-                       "agent_port is incorrect, abort the action");
+            async_zlog_debug(category_debug, 
+                             "agent_port is incorrect, abort the action");
             continue;
         }
         port = atoi(agent_port);
@@ -1071,17 +1282,17 @@ void send_notification_alarm_to_agents(char *message, int size){
                 alarm_type,
                 alarm_duration_in_sec);
         
-        zlog_debug(category_debug, 
-                   "send notification alarm [%s] to agent [%s:%d]", 
-                   message_to_send,
-                   agent_ip,
-                   port);
+        async_zlog_debug(category_debug, 
+                         "send notification alarm [%s] to agent [%s:%d]", 
+                         message_to_send,
+                         agent_ip,
+                         port);
                        
-        udp_addpkt(&udp_config, 
-                   agent_ip, 
-                   port,
-                   message_to_send, 
-                   strlen(message_to_send));
+        transport_send(&gateway_transport, 
+                       agent_ip,
+                       port,
+                       message_to_send,
+                       strlen(message_to_send));
                    
 
                        
@@ -1089,21 +1300,536 @@ void send_notification_alarm_to_agents(char *message, int size){
                  
 }
 
+void record_latency(LatencyStage stage, 
+                    int pkt_type, 
+                    uint64_t start_time_in_ns, 
+                    uint64_t end_time_in_ns){
+
+    if(pkt_type < 0 || pkt_type >= MAX_PKT_TYPE)
+        pkt_type = undefined;
+
+    /* Skip stages whose start was never stamped */
+    if(start_time_in_ns == 0 || end_time_in_ns < start_time_in_ns)
+        return;
+
+    histogram_record(&latency_histograms[stage][pkt_type],
+                     end_time_in_ns - start_time_in_ns);
+}
+
+void record_latency_at_routine_start(BufferNode *node){
+
+    node->process_start_time_in_ns = get_clock_time_in_ns();
+
+    record_latency(LATENCY_BUFFER_LIST, node->pkt_type,
+                   node->enqueue_time_in_ns, node->dispatch_time_in_ns);
+    record_latency(LATENCY_JOB_QUEUE, node->pkt_type,
+                   node->dispatch_time_in_ns, node->process_start_time_in_ns);
+}
+
+void record_latency_at_routine_end(BufferNode *node, bool is_forwarded){
+
+    uint64_t now = get_clock_time_in_ns();
+
+    record_latency(LATENCY_PROCESS, node->pkt_type,
+                   node->process_start_time_in_ns, now);
+
+    if(is_forwarded)
+        record_latency(LATENCY_FORWARD, node->pkt_type,
+                       node->receive_time_in_ns, now);
+}
+
+void join_request_timer_routine(void *arg){
+
+    int uptime = get_clock_time();
+    int next_check_time;
+
+    if( ( uptime - server_latest_polling_time > 
+          config.interval_receive_message_from_server_in_sec ) && 
+        ( uptime - last_join_request_time >
+          config.interval_for_reconnect_server_in_sec ) ){
+
+        if(WORK_SUCCESSFULLY == send_join_request(true, NULL))
+        {
+            last_join_request_time = uptime;
+        }
+    }
+
+    /* The join request is not needed again until both intervals elapse.
+       Packets from the server in the meantime move the time further, which
+       is checked when the timer is due. */
+    next_check_time = server_latest_polling_time + 
+                      config.interval_receive_message_from_server_in_sec + 1;
+
+    if(next_check_time < last_join_request_time + 
+                         config.interval_for_reconnect_server_in_sec + 1)
+        next_check_time = last_join_request_time + 
+                          config.interval_for_reconnect_server_in_sec + 1;
+
+    if(next_check_time <= uptime)
+        next_check_time = uptime + 1;
+
+    reschedule_timer(&gateway_timers, join_request_timer_id, 
+                     (next_check_time - uptime) * 1000);
+}
+
+void expire_address_map_timer_routine(void *arg){
+
+    /* Release the Lbeacons which have not reported in time */
+    release_not_used_entry_from_Address_Map(
+        &LBeacon_address_map,
+        config.address_map_time_duration_in_sec);
+
+    /* Wake up again when the next Lbeacon expires */
+    reschedule_timer(&gateway_timers, expire_address_map_timer_id,
+                     get_next_expiry_in_ms_from_Address_Map(
+                         &LBeacon_address_map,
+                         config.address_map_time_duration_in_sec));
+}
+
+void lbeacon_evicted(AddressMap *entry, void *arg){
+
+    metric_counter_add(&evicted_lbeacon_count, 1);
+
+    zlog_info(category_debug, "Lbeacon evicted, uuid=[%s], net_address=[%s]",
+              entry -> uuid, entry -> net_address);
+}
+
+void maintain_address_map_timer_routine(void *arg){
+
+    int uptime = get_clock_time();
+    
+    /* Dump active Lbeacons to let shell script try network connection */
+    dump_ip_of_active_entry_from_Address_Map(
+        ACTIVE_LBEACON_FILE_NAME,
+        &LBeacon_address_map,
+        config.address_map_time_duration_in_sec);           
+
+    if(active_lbeacon_snapshot != NULL){
+        dump_ip_of_active_entry_to_snapshot(
+            active_lbeacon_snapshot,
+            &LBeacon_address_map,
+            config.address_map_time_duration_in_sec);
+    }
+
+    if(LBeacon_address_map.generation != 
+       checkpointed_address_map_generation ||
+       uptime - last_checkpoint_address_map_time >
+       config.interval_for_checkpoint_address_map_in_sec){
+
+        if(WORK_SUCCESSFULLY == 
+           save_Address_Map(ADDRESS_MAP_CHECKPOINT_FILE_NAME,
+                            &LBeacon_address_map)){
+
+            checkpointed_address_map_generation = 
+                LBeacon_address_map.generation;
+            last_checkpoint_address_map_time = uptime;
+        }
+    }
+}
+
+void latency_report_timer_routine(void *arg){
+
+    report_latency_statistics();
+}
+
+void report_latency_statistics(){
+
+    Histogram *histogram = NULL;
+    int stage;
+    int pkt_type;
+
+    for(stage = 0; stage < MAX_LATENCY_STAGE; stage++){
+        for(pkt_type = 0; pkt_type < MAX_PKT_TYPE; pkt_type++){
+
+            histogram = &latency_histograms[stage][pkt_type];
+
+            if(__atomic_load_n(&histogram->total_count, 
+                               __ATOMIC_RELAXED) == 0)
+                continue;
+
+            zlog_info(category_performance,
+                      "stage=[%s] pkt_type=[%d] count=[%llu] " \
+                      "p50_us=[%llu] p90_us=[%llu] p99_us=[%llu] " \
+                      "max_us=[%llu]",
+                      latency_stage_names[stage],
+                      pkt_type,
+                      (unsigned long long)histogram->total_count,
+                      (unsigned long long)
+                      (histogram_percentile(histogram, 50) / NS_EACH_US),
+                      (unsigned long long)
+                      (histogram_percentile(histogram, 90) / NS_EACH_US),
+                      (unsigned long long)
+                      (histogram_percentile(histogram, 99) / NS_EACH_US),
+                      (unsigned long long)
+                      (histogram->max_value / NS_EACH_US));
+        }
+    }
+}
+
+void init_performance_report(){
+
+    pthread_mutex_init( &last_performance_report.report_lock, 0);
+
+    last_performance_report.report_time_in_ns = get_clock_time_in_ns();
+    last_performance_report.received_count = 0;
+    last_performance_report.sent_count = 0;
+    last_performance_report.drop_count = 0;
+    last_performance_report.process_time_in_ns = 0;
+
+    histogram_reset(&last_performance_report.forward_latency);
+}
+
+ErrorCode get_performance_report(char *buf, size_t buf_len){
+
+    /* The cumulative and the interval forwarding latency */
+    Histogram forward_latency;
+    Histogram interval_forward_latency;
+    uint64_t now = get_clock_time_in_ns();
+    uint64_t received_count = 0;
+    uint64_t sent_count = 0;
+    uint64_t drop_count = 0;
+    uint64_t process_time_in_ns = 0;
+    uint64_t elapsed_time_in_ns;
+    double elapsed_time_in_sec;
+    double capacity;
+    int mempool_usage = 0;
+    int worker_utilization = 0;
+    int receive_high_water_mark = 0;
+    int send_high_water_mark;
+    int high_water_mark;
+    int written;
+    int pkt_type;
+    int receiver;
+
+    histogram_reset(&forward_latency);
+
+    for(pkt_type = 0; pkt_type < MAX_PKT_TYPE; pkt_type++){
+
+        received_count += __atomic_load_n(
+            &latency_histograms[LATENCY_UDP_RECEIVE_QUEUE][pkt_type].total_count,
+            __ATOMIC_RELAXED);
+
+        process_time_in_ns += __atomic_load_n(
+            &latency_histograms[LATENCY_PROCESS][pkt_type].total_sum,
+            __ATOMIC_RELAXED);
+
+        histogram_add(&forward_latency, 
+                      &latency_histograms[LATENCY_FORWARD][pkt_type]);
+    }
+
+    sent_count = __atomic_load_n(
+        &latency_histograms[LATENCY_UDP_SEND_QUEUE][undefined].total_count,
+        __ATOMIC_RELAXED);
+
+    drop_count = 
+        __atomic_load_n(&udp_config.pkt_Queue.full_drop_count, 
+                        __ATOMIC_RELAXED) +
+        __atomic_load_n(&udp_config.crypto_failure_count, __ATOMIC_RELAXED) +
+        __atomic_load_n(&udp_config.send_failure_count, __ATOMIC_RELAXED) +
+        __atomic_load_n(&node_mempool.alloc_failure_count, __ATOMIC_RELAXED) +
+        __atomic_load_n(&aged_out_packet_count, __ATOMIC_RELAXED);
+
+    capacity = get_mempool_capacity_metric(&node_mempool);
+    if(capacity > 0)
+        mempool_usage = (int)(get_mempool_used_slots_metric(&node_mempool) * 
+                              100 / capacity);
+
+    /* The receive high-water mark is the highest among the receive sockets */
+    for(receiver = 0; receiver < udp_config.number_receivers; receiver++){
+
+        drop_count += __atomic_load_n(
+            &udp_config.receivers[receiver].Received_Queue.full_drop_count, 
+            __ATOMIC_RELAXED);
+
+        /* The high-water marks are reset only after the section is
+           written completely */
+        high_water_mark = __atomic_load_n(
+            &udp_config.receivers[receiver].Received_Queue.high_water_mark,
+            __ATOMIC_RELAXED);
+        if(high_water_mark > receive_high_water_mark)
+            receive_high_water_mark = high_water_mark;
+    }
+
+    send_high_water_mark = __atomic_load_n(
+        &udp_config.pkt_Queue.high_water_mark, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock( &last_performance_report.report_lock);
+
+    elapsed_time_in_ns = now - last_performance_report.report_time_in_ns;
+    if(elapsed_time_in_ns == 0)
+        elapsed_time_in_ns = 1;
+    elapsed_time_in_sec = (double)elapsed_time_in_ns / NS_EACH_SECOND;
+
+    memcpy(&interval_forward_latency, &forward_latency, sizeof(Histogram));
+    histogram_subtract(&interval_forward_latency, 
+                       &last_performance_report.forward_latency);
+
+    if(common_config.number_worker_threads > 0){
+        worker_utilization = 
+            (int)((process_time_in_ns - 
+                   last_performance_report.process_time_in_ns) * 100 / 
+                  ((double)elapsed_time_in_ns * 
+                   common_config.number_worker_threads));
+        if(worker_utilization > 100)
+            worker_utilization = 100;
+    }
+
+    written = snprintf(buf, buf_len, 
+                       "%d,%.1f,%.1f,%llu,%llu,%d,%d,%d,%llu,%d;",
+                       NUMBER_OF_PERFORMANCE_FIELDS,
+                       (received_count - 
+                        last_performance_report.received_count) / 
+                       elapsed_time_in_sec,
+                       (sent_count - last_performance_report.sent_count) / 
+                       elapsed_time_in_sec,
+                       (unsigned long long)
+                       (histogram_percentile(&interval_forward_latency, 50) /
+                        NS_EACH_US),
+                       (unsigned long long)
+                       (histogram_percentile(&interval_forward_latency, 99) /
+                        NS_EACH_US),
+                       mempool_usage,
+                       receive_high_water_mark,
+                       send_high_water_mark,
+                       (unsigned long long)
+                       (drop_count - last_performance_report.drop_count),
+                       worker_utilization);
+
+    if(written < 0 || written >= buf_len){
+
+        pthread_mutex_unlock( &last_performance_report.report_lock);
+
+        /* A partial section is not sent */
+        if(buf_len > 0)
+            buf[0] = '\0';
+        return E_BUFFER_SIZE;
+    }
+
+    for(receiver = 0; receiver < udp_config.number_receivers; receiver++)
+        reset_high_water_mark(&udp_config.receivers[receiver].Received_Queue);
+
+    reset_high_water_mark(&udp_config.pkt_Queue);
+
+    last_performance_report.report_time_in_ns = now;
+    last_performance_report.received_count = received_count;
+    last_performance_report.sent_count = sent_count;
+    last_performance_report.drop_count = drop_count;
+    last_performance_report.process_time_in_ns = process_time_in_ns;
+    memcpy(&last_performance_report.forward_latency, &forward_latency, 
+           sizeof(Histogram));
+
+    pthread_mutex_unlock( &last_performance_report.report_lock);
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode register_gateway_metrics(){
+
+    /* The buffer lists and their names in the labels */
+    struct {
+        BufferListHead *list_head;
+        char *name;
+    } buffer_lists[] = {
+        {&command_msg_buffer_list_head, "command_msg"},
+        {&data_receive_buffer_list_head, "data_receive"},
+        {&NSI_send_buffer_list_head, "NSI_send"},
+        {&NSI_receive_buffer_list_head, "NSI_receive"},
+        {&BHM_send_buffer_list_head, "BHM_send"},
+        {&BHM_receive_buffer_list_head, "BHM_receive"}
+    };
+    char labels[LENGTH_OF_METRIC_LABELS];
+    int return_value = 0;
+    int i;
+    int stage;
+    int pkt_type;
+
+    for(i = 0; i < sizeof(buffer_lists) / sizeof(buffer_lists[0]); i++){
+
+        snprintf(labels, sizeof(labels), "list=\"%s\"", 
+                 buffer_lists[i].name);
+        return_value |= register_metric_gauge(
+            &gateway_metrics, "gateway_buffer_list_length", labels,
+            "Number of buffer nodes waiting in the buffer list.",
+            get_buffer_list_length_metric, buffer_lists[i].list_head);
+    }
+
+    /* The samples of a family are registered together, so that its HELP and
+       TYPE lines are exported only once */
+    return_value |= register_metric_gauge(
+        &gateway_metrics, "gateway_pkt_queue_length", "queue=\"send\"",
+        "Number of pkts waiting in the UDP pkt queue.",
+        get_pkt_queue_length_metric, &udp_config.pkt_Queue);
+
+    for(i = 0; i < udp_config.number_receivers; i++){
+
+        snprintf(labels, sizeof(labels), "queue=\"receive\",socket=\"%d\"", 
+                 i);
+        return_value |= register_metric_gauge(
+            &gateway_metrics, "gateway_pkt_queue_length", labels,
+            "Number of pkts waiting in the UDP pkt queue.",
+            get_pkt_queue_length_metric, 
+            &udp_config.receivers[i].Received_Queue);
+    }
+
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_pkt_queue_full_drops_total", 
+        "queue=\"send\"",
+        "Number of pkts dropped because the UDP pkt queue is full.",
+        &udp_config.pkt_Queue.full_drop_count);
+
+    for(i = 0; i < udp_config.number_receivers; i++){
+
+        snprintf(labels, sizeof(labels), "queue=\"receive\",socket=\"%d\"", 
+                 i);
+        return_value |= register_metric_counter(
+            &gateway_metrics, "gateway_pkt_queue_full_drops_total", labels,
+            "Number of pkts dropped because the UDP pkt queue is full.",
+            &udp_config.receivers[i].Received_Queue.full_drop_count);
+    }
+
+    return_value |= register_metric_gauge(
+        &gateway_metrics, "gateway_mempool_used_slots", NULL,
+        "Number of buffer nodes in use in the memory pool.",
+        get_mempool_used_slots_metric, &node_mempool);
+    return_value |= register_metric_gauge(
+        &gateway_metrics, "gateway_mempool_capacity_slots", NULL,
+        "Number of buffer nodes allocated by the memory pool.",
+        get_mempool_capacity_metric, &node_mempool);
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_mempool_alloc_failures_total", NULL,
+        "Number of buffer nodes failed to be allocated.",
+        &node_mempool.alloc_failure_count);
+
+    return_value |= register_metric_gauge(
+        &gateway_metrics, "gateway_thpool_working_threads", NULL,
+        "Number of worker threads running a job.",
+        get_thpool_working_threads_metric, &thpool);
+    return_value |= register_metric_gauge(
+        &gateway_metrics, "gateway_thpool_job_queue_length", NULL,
+        "Number of jobs waiting for a worker thread.",
+        get_thpool_job_queue_length_metric, &thpool);
+
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_crypto_failures_total", NULL,
+        "Number of received pkts whose token or hash cannot be verified.",
+        &udp_config.crypto_failure_count);
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_send_failures_total", NULL,
+        "Number of pkts failed to be sent by the socket.",
+        &udp_config.send_failure_count);
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_replayed_pkts_total", NULL,
+        "Number of pkts replayed from captured files.",
+        &udp_config.replayed_count);
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_aged_out_drops_total", NULL,
+        "Number of packets dropped because they are out of date.",
+        &aged_out_packet_count);
+
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_join_reports_sent_total", NULL,
+        "Number of request_to_join messages sent by the join coalescer.",
+        &join_report_coalescer.sent_message_count);
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_join_reported_lbeacons_total", NULL,
+        "Number of LBeacons reported by the join coalescer.",
+        &join_report_coalescer.reported_lbeacon_count);
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_registry_syncs_total", "type=\"full\"",
+        "Number of registry syncs sent to the server.",
+        &join_report_coalescer.full_sync_count);
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_registry_syncs_total", 
+        "type=\"differential\"",
+        "Number of registry syncs sent to the server.",
+        &join_report_coalescer.differential_sync_count);
+
+    return_value |= register_metric_gauge(
+        &gateway_metrics, "gateway_address_map_entries", NULL,
+        "Number of LBeacons in the AddressMap.",
+        get_address_map_size_metric, &LBeacon_address_map);
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_address_map_evictions_total", NULL,
+        "Number of LBeacons released for not reporting in time.",
+        &evicted_lbeacon_count);
+
+    return_value |= register_metric_counter(
+        &gateway_metrics, "gateway_log_drops_total", NULL,
+        "Number of log messages dropped because the writer fell behind.",
+        &gateway_async_logger.drop_count);
+
+    for(stage = 0; stage < MAX_LATENCY_STAGE; stage++){
+        for(pkt_type = 0; pkt_type < MAX_PKT_TYPE; pkt_type++){
+
+            snprintf(labels, sizeof(labels), 
+                     "stage=\"%s\",pkt_type=\"%d\"",
+                     latency_stage_names[stage], pkt_type);
+            return_value |= register_metric_summary(
+                &gateway_metrics, "gateway_latency_seconds", labels,
+                "Time spent by packets in each stage of the gateway.",
+                &latency_histograms[stage][pkt_type]);
+        }
+    }
+
+    if(return_value != 0)
+        return E_INITIALIZATION_FAIL;
+
+    return WORK_SUCCESSFULLY;
+}
+
 ErrorCode Wifi_init(){
 
+    /* A test harness has set its own transport, so no socket is opened */
+    if(gateway_transport.send != NULL)
+        return WORK_SUCCESSFULLY;
+
     /* Initialize the Wifi cinfig file */
-    if(udp_initial( &udp_config, config.recv_port)
-                   != WORK_SUCCESSFULLY){
+    if(udp_initial_with_receivers( &udp_config, config.recv_port,
+                                   config.number_receive_sockets,
+                                   config.pkt_queue_length)
+                                   != WORK_SUCCESSFULLY){
 
         /* Error handling TODO */
         return E_WIFI_INIT_FAIL;
     }
+
+    if(strlen(config.capture_file_name) > 0 &&
+       udp_start_capture( &udp_config, config.capture_file_name) != 0){
+
+        zlog_error(category_health_report, 
+                   "Cannot create the capture file [%s]", 
+                   config.capture_file_name);
+    #ifdef debugging
+        zlog_error(category_debug, "Cannot create the capture file [%s]", 
+                   config.capture_file_name);
+    #endif
+    }
+
+    if(strlen(config.replay_file_name) > 0 &&
+       udp_start_replay( &udp_config, config.replay_file_name, 
+                        config.replay_speed) != 0){
+
+        zlog_error(category_health_report, 
+                   "Cannot replay the capture file [%s]", 
+                   config.replay_file_name);
+    #ifdef debugging
+        zlog_error(category_debug, "Cannot replay the capture file [%s]", 
+                   config.replay_file_name);
+    #endif
+    }
+
+    init_udp_transport( &gateway_transport, &udp_config);
+
     return WORK_SUCCESSFULLY;
 }
 
 
 void Wifi_free(){
 
+    /* The transport set by a test harness is released by the harness */
+    if(gateway_transport.context != &udp_config)
+        return (void)NULL;
+
     /* Release the Wifi elements and close the connection. */
     udp_release( &udp_config);
     return (void)NULL;
@@ -1114,12 +1840,16 @@ void *process_wifi_send(void *_buffer_node){
 
     BufferNode *temp = (BufferNode *)_buffer_node;
 
+    record_latency_at_routine_start(temp);
+
     /* Add the content that to be sent to the server */
-    udp_addpkt(&udp_config, 
-               temp -> net_address, 
-               config.send_port, 
-               temp->content, 
-               temp->content_size);
+    transport_send(&gateway_transport, 
+                   temp -> net_address,
+                   config.send_port,
+                   temp->content,
+                   temp->content_size);
+
+    record_latency_at_routine_end(temp, true);
 
     mp_free( &node_mempool, temp);
 
@@ -1127,9 +1857,11 @@ void *process_wifi_send(void *_buffer_node){
 }
 
 
-void *process_wifi_receive(){
-    int last_join_request_time;
+void *process_wifi_receive(void *_receiver){
+    int receiver = (int)(intptr_t)_receiver;
     int uptime;
+    uint64_t receive_time_in_ns;
+    uint64_t dequeue_time_in_ns;
 
     char buf[WIFI_MESSAGE_LENGTH];
     char *saveptr = NULL;
@@ -1140,6 +1872,10 @@ void *process_wifi_receive(){
     char *API_version = NULL;
     float API_latest_version = 0;
 
+    sPkt temppkt;
+
+
+    apply_thread_role(THREAD_ROLE_IO);
 
     sscanf(BOT_GATEWAY_API_VERSION_LATEST, "%f", &API_latest_version);
     
@@ -1147,24 +1883,27 @@ void *process_wifi_receive(){
 
         BufferNode *new_node;
 
-        sPkt temppkt = udp_getrecv( &udp_config);
-
-        if(temppkt.is_null == true){
+        if(transport_receive( &gateway_transport, receiver, &temppkt) != 
+           pkt_Queue_SUCCESS){
             /* If there is no packet received, sleep a short time */
             sleep_t(BUSY_WAITING_TIME_IN_MS);
             continue;
         }
         
-        uptime = get_clock_time();
+        /* The packet is stamped when it is added to the receive queue right
+           after it is received from the socket */
+        receive_time_in_ns = temppkt.enqueue_time_in_ns;
+        dequeue_time_in_ns = get_clock_time_in_ns();
+        uptime = (int)(dequeue_time_in_ns / NS_EACH_SECOND);
         /* Allocate memory from node_mempool a buffer node for received data
            and copy the data from Wi-Fi receive queue to the node. */
         
         new_node = mp_alloc( &node_mempool);
                
         if(new_node == NULL){
-            zlog_debug(category_debug, 
-                       "process_wifi_receive (new_node) mp_alloc " \
-                       "failed, abort this data");
+            async_zlog_debug(category_debug, 
+                             "process_wifi_receive (new_node) mp_alloc " \
+                             "failed, abort this data");
             continue;
         }
         
@@ -1173,7 +1912,7 @@ void *process_wifi_receive(){
         /* Initialize the entry of the buffer node */
         init_entry( &new_node -> buffer_entry);
         
-        new_node->uptime_at_receive = get_clock_time();
+        new_node->receive_time_in_ns = receive_time_in_ns;
 
         memset(buf, 0, sizeof(buf));
         strcpy(buf, temppkt.content);
@@ -1213,17 +1952,24 @@ void *process_wifi_receive(){
 
         new_node -> content_size = strlen(new_node -> content);
 
-        zlog_info(category_debug, "pkt_direction=[%d], " \
-                  "pkt_type=[%d] API_version=[%f] " \
-                  "new_node -> content=[%s]",   
-                  new_node->pkt_direction, 
-                  new_node->pkt_type,
-                  new_node->API_version,
-                  new_node -> content);
+        async_zlog_info(category_debug, "pkt_direction=[%d], " \
+                        "pkt_type=[%d] API_version=[%f] " \
+                        "new_node -> content=[%s]",   
+                        new_node->pkt_direction, 
+                        new_node->pkt_type,
+                        new_node->API_version,
+                        new_node -> content);
 
         memcpy(new_node -> net_address, temppkt.address, 
                NETWORK_ADDR_LENGTH);
 
+        new_node -> enqueue_time_in_ns = get_clock_time_in_ns();
+
+        record_latency(LATENCY_UDP_RECEIVE_QUEUE, new_node -> pkt_type,
+                       receive_time_in_ns, dequeue_time_in_ns);
+        record_latency(LATENCY_PARSE, new_node -> pkt_type,
+                       dequeue_time_in_ns, new_node -> enqueue_time_in_ns);
+
         /* Insert the node to the specified buffer, and release
            list_lock. */
         switch (new_node -> pkt_direction) {
@@ -1236,16 +1982,20 @@ void *process_wifi_receive(){
 
                     case join_response:
                     
-                        zlog_info(category_debug,
-                                  "Get Join Request Result from the Server");
+                        async_zlog_info(category_debug,
+                            "Get Join Request Result from the Server");
+
+                        acknowledge_registry_sync(&join_report_coalescer,
+                                                  new_node -> content);
+
                         mp_free(&node_mempool, new_node);
                         
                         break;
                         
                     case gateway_health_report:
        
-                        zlog_info(category_debug,
-                                  "Get Health Report from the Server");
+                        async_zlog_info(category_debug,
+                                        "Get Health Report from the Server");
                         pthread_mutex_lock(&command_msg_buffer_list_head
                                            .list_lock);
                         insert_list_tail(&new_node -> buffer_entry,
@@ -1258,8 +2008,8 @@ void *process_wifi_receive(){
 
                     case tracked_object_data:
                 
-                        zlog_info(category_debug,
-                                  "Get Tracked Object Data from the Server");
+                        async_zlog_info(category_debug,
+                            "Get Tracked Object Data from the Server");
                         pthread_mutex_lock(&command_msg_buffer_list_head
                                            .list_lock);
                         insert_list_tail(&new_node -> buffer_entry,
@@ -1271,8 +2021,8 @@ void *process_wifi_receive(){
                      
                     case notification_alarm:
                 
-                        zlog_info(category_debug,
-                                  "Get Send Notification Alarm from the Server");
+                        async_zlog_info(category_debug,
+                            "Get Send Notification Alarm from the Server");
                         pthread_mutex_lock(&command_msg_buffer_list_head
                                            .list_lock);
                         insert_list_tail(&new_node -> buffer_entry,
@@ -1302,8 +2052,8 @@ void *process_wifi_receive(){
 
                     case request_to_join:
                     
-                        zlog_info(category_debug,
-                                  "Get Join Request from LBeacon");
+                        async_zlog_info(category_debug,
+                                        "Get Join Request from LBeacon");
                         pthread_mutex_lock(&NSI_receive_buffer_list_head
                                            .list_lock);
                         insert_list_tail(&new_node -> buffer_entry,
@@ -1315,8 +2065,8 @@ void *process_wifi_receive(){
 
                     case tracked_object_data:
                    
-                        zlog_info(category_debug,
-                                  "Get Tracked Object Data from LBeacon");
+                        async_zlog_info(category_debug,
+                                        "Get Tracked Object Data from LBeacon");
                         pthread_mutex_lock(&data_receive_buffer_list_head
                                            .list_lock);
                         insert_list_tail(&new_node -> buffer_entry,
@@ -1328,8 +2078,8 @@ void *process_wifi_receive(){
 
                     case beacon_health_report:
                     
-                        zlog_info(category_debug,
-                                  "Get Health Report from LBeacon");
+                        async_zlog_info(category_debug,
+                                        "Get Health Report from LBeacon");
                         pthread_mutex_lock(&BHM_receive_buffer_list_head
                                            .list_lock);
                         insert_list_tail(&new_node -> buffer_entry,
@@ -45,6 +45,12 @@
 #define _GNU_SOURCE
 
 #include "BeDIS.h"
+#include "Aggregator.h"
+#include "HealthCache.h"
+#include "Prober.h"
+#include "JoinReport.h"
+#include "TimerQueue.h"
+#include "Transport.h"
 
 /* Enable debugging mode. */
 #define debugging
@@ -60,6 +66,12 @@
 /* File path of the temporary file for active Lbeacons */
 #define ACTIVE_LBEACON_FILE_NAME "../log/active_lbeacon_list"
 
+/* File path of the checkpoint of the Lbeacon AddressMap for warm restart */
+#define ADDRESS_MAP_CHECKPOINT_FILE_NAME "../log/lbeacon_address_map"
+
+/* Name of the shared memory object for the snapshot of active Lbeacons */
+#define ACTIVE_LBEACON_SHM_NAME "/bedis_gateway_active_lbeacon_list"
+
 /* File path of the temporary file for abnormal Lbeacons */
 #define ABNORMAL_LBEACON_FILE_NAME "../log/abnormal_lbeacon_list"
 
@@ -80,12 +92,61 @@ gateway sends UDP join_request to the server again.
 /* Time interval in seconds for reconnect to server */
 #define INTERVAL_FOR_RECONNECT_SERVER_IN_SEC 30
 
-/* Time interval in seconds for dumping active Lbeacons ip addresses */
-#define INTERVAL_FOR_DUMP_ACTIVE_LBEACONS_IN_SEC 60
+/* Time interval in seconds for checking whether active Lbeacons ip addresses
+   need to be dumped. The dump is skipped when the set of active Lbeacons is
+   unchanged. */
+#define INTERVAL_FOR_DUMP_ACTIVE_LBEACONS_IN_SEC 5
+
+/* Time interval in seconds for checkpointing the Lbeacon AddressMap when its
+   membership is unchanged, to keep the reported timestamps in the checkpoint
+   fresh */
+#define INTERVAL_FOR_CHECKPOINT_ADDRESS_MAP_IN_SEC 60
 
 /* The number of slots in the memory pool for buffer nodes */
 #define SLOTS_IN_MEM_POOL_BUFFER_NODE 2048
 
+/* Time interval in seconds for logging latency statistics */
+#define INTERVAL_FOR_LATENCY_REPORT_IN_SEC 60
+
+/* The category of log file used for performance statistics */
+#define LOG_CATEGORY_PERFORMANCE "Performance"
+
+/* The number of packet types, used to index per-type statistics */
+#define MAX_PKT_TYPE (ipc_command + 1)
+
+/* The number of values in the performance section of the health report */
+#define NUMBER_OF_PERFORMANCE_FIELDS 9
+
+/* Stages of the gateway pipeline in which packets spend time */
+typedef enum _LatencyStage {
+
+    /* From the socket to process_wifi_receive through the receive queue,
+       including decoding */
+    LATENCY_UDP_RECEIVE_QUEUE = 0,
+
+    /* Parsing in process_wifi_receive */
+    LATENCY_PARSE = 1,
+
+    /* Waiting in a buffer list for CommUnit_routine */
+    LATENCY_BUFFER_LIST = 2,
+
+    /* Waiting in the job queue of the thread pool for a worker thread */
+    LATENCY_JOB_QUEUE = 3,
+
+    /* Processing by the routine of the buffer list */
+    LATENCY_PROCESS = 4,
+
+    /* From the socket to the send queue, i.e. the forwarding latency */
+    LATENCY_FORWARD = 5,
+
+    /* Waiting in the send queue for the socket. The packet type is not known
+       in the send queue, so only the undefined type is recorded. */
+    LATENCY_UDP_SEND_QUEUE = 6,
+
+    MAX_LATENCY_STAGE = 7
+
+} LatencyStage;
+
 /* Global variables */
 
 /* The configuration file structure */
@@ -110,29 +171,250 @@ typedef struct {
     
     /* The valid time duration for entries in Lbeacon AddressMap */
     int address_map_time_duration_in_sec;
-    
+
+    /* A flag indicating whether tracked object data from LBeacons is
+       aggregated so that only changes are forwarded to the server. */
+    bool is_aggregate_tracked_object_data;
+
+    /* The minimal change of rssi which makes an object be forwarded */
+    int aggregation_rssi_threshold;
+
+    /* The longest time in seconds an unchanged object is held back */
+    int aggregation_full_snapshot_interval_in_sec;
+
+    /* The time in seconds after which an object not reported is lost */
+    int aggregation_lost_object_timeout_in_sec;
+
+    /* The port on the loopback interface to export metrics on, or 0 if 
+       metrics are not exported */
+    int metrics_port;
+
+    /* A flag indicating whether the health report of the gateway carries a
+       section of performance statistics */
+    bool is_report_performance_in_health_report;
+
+    /* The time interval in seconds between two rounds of probing LBeacons by
+       the gateway itself, or 0 if the abnormal LBeacon list is generated by
+       the ping_ip.sh script */
+    int lbeacon_probe_interval_in_sec;
+
+    /* The maximal number of probes sent to LBeacons per second */
+    int lbeacon_probe_rate_per_sec;
+
+    /* A flag indicating whether active LBeacons are also dumped to a 
+       snapshot in shared memory for external tools */
+    bool is_dump_active_lbeacon_to_shared_memory;
+
+    /* The time in milliseconds LBeacons joined are collected before being 
+       reported to the server together, or 0 if every LBeacon joined is 
+       reported immediately */
+    int join_report_window_in_ms;
+
+    /* A flag indicating whether the registry of LBeacons is synchronized 
+       with the server by the changes since the generation the server
+       acknowledged, instead of in full every time */
+    bool is_differential_registry_sync;
+
+    /* The file the packets received from the socket are captured to, or an
+       empty string if the packets are not captured */
+    char capture_file_name[CONFIG_BUFFER_SIZE];
+
+    /* The captured file replayed instead of receiving from the socket when 
+       the gateway starts, or an empty string if no file is replayed */
+    char replay_file_name[CONFIG_BUFFER_SIZE];
+
+    /* The speed of the replay relative to the capture, or 0 if the packets
+       are replayed as fast as they are processed */
+    double replay_speed;
+
+    /* The number of sockets receiving on recv_port, each with its own 
+       receive and parsing threads. More than one socket lets the packets
+       of different LBeacons be received on different cores. */
+    int number_receive_sockets;
+
+    /* A flag indicating whether the threads of the gateway are pinned and 
+       prioritized by their roles. The io threads (UDP, process_wifi_receive)
+       get time_critical_priority, CommUnit_routine high_priority, the 
+       workers normal_priority and the periodical threads low_priority. */
+    bool is_thread_profile_enabled;
+
+    /* The CPUs of the io threads and CommUnit_routine, such as "1" or 
+       "2-3", or an empty string if they are not pinned */
+    char io_cpu_list[CONFIG_BUFFER_SIZE];
+
+    /* The CPUs of the worker and periodical threads, or an empty string if
+       they are not pinned */
+    char worker_cpu_list[CONFIG_BUFFER_SIZE];
+
+    /* The scheduling policy of the io threads and CommUnit_routine, i.e. 
+       "other", "fifo" or "rr". Under fifo and rr their priorities are 
+       mapped to real-time priorities. */
+    char thread_scheduling_policy[CONFIG_BUFFER_SIZE];
+
+    /* A flag indicating whether the memory of the gateway is locked, so 
+       that no thread waits for a page fault */
+    bool is_memory_locked;
+
+    /* A flag indicating whether the messages logged while packets are 
+       processed are written by a writer thread. Messages are dropped 
+       instead of delaying the packets when the writer thread falls 
+       behind. */
+    bool is_async_logging;
+
+    /* A flag indicating whether the threads processing packets only copy
+       the arguments of their messages, leaving the formatting to the 
+       writer thread. It takes effect with is_async_logging. */
+    bool is_log_format_deferred;
+
+    /* The number of slots in the memory pool for buffer nodes */
+    int slots_in_mem_pool_buffer_node;
+
+    /* The number of packets in the send queue and in each received queue,
+       a power of two no larger than MAX_QUEUE_LENGTH */
+    int pkt_queue_length;
+
+    /* The time in seconds without packets from the server after which the
+       gateway joins the server again */
+    int interval_receive_message_from_server_in_sec;
+
+    /* The time interval in seconds between two join requests */
+    int interval_for_reconnect_server_in_sec;
+
+    /* The time interval in seconds for checking whether active LBeacons
+       need to be dumped */
+    int interval_for_dump_active_lbeacons_in_sec;
+
+    /* The time interval in seconds for checkpointing the LBeacon AddressMap
+       when its membership is unchanged */
+    int interval_for_checkpoint_address_map_in_sec;
+
+    /* The time interval in seconds for logging latency statistics */
+    int interval_for_latency_report_in_sec;
+
 } GatewayConfig;
 
+/* The cumulative statistics at the latest performance report, from which the
+   next report computes the statistics of the interval in between */
+typedef struct {
+
+    /* The lock for generating a report */
+    pthread_mutex_t report_lock;
+
+    /* The uptime in nanoseconds of the latest report */
+    uint64_t report_time_in_ns;
+
+    /* The number of packets received from the socket */
+    uint64_t received_count;
+
+    /* The number of packets sent to the socket */
+    uint64_t sent_count;
+
+    /* The number of packets dropped for any reason */
+    uint64_t drop_count;
+
+    /* The time in nanoseconds spent by worker threads on processing */
+    uint64_t process_time_in_ns;
+
+    /* The histogram of forwarding latency of all packet types */
+    Histogram forward_latency;
+
+} PerformanceReport;
+
 /* A gateway config struct for storing config parameters from the config file */
 GatewayConfig config;
 
 /* An array of address maps */
 AddressMapArray LBeacon_address_map;
 
+/* The states of tracked objects for forwarding only changes to the server */
+TrackedObjectAggregator tracked_object_aggregator;
+
 /* The head of a list of buffers for polling messages and commands */
 BufferListHead command_msg_buffer_list_head;
 
 /* The last polling times in second*/
 int server_latest_polling_time;
 
+/* The timers of the periodic work of the gateway, run by the main thread */
+TimerQueue gateway_timers;
+
+/* The id of the timer for sending join requests to the server */
+int join_request_timer_id;
+
+/* The id of the timer for releasing Lbeacons at their deadlines */
+int expire_address_map_timer_id;
+
+/* The number of Lbeacons released for not reporting in time */
+uint64_t evicted_lbeacon_count;
+
+/* The uptime in seconds at which the latest join request was sent */
+int last_join_request_time;
+
+/* The uptime in seconds at which the AddressMap was checkpointed most 
+   recently, and the generation of the AddressMap checkpointed */
+int last_checkpoint_address_map_time;
+uint64_t checkpointed_address_map_generation;
+
+/* The histograms of time in nanoseconds spent by packets of each type in 
+   each stage */
+Histogram latency_histograms[MAX_LATENCY_STAGE][MAX_PKT_TYPE];
 
+/* The pointer to the category of the log file for performance statistics */
+zlog_category_t *category_performance;
+
+/* The registry of metrics exported to the local host */
+MetricsRegistry gateway_metrics;
+
+/* The statistics at the latest performance section of the health report */
+PerformanceReport last_performance_report;
+
+/* The cached inputs of the health report */
+HealthStateCache health_state_cache;
+
+/* The prober of the liveness of LBeacons */
+LBeaconProber lbeacon_prober;
+
+/* The snapshot of active LBeacons in shared memory, or NULL if active 
+   LBeacons are only dumped to the file */
+ActiveEntrySnapshot *active_lbeacon_snapshot;
+
+/* The coalescer of join reports of LBeacons to the server */
+JoinReportCoalescer join_report_coalescer;
+
+/* The transport the messages from and to LBeacons, the server and agents
+   are carried by. If it is not set before run_gateway, it is the UDP 
+   transport over udp_config. */
+Transport gateway_transport;
+
+/* The logger writing the messages logged while packets are processed */
+AsyncLogger gateway_async_logger;
+
+
+
+/*
+  run_gateway:
+
+     This function initializes the gateway, runs it until ready_to_work 
+     becomes false and releases it. The main function of the gateway and
+     test harnesses linking the gateway call it.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error or successful
+ */
+ErrorCode run_gateway();
 
 /*
   get_gateway_config:
 
-     This function reads the specified config file line by line until the
-     end of file and copies the data in each line into an element of the
-     GatewayConfig struct global variable.
+     This function reads the keys of the specified config file, in any 
+     order, into the elements of the GatewayConfig and CommonConfig 
+     structs. Keys missing from the file, and values malformed or out of
+     range, take the default values.
 
   Parameters:
      config - gateway related configration settings
@@ -148,6 +430,24 @@ ErrorCode get_gateway_config(GatewayConfig *config,
                              CommonConfig *common_config, 
                              char *file_name);
 
+/*
+  init_thread_profile:
+
+     This function sets the threading profile of the gateway from the 
+     configuration and locks the memory if it is configured. It is called 
+     before any thread is started, so that every thread applies the 
+     profile of its role when it starts.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error or successful
+ */
+ErrorCode init_thread_profile();
+
 /*
   NSI_routine:
 
@@ -228,7 +528,10 @@ void *Server_routine(void *_buffer_node);
 
       This function sends join_request of a gateway to the server when there 
       is no packets from the server for a specified long time or when there is 
-      a new LBeacon requesting to join to this gateway.
+      a new LBeacon requesting to join to this gateway. The registered 
+      lbeacons are split into as many join_request messages as needed to fit
+      in WIFI_MESSAGE_LENGTH, or only the changes since the generation the
+      server acknowledged are sent if differential registry sync is enabled.
 
   Parameters:
 
@@ -246,6 +549,23 @@ void *Server_routine(void *_buffer_node);
 ErrorCode send_join_request(bool report_all_lbeacons, 
                             char *single_lbeacon_uuid);
 
+/*
+  send_message_to_server:
+
+      This function puts a message to the server into the UDP send queue.
+
+  Parameters:
+
+      message - The message to be sent.
+      message_size - The size in bytes of the message.
+
+  Return value:
+
+      ErrorCode - The error code for the corresponding error if the function
+                  fails or WORK SUCCESSFULLY otherwise
+*/
+ErrorCode send_message_to_server(char *message, int message_size);
+
 /*
   handle_health_report:
 
@@ -332,10 +652,230 @@ void broadcast_to_beacons(AddressMapArray *address_map,
 */
 void send_notification_alarm_to_agents(char *message, int size);
 
+/*
+  record_latency:
+
+     This function records the time a packet spent in a stage of the gateway
+     pipeline.
+
+  Parameters:
+
+     stage - The stage of the gateway pipeline.
+     pkt_type - The type of the packet.
+     start_time_in_ns - The uptime in nanoseconds the stage started.
+     end_time_in_ns - The uptime in nanoseconds the stage ended.
+
+  Return value:
+
+     None
+ */
+void record_latency(LatencyStage stage, 
+                    int pkt_type, 
+                    uint64_t start_time_in_ns, 
+                    uint64_t end_time_in_ns);
+
+/*
+  record_latency_at_routine_start:
+
+     This function is called by a worker thread when it starts processing a 
+     buffer node. It records the time the buffer node waited in the buffer 
+     list and in the job queue of the thread pool.
+
+  Parameters:
+
+     node - A pointer to the buffer node.
+
+  Return value:
+
+     None
+ */
+void record_latency_at_routine_start(BufferNode *node);
+
+/*
+  record_latency_at_routine_end:
+
+     This function is called by a worker thread when it finishes processing a 
+     buffer node. It records the time spent on processing. When the content
+     has been handed over to the send queue, the forwarding latency is 
+     recorded as well.
+
+  Parameters:
+
+     node - A pointer to the buffer node.
+     is_forwarded - A flag indicating whether the content has been handed 
+                    over to the send queue.
+
+  Return value:
+
+     None
+ */
+void record_latency_at_routine_end(BufferNode *node, bool is_forwarded);
+
+/*
+  join_request_timer_routine:
+
+     This function sends join requests of the gateway to the server when no
+     packets come from the server for a specified long time, and reschedules
+     its timer to the earliest time the next join request may be needed.
+
+  Parameters:
+
+     arg - Not used.
+
+  Return value:
+
+     None
+ */
+void join_request_timer_routine(void *arg);
+
+/*
+  expire_address_map_timer_routine:
+
+     This function releases the LBeacons not reporting within the tolerant
+     duration and reschedules its timer to the deadline of the LBeacon which
+     expires next.
+
+  Parameters:
+
+     arg - Not used.
+
+  Return value:
+
+     None
+ */
+void expire_address_map_timer_routine(void *arg);
+
+/*
+  lbeacon_evicted:
+
+     This function is called for each LBeacon released from the AddressMap.
+
+  Parameters:
+
+     entry - The entry of the LBeacon released.
+     arg - Not used.
+
+  Return value:
+
+     None
+ */
+void lbeacon_evicted(AddressMap *entry, void *arg);
+
+/*
+  maintain_address_map_timer_routine:
+
+     This function dumps the active LBeacons and checkpoints the AddressMap
+     periodically.
+
+  Parameters:
+
+     arg - Not used.
+
+  Return value:
+
+     None
+ */
+void maintain_address_map_timer_routine(void *arg);
+
+/*
+  latency_report_timer_routine:
+
+     This function logs the latency statistics periodically.
+
+  Parameters:
+
+     arg - Not used.
+
+  Return value:
+
+     None
+ */
+void latency_report_timer_routine(void *arg);
+
+/*
+  report_latency_statistics:
+
+     This function logs the count and percentiles of the time spent in each
+     stage by packets of each type since the gateway started.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+ */
+void report_latency_statistics();
+
+/*
+  init_performance_report:
+
+     This function starts the first interval of the performance section of
+     the health report.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+ */
+void init_performance_report();
+
+/*
+  get_performance_report:
+
+     This function generates the performance section of the health report
+     from the in-process counters and histograms. The statistics cover the 
+     interval since the previous call, or since the gateway started. The
+     section consists of NUMBER_OF_PERFORMANCE_FIELDS comma-separated values
+     following the number of values:
+        packets received per second, packets sent per second,
+        p50 and p99 forwarding latency in microseconds,
+        usage percentage of the memory pool of buffer nodes,
+        high-water marks of the receive and send pkt queues,
+        number of packets dropped,
+        utilization percentage of the worker threads.
+     The section ends with ';'. If it does not fit in the buffer, the buffer
+     is left empty and the interval is not ended, so that the high-water
+     marks and counters are carried to the next report.
+
+  Parameters:
+
+     buf - The output buffer.
+     buf_len - The size in bytes of the output buffer.
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error or successful
+ */
+ErrorCode get_performance_report(char *buf, size_t buf_len);
+
+/*
+  register_gateway_metrics:
+
+     This function registers the depths of the pkt queues and buffer lists,
+     the usage of the memory pool and the thread pool, the drop counters, 
+     the size of the AddressMap and the latency histograms in the metrics 
+     registry of the gateway.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error or successful
+ */
+ErrorCode register_gateway_metrics();
+
 /*
   Wifi_init:
 
-     This function initializes the Wifi objects.
+     This function initializes the Wifi objects and sets the UDP transport
+     as the transport of the gateway, unless another transport is set.
 
   Parameters:
 
@@ -392,12 +932,12 @@ void *process_wifi_send(void *_buffer_node);
 
   Parameters:
 
-     None
+     receiver - The index of the receiver of the transport to listen on.
 
   Return value:
 
      None
  */
-void *process_wifi_receive();
+void *process_wifi_receive(void *receiver);
 
 #endif
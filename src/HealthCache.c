@@ -0,0 +1,356 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     HealthCache.c
+
+  File Description:
+
+     This file contains the programs of the cache of the inputs of the
+     gateway health report.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#include "HealthCache.h"
+
+
+/* Reads the first line of the file. The error code of opening files is
+   stored when the file cannot be read or is empty. */
+static ErrorCode load_first_line(char *file_name, char *buf, size_t buf_len){
+
+    FILE *file = NULL;
+
+    memset(buf, 0, buf_len);
+
+    file = fopen(file_name, "r");
+    if(file == NULL){
+        snprintf(buf, buf_len, "%d", SELF_CHECK_ERROR_OPEN_FILE);
+        return E_OPEN_FILE;
+    }
+
+    if(fgets(buf, buf_len, file) != NULL)
+        trim_string_tail(buf);
+
+    if(strlen(buf) == 0)
+        snprintf(buf, buf_len, "%d", SELF_CHECK_ERROR_OPEN_FILE);
+
+    fclose(file);
+
+    return WORK_SUCCESSFULLY;
+}
+
+
+/* Reads one IP address per line and formats them as the number of addresses
+   followed by the comma-separated addresses. */
+static ErrorCode load_address_list(char *file_name, char *buf, size_t buf_len){
+
+    FILE *file = NULL;
+    char line[WIFI_MESSAGE_LENGTH];
+    char addresses[WIFI_MESSAGE_LENGTH];
+    size_t addresses_len = 0;
+    int count = 0;
+    int written;
+
+    memset(buf, 0, buf_len);
+    addresses[0] = '\0';
+
+    file = fopen(file_name, "r");
+    if(file == NULL){
+        snprintf(buf, buf_len, "%d,", count);
+        return E_OPEN_FILE;
+    }
+
+    while(fgets(line, sizeof(line), file) != NULL){
+
+        trim_string_tail(line);
+        if(strlen(line) == 0)
+            continue;
+
+        written = snprintf(addresses + addresses_len,
+                           sizeof(addresses) - addresses_len,
+                           (count == 0) ? "%s" : ",%s", line);
+        if(written < 0 || written >= sizeof(addresses) - addresses_len)
+            break;
+
+        addresses_len += written;
+        count++;
+    }
+
+    fclose(file);
+
+    snprintf(buf, buf_len, "%d,%s", count, addresses);
+
+    return WORK_SUCCESSFULLY;
+}
+
+
+ErrorCode init_health_state_cache(HealthStateCache *cache,
+                                  char *self_check_file_name,
+                                  char *version_file_name,
+                                  char *abnormal_lbeacon_file_name){
+
+    char *file_names[MAX_HEALTH_STATE_FILE];
+    char directory[CONFIG_BUFFER_SIZE];
+    int file;
+
+    file_names[HEALTH_STATE_SELF_CHECK] = self_check_file_name;
+    file_names[HEALTH_STATE_VERSION] = version_file_name;
+    file_names[HEALTH_STATE_ABNORMAL_LBEACON] = abnormal_lbeacon_file_name;
+
+    pthread_mutex_init( &cache->cache_lock, 0);
+
+    cache->is_watcher_started = false;
+
+    cache->inotify_fd = inotify_init();
+    if(cache->inotify_fd == -1){
+        zlog_error(category_health_report,
+                   "Cannot watch health report files, errno [%d]", errno);
+    }else if(pipe(cache->wake_pipe) == -1){
+        zlog_error(category_health_report,
+                   "Cannot watch health report files, errno [%d]", errno);
+        close(cache->inotify_fd);
+        cache->inotify_fd = -1;
+    }
+
+    for(file = 0; file < MAX_HEALTH_STATE_FILE; file++){
+
+        memset(cache->states[file].file_name, 0,
+               sizeof(cache->states[file].file_name));
+        strncpy(cache->states[file].file_name, file_names[file],
+                sizeof(cache->states[file].file_name) - 1);
+
+        cache->states[file].watch_descriptor = -1;
+        cache->states[file].is_set_in_memory = false;
+
+        if(cache->inotify_fd != -1){
+
+            /* The scripts may replace the files, so the directories are
+               watched instead of the files themselves. dirname() modifies
+               its argument. */
+            strcpy(directory, cache->states[file].file_name);
+
+            cache->states[file].watch_descriptor =
+                inotify_add_watch(cache->inotify_fd, dirname(directory),
+                                  IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE);
+
+            if(cache->states[file].watch_descriptor == -1){
+                zlog_error(category_health_report,
+                           "Cannot watch [%s], errno [%d]",
+                           cache->states[file].file_name, errno);
+            }
+        }
+
+        reload_health_state(cache, file);
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+
+ErrorCode reload_health_state(HealthStateCache *cache, HealthStateFile file){
+
+    char content[WIFI_MESSAGE_LENGTH];
+    ErrorCode return_value;
+
+    /* The file is read without holding the lock, so that health reports are
+       not blocked by the disk. */
+    if(file == HEALTH_STATE_ABNORMAL_LBEACON){
+        return_value = load_address_list(cache->states[file].file_name,
+                                         content, sizeof(content));
+    }else{
+        return_value = load_first_line(cache->states[file].file_name,
+                                       content, sizeof(content));
+    }
+
+    pthread_mutex_lock( &cache->cache_lock);
+    if(cache->states[file].is_set_in_memory == false)
+        strcpy(cache->states[file].content, content);
+    pthread_mutex_unlock( &cache->cache_lock);
+
+    return return_value;
+}
+
+
+void set_health_state(HealthStateCache *cache, 
+                      HealthStateFile file, 
+                      char *content){
+
+    pthread_mutex_lock( &cache->cache_lock);
+
+    cache->states[file].is_set_in_memory = true;
+
+    memset(cache->states[file].content, 0, 
+           sizeof(cache->states[file].content));
+    strncpy(cache->states[file].content, content, 
+            sizeof(cache->states[file].content) - 1);
+
+    pthread_mutex_unlock( &cache->cache_lock);
+}
+
+
+ErrorCode start_health_state_cache_thread(HealthStateCache *cache){
+
+    if(cache->inotify_fd == -1)
+        return WORK_SUCCESSFULLY;
+
+    /* The thread is not detached, so that it can be joined before the
+       inotify instance is closed */
+    if(pthread_create(&cache->watcher_thread, NULL,
+                      health_state_cache_routine, cache) != 0)
+        return E_START_THREAD;
+
+    cache->is_watcher_started = true;
+
+    return WORK_SUCCESSFULLY;
+}
+
+
+void *health_state_cache_routine(void *health_state_cache){
+
+    HealthStateCache *cache = (HealthStateCache *)health_state_cache;
+    char events[HEALTH_CACHE_EVENT_BUFFER_SIZE]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    struct inotify_event *event = NULL;
+    fd_set read_fds;
+    int max_fd;
+    char *base_name = NULL;
+    ssize_t len;
+    char *ptr;
+    int file;
+
+    apply_thread_role(THREAD_ROLE_BACKGROUND);
+
+    if(cache->inotify_fd == -1)
+        return (void *)NULL;
+
+    max_fd = (cache->inotify_fd > cache->wake_pipe[0]) ?
+             cache->inotify_fd : cache->wake_pipe[0];
+
+    while(true){
+
+        FD_ZERO(&read_fds);
+        FD_SET(cache->inotify_fd, &read_fds);
+        FD_SET(cache->wake_pipe[0], &read_fds);
+
+        /* No timeout is needed, release_health_state_cache writes to the
+           pipe when the routine is going to be ended */
+        if(select(max_fd + 1, &read_fds, NULL, NULL, NULL) <= 0)
+            continue;
+
+        if(FD_ISSET(cache->wake_pipe[0], &read_fds))
+            break;
+
+        len = read(cache->inotify_fd, events, sizeof(events));
+        if(len <= 0)
+            continue;
+
+        for(ptr = events; ptr < events + len;
+            ptr += sizeof(struct inotify_event) + event->len){
+
+            event = (struct inotify_event *)ptr;
+
+            if(event->len == 0)
+                continue;
+
+            for(file = 0; file < MAX_HEALTH_STATE_FILE; file++){
+
+                base_name = strrchr(cache->states[file].file_name, '/');
+                base_name = (base_name == NULL) ?
+                            cache->states[file].file_name : base_name + 1;
+
+                if(event->wd == cache->states[file].watch_descriptor &&
+                   strcmp(event->name, base_name) == 0){
+
+                    reload_health_state(cache, file);
+                }
+            }
+        }
+    }
+
+    return (void *)NULL;
+}
+
+
+int write_health_state(HealthStateCache *cache, char *buf, size_t buf_len){
+
+    int file;
+    int written;
+
+    /* Files which are not watched are reloaded as before */
+    for(file = 0; file < MAX_HEALTH_STATE_FILE; file++){
+        if(cache->states[file].watch_descriptor == -1 &&
+           cache->states[file].is_set_in_memory == false)
+            reload_health_state(cache, file);
+    }
+
+    pthread_mutex_lock( &cache->cache_lock);
+
+    written = snprintf(buf, buf_len, "%s;%s;%s;",
+                       cache->states[HEALTH_STATE_SELF_CHECK].content,
+                       cache->states[HEALTH_STATE_VERSION].content,
+                       cache->states[HEALTH_STATE_ABNORMAL_LBEACON].content);
+
+    pthread_mutex_unlock( &cache->cache_lock);
+
+    if(written < 0 || written >= buf_len)
+        return -1;
+
+    return written;
+}
+
+
+void release_health_state_cache(HealthStateCache *cache){
+
+    char wake = 0;
+
+    if(cache->inotify_fd == -1)
+        return;
+
+    /* The routine may be blocked in select() or read() on the inotify
+       instance, so it is woken up and joined before the instance is
+       closed */
+    if(cache->is_watcher_started == true){
+
+        /* The descriptors are left open if the routine cannot be woken */
+        if(write(cache->wake_pipe[1], &wake, sizeof(wake)) != sizeof(wake)){
+            zlog_error(category_health_report,
+                       "Cannot wake the health state cache thread, "
+                       "errno [%d]", errno);
+            return;
+        }
+
+        pthread_join(cache->watcher_thread, NULL);
+        cache->is_watcher_started = false;
+    }
+
+    close(cache->wake_pipe[0]);
+    close(cache->wake_pipe[1]);
+
+    close(cache->inotify_fd);
+    cache->inotify_fd = -1;
+}
@@ -0,0 +1,235 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     HealthCache.h
+
+  File Description:
+
+     This header file contains the declarations of the cache of the inputs of
+     the gateway health report. The self-check result, the version and the
+     list of abnormal LBeacons are written to files by shell scripts. The
+     cache keeps their latest contents in memory and reloads a file only when
+     inotify reports that it has been rewritten, so that answering a health
+     report request does not touch the disk.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#ifndef HEALTH_CACHE_H
+#define HEALTH_CACHE_H
+
+#include <sys/inotify.h>
+#include <sys/select.h>
+#include <libgen.h>
+#include <unistd.h>
+#include "BeDIS.h"
+
+/* The size in bytes of the buffer to read inotify events */
+#define HEALTH_CACHE_EVENT_BUFFER_SIZE 4096
+
+/* The files cached for the health report */
+typedef enum _HealthStateFile {
+
+    HEALTH_STATE_SELF_CHECK = 0,
+    HEALTH_STATE_VERSION = 1,
+    HEALTH_STATE_ABNORMAL_LBEACON = 2,
+    MAX_HEALTH_STATE_FILE = 3
+
+} HealthStateFile;
+
+/* The cached content of a file */
+typedef struct {
+
+    /* The path of the file */
+    char file_name[CONFIG_BUFFER_SIZE];
+
+    /* The watch descriptor of the directory of the file */
+    int watch_descriptor;
+
+    /* A flag indicating whether the content is set in memory by the gateway
+       itself, in which case the file is ignored */
+    bool is_set_in_memory;
+
+    /* The content formatted as a field of the health report */
+    char content[WIFI_MESSAGE_LENGTH];
+
+} CachedHealthState;
+
+typedef struct {
+
+    /* The lock for reading and reloading the cached contents */
+    pthread_mutex_t cache_lock;
+
+    /* The inotify instance, or -1 if the files are not watched */
+    int inotify_fd;
+
+    /* The pipe written by release_health_state_cache to wake the routine
+       blocked in select() */
+    int wake_pipe[2];
+
+    /* The thread executing health_state_cache_routine */
+    pthread_t watcher_thread;
+
+    bool is_watcher_started;
+
+    CachedHealthState states[MAX_HEALTH_STATE_FILE];
+
+} HealthStateCache;
+
+
+/*
+  init_health_state_cache:
+
+     This function loads the files into the cache and watches the
+     directories of the files. When the directories cannot be watched, the
+     files are reloaded for every health report as a fallback.
+
+  Parameters:
+
+     cache - A pointer to the cache.
+     self_check_file_name - The path of the self-check result file.
+     version_file_name - The path of the version file.
+     abnormal_lbeacon_file_name - The path of the abnormal LBeacon list file.
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error if the function
+                 fails or WORK SUCCESSFULLY otherwise
+ */
+ErrorCode init_health_state_cache(HealthStateCache *cache,
+                                  char *self_check_file_name,
+                                  char *version_file_name,
+                                  char *abnormal_lbeacon_file_name);
+
+/*
+  reload_health_state:
+
+     This function reads a file and replaces its cached content.
+
+  Parameters:
+
+     cache - A pointer to the cache.
+     file - The file to be reloaded.
+
+  Return value:
+
+     ErrorCode - E_OPEN_FILE if the file cannot be opened, in which case the
+                 error code of the file is cached, or WORK SUCCESSFULLY
+                 otherwise
+ */
+ErrorCode reload_health_state(HealthStateCache *cache, HealthStateFile file);
+
+/*
+  set_health_state:
+
+     This function replaces the cached content of a file with the content
+     generated by the gateway itself. From then on, the file is ignored.
+
+  Parameters:
+
+     cache - A pointer to the cache.
+     file - The file whose content is replaced.
+     content - The content formatted as a field of the health report.
+
+  Return value:
+
+     None
+ */
+void set_health_state(HealthStateCache *cache, 
+                      HealthStateFile file, 
+                      char *content);
+
+/*
+  start_health_state_cache_thread:
+
+     This function starts the thread executing health_state_cache_routine.
+     The thread is joined by release_health_state_cache.
+
+  Parameters:
+
+     cache - A pointer to the cache.
+
+  Return value:
+
+     ErrorCode - E_START_THREAD if the thread cannot be started or
+                 WORK SUCCESSFULLY otherwise
+ */
+ErrorCode start_health_state_cache_thread(HealthStateCache *cache);
+
+/*
+  health_state_cache_routine:
+
+     This function is executed by the thread which waits for inotify events
+     and reloads the files rewritten, until it is woken up by
+     release_health_state_cache.
+
+  Parameters:
+
+     health_state_cache - A pointer to the cache.
+
+  Return value:
+
+     None
+ */
+void *health_state_cache_routine(void *health_state_cache);
+
+/*
+  write_health_state:
+
+     This function writes the cached self-check result, version and abnormal
+     LBeacon list as the fields of the health report in one pass.
+
+  Parameters:
+
+     cache - A pointer to the cache.
+     buf - The output buffer.
+     buf_len - The size in bytes of the output buffer.
+
+  Return value:
+
+     int - The number of bytes written, or -1 if the buffer is not big enough
+ */
+int write_health_state(HealthStateCache *cache, char *buf, size_t buf_len);
+
+/*
+  release_health_state_cache:
+
+     This function stops the thread watching the files, waits for it to
+     exit and then stops watching the files.
+
+  Parameters:
+
+     cache - A pointer to the cache.
+
+  Return value:
+
+     None
+ */
+void release_health_state_cache(HealthStateCache *cache);
+
+#endif
@@ -0,0 +1,504 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     JoinReport.c
+
+  File Description:
+
+     This file contains the programs of the join report coalescer.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#include "JoinReport.h"
+
+
+/* Sends one request_to_join carrying the LBeacons already formatted */
+static ErrorCode send_one_join_report(JoinReportCoalescer *coalescer,
+                                      char *header,
+                                      int number_lbeacons,
+                                      char *lbeacons_buf,
+                                      char *trailer){
+
+    char message_buf[WIFI_MESSAGE_LENGTH];
+    int message_size;
+
+    message_size = snprintf(message_buf, sizeof(message_buf), 
+                            "%s%d;%s;%s%s", header, number_lbeacons, 
+                            coalescer->gateway_id, lbeacons_buf, trailer);
+
+    if(message_size < 0 || message_size >= sizeof(message_buf)){
+        zlog_error(category_debug, "message_buf is not big enough to " \
+                                   "include lbeacons_buf");
+        return E_BUFFER_SIZE;
+    }
+
+    /* Reports of the whole registry may be sent by other threads */
+    metric_counter_add( &coalescer->sent_message_count, 1);
+    metric_counter_add( &coalescer->reported_lbeacon_count, number_lbeacons);
+
+    return coalescer->send_function(message_buf, message_size);
+}
+
+
+/* Reports LBeacons in as many messages as needed. The trailer is appended
+   to the last message only. */
+static ErrorCode send_entries_in_join_reports(JoinReportCoalescer *coalescer,
+                                              JoinReportEntry *entries,
+                                              int number_entries,
+                                              char *trailer){
+
+    char header[WIFI_MESSAGE_LENGTH];
+    char lbeacons_buf[WIFI_MESSAGE_LENGTH];
+    size_t lbeacons_len = 0;
+    int header_len;
+    int summary_len;
+    int number_lbeacons = 0;
+    int written;
+    int i;
+    ErrorCode return_value = WORK_SUCCESSFULLY;
+
+    header_len = snprintf(header, sizeof(header), "%d;%d;%s;", from_gateway,
+                          request_to_join, BOT_SERVER_API_VERSION_LATEST);
+
+    /* Reserve the room of the summary for the largest count, and of the 
+       trailer in every message */
+    summary_len = snprintf(NULL, 0, "%d;%s;", MAX_NUMBER_NODES,
+                           coalescer->gateway_id) + strlen(trailer);
+
+    lbeacons_buf[0] = '\0';
+
+    for(i = 0; i < number_entries; i++){
+
+        written = snprintf(lbeacons_buf + lbeacons_len,
+                           sizeof(lbeacons_buf) - lbeacons_len,
+                           "%s;%d;%s;%s;",
+                           entries[i].address_map.uuid,
+                           entries[i].last_reported_timestamp,
+                           entries[i].address_map.net_address,
+                           entries[i].address_map.API_version);
+
+        /* Start a new message when this LBeacon does not fit */
+        if(written < 0 || header_len + summary_len + lbeacons_len +
+           written >= WIFI_MESSAGE_LENGTH){
+
+            lbeacons_buf[lbeacons_len] = '\0';
+
+            if(number_lbeacons == 0){
+                zlog_error(category_debug,
+                           "lbeacons_buf is not big enough to " \
+                           "include one_lbeacon_buf");
+                return E_BUFFER_SIZE;
+            }
+
+            if(send_one_join_report(coalescer, header, number_lbeacons,
+                                    lbeacons_buf, "") != WORK_SUCCESSFULLY)
+                return_value = E_BUFFER_SIZE;
+
+            lbeacons_len = 0;
+            number_lbeacons = 0;
+            lbeacons_buf[0] = '\0';
+            i--;
+            continue;
+        }
+
+        lbeacons_len += written;
+        number_lbeacons++;
+    }
+
+    /* A report without LBeacons is still sent when there are no LBeacons to
+       report at all, as the gateway itself joins by it */
+    if(number_lbeacons > 0 || number_entries == 0){
+
+        if(send_one_join_report(coalescer, header, number_lbeacons,
+                                lbeacons_buf, trailer) != WORK_SUCCESSFULLY)
+            return_value = E_BUFFER_SIZE;
+    }
+
+    return return_value;
+}
+
+
+/* Copies the LBeacons changed since the generation. Returns false if the 
+   journal no longer covers the changes. */
+static bool collect_registry_changes(JoinReportCoalescer *coalescer,
+                                     uint64_t since_generation,
+                                     int *number_added,
+                                     int *number_removed,
+                                     uint64_t *generation){
+
+    AddressMapArray *address_map = coalescer->address_map;
+    AddressMapChange *change = NULL;
+    AddressMapChange *later_change = NULL;
+    uint64_t g;
+    uint64_t later;
+    int index;
+
+    *number_added = 0;
+    *number_removed = 0;
+    *generation = address_map->generation;
+
+    if(since_generation == 0 || since_generation > *generation ||
+       *generation - since_generation >= ADDRESS_MAP_JOURNAL_LENGTH)
+        return false;
+
+    for(g = since_generation + 1; g <= *generation; g++){
+
+        change = &address_map->journal[g % ADDRESS_MAP_JOURNAL_LENGTH];
+        if(change->generation != g)
+            return false;
+
+        /* Only the last change of each LBeacon counts */
+        for(later = g + 1; later <= *generation; later++){
+            later_change = 
+                &address_map->journal[later % ADDRESS_MAP_JOURNAL_LENGTH];
+            if(strncmp(later_change->uuid, change->uuid, 
+                       LENGTH_OF_UUID) == 0)
+                break;
+        }
+        if(later <= *generation)
+            continue;
+
+        index = is_in_Address_Map(address_map, ADDRESS_MAP_TYPE_LBEACON,
+                                  change->uuid);
+
+        if(change->is_removed == false && index >= 0){
+
+            coalescer->sync_entries[*number_added].address_map =
+                address_map->address_map_list[index];
+            coalescer->sync_entries[*number_added].last_reported_timestamp =
+                address_map->last_reported_timestamp[index];
+            (*number_added)++;
+
+        }else if(change->is_removed == true && index < 0){
+
+            memcpy(coalescer->sync_removed_uuids[*number_removed], 
+                   change->uuid, LENGTH_OF_UUID);
+            (*number_removed)++;
+        }
+    }
+
+    return true;
+}
+
+
+/* Sends the changes since the acknowledged generation in one message. 
+   Returns E_BUFFER_SIZE if they do not fit. */
+static ErrorCode send_differential_sync(JoinReportCoalescer *coalescer,
+                                        int number_added,
+                                        int number_removed,
+                                        uint64_t generation){
+
+    char trailer[WIFI_MESSAGE_LENGTH];
+    size_t trailer_len;
+    size_t message_len;
+    int written;
+    int i;
+
+    trailer_len = snprintf(trailer, sizeof(trailer), "%d;%llu;%d;", 
+                           REGISTRY_SYNC_DIFFERENTIAL, 
+                           (unsigned long long)generation, number_removed);
+
+    for(i = 0; i < number_removed; i++){
+
+        written = snprintf(trailer + trailer_len, 
+                           sizeof(trailer) - trailer_len, "%s;",
+                           coalescer->sync_removed_uuids[i]);
+        if(written < 0 || written >= sizeof(trailer) - trailer_len)
+            return E_BUFFER_SIZE;
+
+        trailer_len += written;
+    }
+
+    /* The removals only make sense with all additions in the same 
+       message */
+    message_len = snprintf(NULL, 0, "%d;%d;%s;%d;%s;", from_gateway,
+                           request_to_join, BOT_SERVER_API_VERSION_LATEST,
+                           number_added, coalescer->gateway_id) + trailer_len;
+
+    for(i = 0; i < number_added; i++){
+        message_len += snprintf(NULL, 0, "%s;%d;%s;%s;",
+                                coalescer->sync_entries[i].address_map.uuid,
+                                coalescer->sync_entries[i]
+                                    .last_reported_timestamp,
+                                coalescer->sync_entries[i]
+                                    .address_map.net_address,
+                                coalescer->sync_entries[i]
+                                    .address_map.API_version);
+    }
+
+    if(message_len >= WIFI_MESSAGE_LENGTH)
+        return E_BUFFER_SIZE;
+
+    return send_entries_in_join_reports(coalescer, coalescer->sync_entries,
+                                        number_added, trailer);
+}
+
+
+void init_join_report_coalescer(JoinReportCoalescer *coalescer,
+                                AddressMapArray *address_map,
+                                int window_in_ms,
+                                bool is_differential_sync,
+                                char *area_id,
+                                char *serial_id,
+                                JoinReportSendFunction send_function){
+
+    pthread_mutex_init( &coalescer->coalescer_lock, 0);
+    pthread_cond_init( &coalescer->pending_cond, 0);
+
+    coalescer->address_map = address_map;
+    coalescer->window_in_ms = window_in_ms;
+    coalescer->send_function = send_function;
+    coalescer->number_pending = 0;
+    coalescer->reported_lbeacon_count = 0;
+    coalescer->sent_message_count = 0;
+    coalescer->is_differential_sync = is_differential_sync;
+    coalescer->acknowledged_generation = 0;
+    coalescer->full_sync_count = 0;
+    coalescer->differential_sync_count = 0;
+
+    snprintf(coalescer->gateway_id, sizeof(coalescer->gateway_id), "%s%s",
+             area_id, serial_id);
+}
+
+
+void queue_join_report(JoinReportCoalescer *coalescer, char *uuid){
+
+    int i;
+
+    pthread_mutex_lock( &coalescer->coalescer_lock);
+
+    /* Windows are short, so the pending list is short too */
+    for(i = 0; i < coalescer->number_pending; i++){
+        if(strncmp(coalescer->pending_uuids[i], uuid, LENGTH_OF_UUID) == 0){
+            pthread_mutex_unlock( &coalescer->coalescer_lock);
+            return;
+        }
+    }
+
+    if(coalescer->number_pending < MAX_NUMBER_NODES){
+
+        memset(coalescer->pending_uuids[coalescer->number_pending], 0,
+               LENGTH_OF_UUID);
+        strncpy(coalescer->pending_uuids[coalescer->number_pending], uuid,
+                LENGTH_OF_UUID - 1);
+        coalescer->number_pending++;
+
+        if(coalescer->number_pending == 1)
+            pthread_cond_signal( &coalescer->pending_cond);
+    }
+
+    pthread_mutex_unlock( &coalescer->coalescer_lock);
+}
+
+
+ErrorCode send_join_reports(JoinReportCoalescer *coalescer,
+                            JoinReportEntry *entries,
+                            int number_entries){
+
+    return send_entries_in_join_reports(coalescer, entries, number_entries,
+                                        "");
+}
+
+
+ErrorCode send_registry_sync(JoinReportCoalescer *coalescer){
+
+    AddressMapArray *address_map = coalescer->address_map;
+    char trailer[WIFI_MESSAGE_LENGTH];
+    uint64_t acknowledged_generation;
+    uint64_t generation;
+    int number_added;
+    int number_removed;
+    int number_entries = 0;
+    bool is_covered = false;
+    int i;
+
+    if(coalescer->is_differential_sync == true){
+
+        acknowledged_generation = __atomic_load_n(
+            &coalescer->acknowledged_generation, __ATOMIC_ACQUIRE);
+
+        pthread_mutex_lock( &address_map->list_lock);
+        is_covered = collect_registry_changes(coalescer, 
+                                              acknowledged_generation,
+                                              &number_added, 
+                                              &number_removed,
+                                              &generation);
+        pthread_mutex_unlock( &address_map->list_lock);
+
+        if(is_covered == true &&
+           send_differential_sync(coalescer, number_added, number_removed, 
+                                  generation) == WORK_SUCCESSFULLY){
+
+            metric_counter_add( &coalescer->differential_sync_count, 1);
+            return WORK_SUCCESSFULLY;
+        }
+    }
+
+    /* Fall back to the full registry */
+    pthread_mutex_lock( &address_map->list_lock);
+
+    for(i = 0; i < MAX_NUMBER_NODES; i++){
+        if(address_map->in_use[i] == true){
+
+            coalescer->sync_entries[number_entries].address_map =
+                address_map->address_map_list[i];
+            coalescer->sync_entries[number_entries].last_reported_timestamp =
+                address_map->last_reported_timestamp[i];
+            number_entries++;
+        }
+    }
+
+    generation = address_map->generation;
+
+    pthread_mutex_unlock( &address_map->list_lock);
+
+    trailer[0] = '\0';
+    if(coalescer->is_differential_sync == true){
+        snprintf(trailer, sizeof(trailer), "%d;%llu;", REGISTRY_SYNC_FULL,
+                 (unsigned long long)generation);
+    }
+
+    metric_counter_add( &coalescer->full_sync_count, 1);
+
+    return send_entries_in_join_reports(coalescer, coalescer->sync_entries,
+                                        number_entries, trailer);
+}
+
+
+void acknowledge_registry_sync(JoinReportCoalescer *coalescer, char *content){
+
+    unsigned long long generation;
+
+    if(coalescer->is_differential_sync == false)
+        return;
+
+    if(content == NULL || sscanf(content, "%llu", &generation) != 1)
+        return;
+
+    __atomic_store_n(&coalescer->acknowledged_generation, 
+                     (uint64_t)generation, __ATOMIC_RELEASE);
+}
+
+
+ErrorCode flush_join_reports(JoinReportCoalescer *coalescer){
+
+    AddressMapArray *address_map = coalescer->address_map;
+    int number_flushing;
+    int number_entries = 0;
+    int index;
+    int i;
+
+    pthread_mutex_lock( &coalescer->coalescer_lock);
+
+    number_flushing = coalescer->number_pending;
+    memcpy(coalescer->flushing_uuids, coalescer->pending_uuids,
+           number_flushing * LENGTH_OF_UUID);
+    coalescer->number_pending = 0;
+
+    pthread_mutex_unlock( &coalescer->coalescer_lock);
+
+    if(number_flushing == 0)
+        return WORK_SUCCESSFULLY;
+
+    pthread_mutex_lock( &address_map->list_lock);
+
+    for(i = 0; i < number_flushing; i++){
+
+        index = is_in_Address_Map(address_map, ADDRESS_MAP_TYPE_LBEACON,
+                                  coalescer->flushing_uuids[i]);
+
+        /* The LBeacon may have been released within the window */
+        if(index < 0)
+            continue;
+
+        coalescer->flushing_entries[number_entries].address_map =
+            address_map->address_map_list[index];
+        coalescer->flushing_entries[number_entries].last_reported_timestamp =
+            address_map->last_reported_timestamp[index];
+        number_entries++;
+    }
+
+    pthread_mutex_unlock( &address_map->list_lock);
+
+    if(number_entries == 0)
+        return WORK_SUCCESSFULLY;
+
+    return send_join_reports(coalescer, coalescer->flushing_entries,
+                             number_entries);
+}
+
+
+void *join_report_routine(void *join_report_coalescer){
+
+    JoinReportCoalescer *coalescer =
+        (JoinReportCoalescer *)join_report_coalescer;
+    struct timespec deadline;
+
+    apply_thread_role(THREAD_ROLE_BACKGROUND);
+
+    while(ready_to_work == true){
+
+        pthread_mutex_lock( &coalescer->coalescer_lock);
+
+        if(coalescer->number_pending == 0){
+
+            /* Wake up periodically to notice ready_to_work */
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += NORMAL_WAITING_TIME_IN_MS / 1000;
+
+            pthread_cond_timedwait( &coalescer->pending_cond,
+                                    &coalescer->coalescer_lock, &deadline);
+        }
+
+        if(coalescer->number_pending == 0){
+            pthread_mutex_unlock( &coalescer->coalescer_lock);
+            continue;
+        }
+
+        pthread_mutex_unlock( &coalescer->coalescer_lock);
+
+        /* Collect the LBeacons joining within the window */
+        sleep_t(coalescer->window_in_ms);
+
+        flush_join_reports(coalescer);
+    }
+
+    /* Report the LBeacons left in the last window */
+    flush_join_reports(coalescer);
+
+    return (void *)NULL;
+}
+
+
+void release_join_report_coalescer(JoinReportCoalescer *coalescer){
+
+    pthread_mutex_lock( &coalescer->coalescer_lock);
+    pthread_cond_broadcast( &coalescer->pending_cond);
+    pthread_mutex_unlock( &coalescer->coalescer_lock);
+}
@@ -0,0 +1,291 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     JoinReport.h
+
+  File Description:
+
+     This header file contains the declarations of the join report
+     coalescer. Instead of sending one request_to_join to the server for
+     every LBeacon which joins, the LBeacons joined within a short window are
+     reported together in as few request_to_join messages as fit in
+     WIFI_MESSAGE_LENGTH.
+
+     It also synchronizes the whole registry of LBeacons with the server.
+     With differential sync enabled, the last message of a full sync carries
+     the generation of the AddressMap, and the server acknowledges the
+     generation it has in the first field of join_response. Later syncs send
+     only the LBeacons added and removed since the acknowledged generation,
+     followed by
+
+        1;generation;number_removed;uuid;...;
+
+     while the last message of a full sync ends with
+
+        0;generation;
+
+     A full sync is sent when the journal of the AddressMap no longer covers
+     the changes or the changes do not fit in one message.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#ifndef JOIN_REPORT_H
+#define JOIN_REPORT_H
+
+#include "BeDIS.h"
+
+/* Number of characters of the identifier of the gateway in join reports */
+#define LENGTH_OF_GATEWAY_ID 64
+
+/* The kinds of registry sync at the end of request_to_join */
+typedef enum _RegistrySyncType {
+
+    REGISTRY_SYNC_FULL = 0,
+    REGISTRY_SYNC_DIFFERENTIAL = 1
+
+} RegistrySyncType;
+
+/* The function to send a message to the server */
+typedef ErrorCode (*JoinReportSendFunction)(char *message, int message_size);
+
+/* A LBeacon reported in request_to_join */
+typedef struct {
+
+    AddressMap address_map;
+
+    int last_reported_timestamp;
+
+} JoinReportEntry;
+
+typedef struct {
+
+    /* The lock for the pending LBeacons */
+    pthread_mutex_t coalescer_lock;
+
+    /* The condition signaled when the first LBeacon of a window is queued */
+    pthread_cond_t pending_cond;
+
+    /* The time in milliseconds LBeacons are collected before being reported */
+    int window_in_ms;
+
+    AddressMapArray *address_map;
+
+    /* The area id and serial id of the gateway */
+    char gateway_id[LENGTH_OF_GATEWAY_ID];
+
+    JoinReportSendFunction send_function;
+
+    /* The uuids of the LBeacons joined in the current window */
+    int number_pending;
+    char pending_uuids[MAX_NUMBER_NODES][LENGTH_OF_UUID];
+
+    /* The buffers used by flush_join_reports, kept here instead of on the
+       stack because of their size */
+    char flushing_uuids[MAX_NUMBER_NODES][LENGTH_OF_UUID];
+    JoinReportEntry flushing_entries[MAX_NUMBER_NODES];
+
+    /* The number of LBeacons reported and the number of messages sent */
+    uint64_t reported_lbeacon_count;
+    uint64_t sent_message_count;
+
+    /* A flag indicating whether registry syncs send only the changes since
+       the generation acknowledged by the server */
+    bool is_differential_sync;
+
+    /* The generation of the AddressMap acknowledged by the server, or 0 if
+       the server has not acknowledged any */
+    uint64_t acknowledged_generation;
+
+    /* The buffers used by registry syncs */
+    JoinReportEntry sync_entries[MAX_NUMBER_NODES];
+    char sync_removed_uuids[ADDRESS_MAP_JOURNAL_LENGTH][LENGTH_OF_UUID];
+
+    /* The number of full and differential registry syncs sent */
+    uint64_t full_sync_count;
+    uint64_t differential_sync_count;
+
+} JoinReportCoalescer;
+
+
+/*
+  init_join_report_coalescer:
+
+     This function initializes the coalescer without pending LBeacons.
+
+  Parameters:
+
+     coalescer - A pointer to the coalescer.
+     address_map - A pointer to the AddressMap of LBeacons.
+     window_in_ms - The time in milliseconds LBeacons are collected before
+                    being reported.
+     is_differential_sync - Whether registry syncs send only the changes
+                            acknowledged by the server.
+     area_id - The area id of the gateway.
+     serial_id - The serial id of the gateway.
+     send_function - The function to send a message to the server.
+
+  Return value:
+
+     None
+ */
+void init_join_report_coalescer(JoinReportCoalescer *coalescer,
+                                AddressMapArray *address_map,
+                                int window_in_ms,
+                                bool is_differential_sync,
+                                char *area_id,
+                                char *serial_id,
+                                JoinReportSendFunction send_function);
+
+/*
+  queue_join_report:
+
+     This function adds a LBeacon to the current window. A LBeacon already
+     in the window is not added again.
+
+  Parameters:
+
+     coalescer - A pointer to the coalescer.
+     uuid - The uuid of the LBeacon joined.
+
+  Return value:
+
+     None
+ */
+void queue_join_report(JoinReportCoalescer *coalescer, char *uuid);
+
+/*
+  send_join_reports:
+
+     This function reports LBeacons in request_to_join messages, putting as
+     many LBeacons in each message as fit in WIFI_MESSAGE_LENGTH. Every 
+     message is a complete request_to_join with its own count of LBeacons,
+     so the server handles each one independently. The LBeacons are 
+     formatted with a cursor into the message in linear time.
+
+  Parameters:
+
+     coalescer - A pointer to the coalescer.
+     entries - The LBeacons to be reported.
+     number_entries - The number of LBeacons.
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error if the function
+                 fails or WORK SUCCESSFULLY otherwise
+ */
+ErrorCode send_join_reports(JoinReportCoalescer *coalescer,
+                            JoinReportEntry *entries,
+                            int number_entries);
+
+/*
+  send_registry_sync:
+
+     This function reports the registry of LBeacons to the server, either as
+     the changes since the generation acknowledged by the server or in full.
+     It is called by one thread at a time.
+
+  Parameters:
+
+     coalescer - A pointer to the coalescer.
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error if the function
+                 fails or WORK SUCCESSFULLY otherwise
+ */
+ErrorCode send_registry_sync(JoinReportCoalescer *coalescer);
+
+/*
+  acknowledge_registry_sync:
+
+     This function records the generation of the AddressMap the server 
+     acknowledges in join_response.
+
+  Parameters:
+
+     coalescer - A pointer to the coalescer.
+     content - The content of join_response after the API version.
+
+  Return value:
+
+     None
+ */
+void acknowledge_registry_sync(JoinReportCoalescer *coalescer, char *content);
+
+/*
+  flush_join_reports:
+
+     This function reports the LBeacons in the current window and starts a
+     new window.
+
+  Parameters:
+
+     coalescer - A pointer to the coalescer.
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error if the function
+                 fails or WORK SUCCESSFULLY otherwise
+ */
+ErrorCode flush_join_reports(JoinReportCoalescer *coalescer);
+
+/*
+  join_report_routine:
+
+     This function is executed by the thread which waits for the first
+     LBeacon of a window, waits for the window to end and reports the
+     LBeacons, until the gateway stops.
+
+  Parameters:
+
+     join_report_coalescer - A pointer to the coalescer.
+
+  Return value:
+
+     None
+ */
+void *join_report_routine(void *join_report_coalescer);
+
+/*
+  release_join_report_coalescer:
+
+     This function wakes up the thread of the coalescer so that it notices
+     the gateway stopping.
+
+  Parameters:
+
+     coalescer - A pointer to the coalescer.
+
+  Return value:
+
+     None
+ */
+void release_join_report_coalescer(JoinReportCoalescer *coalescer);
+
+#endif
@@ -0,0 +1,331 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Prober.c
+
+  File Description:
+
+     This file contains the programs of the LBeacon liveness prober.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#include "Prober.h"
+
+
+static uint16_t icmp_checksum(void *data, int len){
+
+    uint16_t *word = (uint16_t *)data;
+    uint32_t sum = 0;
+
+    for(; len > 1; len -= 2)
+        sum += *word++;
+
+    if(len == 1)
+        sum += *(uint8_t *)word;
+
+    sum = (sum >> 16) + (sum & 0xFFFF);
+    sum += (sum >> 16);
+
+    return (uint16_t)~sum;
+}
+
+
+/* Copies the addresses of the LBeacons reported within the tolerance
+   duration from the AddressMap */
+static void collect_targets(LBeaconProber *prober){
+
+    AddressMapArray *address_map = prober->address_map;
+    uint64_t current_time;
+    uint64_t tolerance_duration_in_ns =
+        (uint64_t)prober->tolerance_duration_in_sec * NS_EACH_SECOND;
+    struct sockaddr_in *target = NULL;
+    int i;
+
+    prober->number_targets = 0;
+
+    pthread_mutex_lock( &address_map->list_lock);
+
+    /* Read under the lock, so that no entry is reported later than
+       current_time and the age cannot wrap around */
+    current_time = get_clock_time_in_ns();
+
+    for(i = 0; i < MAX_NUMBER_NODES; i++){
+
+        if(address_map->in_use[i] == false ||
+           current_time - address_map->last_reported_time_in_ns[i] >=
+           tolerance_duration_in_ns)
+            continue;
+
+        target = &prober->targets[prober->number_targets];
+        memset(target, 0, sizeof(struct sockaddr_in));
+        target->sin_family = AF_INET;
+
+        if(inet_aton(address_map->address_map_list[i].net_address,
+                     &target->sin_addr) == 0)
+            continue;
+
+        strncpy(prober->target_names[prober->number_targets],
+                address_map->address_map_list[i].net_address,
+                NETWORK_ADDR_LENGTH);
+        prober->is_alive[prober->number_targets] = false;
+        prober->number_targets++;
+    }
+
+    pthread_mutex_unlock( &address_map->list_lock);
+}
+
+
+/* Sends an echo request to the target. The sequence number is the index of
+   the target, so that replies are matched without searching. */
+static void send_echo_request(LBeaconProber *prober, int index){
+
+    char packet[sizeof(struct icmphdr) + LBEACON_PROBE_PAYLOAD_SIZE];
+    struct icmphdr *header = (struct icmphdr *)packet;
+
+    memset(packet, 0, sizeof(packet));
+
+    header->type = ICMP_ECHO;
+    header->code = 0;
+    header->un.echo.id = htons(prober->identifier);
+    header->un.echo.sequence = htons((uint16_t)index);
+    header->checksum = icmp_checksum(packet, sizeof(packet));
+
+    sendto(prober->socket, packet, sizeof(packet), 0,
+           (struct sockaddr *)&prober->targets[index],
+           sizeof(struct sockaddr_in));
+}
+
+
+/* Receives echo replies until the time in milliseconds elapses */
+static void receive_echo_replies(LBeaconProber *prober, int wait_time_in_ms){
+
+    char packet[LBEACON_PROBE_BUFFER_SIZE];
+    struct sockaddr_in source;
+    socklen_t source_len;
+    struct icmphdr *header = NULL;
+    struct pollfd poll_fd;
+    uint64_t deadline;
+    uint64_t now;
+    ssize_t len;
+    int offset;
+    int index;
+
+    deadline = get_clock_time_in_ns() + (uint64_t)wait_time_in_ms * NS_EACH_MS;
+
+    poll_fd.fd = prober->socket;
+    poll_fd.events = POLLIN;
+
+    while((now = get_clock_time_in_ns()) < deadline){
+
+        if(poll(&poll_fd, 1, (int)((deadline - now) / NS_EACH_MS) + 1) <= 0)
+            continue;
+
+        while(true){
+
+            source_len = sizeof(source);
+            len = recvfrom(prober->socket, packet, sizeof(packet),
+                           MSG_DONTWAIT, (struct sockaddr *)&source,
+                           &source_len);
+            if(len <= 0)
+                break;
+
+            /* Packets received by raw sockets start with the IP header */
+            offset = 0;
+            if(prober->is_raw_socket)
+                offset = ((struct iphdr *)packet)->ihl * 4;
+
+            if(len < offset + sizeof(struct icmphdr))
+                continue;
+
+            header = (struct icmphdr *)(packet + offset);
+
+            if(header->type != ICMP_ECHOREPLY)
+                continue;
+
+            /* Datagram sockets only receive their own replies, with the
+               identifier replaced by the kernel */
+            if(prober->is_raw_socket &&
+               ntohs(header->un.echo.id) != prober->identifier)
+                continue;
+
+            index = ntohs(header->un.echo.sequence);
+
+            if(index < prober->number_targets &&
+               source.sin_addr.s_addr ==
+               prober->targets[index].sin_addr.s_addr){
+
+                prober->is_alive[index] = true;
+            }
+        }
+    }
+}
+
+
+ErrorCode init_lbeacon_prober(LBeaconProber *prober,
+                              AddressMapArray *address_map,
+                              HealthStateCache *health_state_cache,
+                              int interval_in_sec,
+                              int rate_per_sec,
+                              int tolerance_duration_in_sec){
+
+    prober->address_map = address_map;
+    prober->health_state_cache = health_state_cache;
+    prober->interval_in_sec = interval_in_sec;
+    prober->rate_per_sec = rate_per_sec;
+    prober->tolerance_duration_in_sec = tolerance_duration_in_sec;
+    prober->identifier = (uint16_t)(getpid() & 0xFFFF);
+    prober->number_targets = 0;
+    prober->number_abnormal = 0;
+
+    prober->is_raw_socket = false;
+    prober->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_ICMP);
+
+    if(prober->socket == -1){
+
+        prober->is_raw_socket = true;
+        prober->socket = socket(AF_INET, SOCK_RAW, IPPROTO_ICMP);
+    }
+
+    if(prober->socket == -1){
+        zlog_error(category_health_report,
+                   "Cannot open ICMP socket, errno [%d]", errno);
+        return E_OPEN_SOCKET;
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+
+ErrorCode probe_lbeacons(LBeaconProber *prober){
+
+    char abnormal_lbeacon_buf[WIFI_MESSAGE_LENGTH];
+    char addresses[WIFI_MESSAGE_LENGTH];
+    size_t addresses_len = 0;
+    int batch_size;
+    int number_sent;
+    int attempt;
+    int written;
+    int i;
+
+    collect_targets(prober);
+
+    batch_size = prober->rate_per_sec * LBEACON_PROBE_BATCH_INTERVAL_IN_MS /
+                 1000;
+    if(batch_size < 1)
+        batch_size = 1;
+
+    for(attempt = 0; attempt < LBEACON_PROBE_ATTEMPTS; attempt++){
+
+        number_sent = 0;
+
+        for(i = 0; i < prober->number_targets; i++){
+
+            if(prober->is_alive[i] == true)
+                continue;
+
+            send_echo_request(prober, i);
+            number_sent++;
+
+            /* Collect the replies while waiting for the next batch */
+            if(number_sent % batch_size == 0)
+                receive_echo_replies(prober,
+                                     LBEACON_PROBE_BATCH_INTERVAL_IN_MS);
+        }
+
+        if(number_sent == 0)
+            break;
+
+        receive_echo_replies(prober, LBEACON_PROBE_TIMEOUT_IN_MS);
+    }
+
+    prober->number_abnormal = 0;
+    addresses[0] = '\0';
+
+    for(i = 0; i < prober->number_targets; i++){
+
+        if(prober->is_alive[i] == true)
+            continue;
+
+        written = snprintf(addresses + addresses_len,
+                           sizeof(addresses) - addresses_len,
+                           (prober->number_abnormal == 0) ? "%s" : ",%s",
+                           prober->target_names[i]);
+        if(written < 0 || written >= sizeof(addresses) - addresses_len)
+            break;
+
+        addresses_len += written;
+        prober->number_abnormal++;
+    }
+
+    snprintf(abnormal_lbeacon_buf, sizeof(abnormal_lbeacon_buf), "%d,%s",
+             prober->number_abnormal, addresses);
+
+    set_health_state(prober->health_state_cache,
+                     HEALTH_STATE_ABNORMAL_LBEACON,
+                     abnormal_lbeacon_buf);
+
+    return WORK_SUCCESSFULLY;
+}
+
+
+void *lbeacon_prober_routine(void *lbeacon_prober){
+
+    LBeaconProber *prober = (LBeaconProber *)lbeacon_prober;
+    int last_probe_time = 0;
+    int uptime;
+
+    apply_thread_role(THREAD_ROLE_BACKGROUND);
+
+    while(ready_to_work == true){
+
+        uptime = get_clock_time();
+
+        if(last_probe_time == 0 ||
+           uptime - last_probe_time >= prober->interval_in_sec){
+
+            probe_lbeacons(prober);
+
+            last_probe_time = uptime;
+
+        }else{
+            sleep_t(NORMAL_WAITING_TIME_IN_MS);
+        }
+    }
+
+    return (void *)NULL;
+}
+
+
+void release_lbeacon_prober(LBeaconProber *prober){
+
+    if(prober->socket != -1){
+        close(prober->socket);
+        prober->socket = -1;
+    }
+}
@@ -0,0 +1,186 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Prober.h
+
+  File Description:
+
+     This header file contains the declarations of the LBeacon liveness
+     prober. In every probing round, the prober sends ICMP echo requests to
+     all active LBeacons in the AddressMap at a bounded rate from a single
+     socket, collects the echo replies concurrently, and keeps the LBeacons
+     which did not reply as the abnormal LBeacon list of the health report.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#ifndef PROBER_H
+#define PROBER_H
+
+#include <netinet/ip.h>
+#include <netinet/ip_icmp.h>
+#include <poll.h>
+#include <unistd.h>
+#include "BeDIS.h"
+#include "HealthCache.h"
+
+/* The time in milliseconds to wait for the echo replies after the last echo
+   request of an attempt is sent */
+#define LBEACON_PROBE_TIMEOUT_IN_MS 1000
+
+/* The number of attempts to probe a LBeacon in each round before the
+   LBeacon is considered abnormal */
+#define LBEACON_PROBE_ATTEMPTS 2
+
+/* The time in milliseconds between two batches of echo requests. The
+   number of echo requests in a batch follows from the probing rate. */
+#define LBEACON_PROBE_BATCH_INTERVAL_IN_MS 10
+
+/* The size in bytes of the buffer to receive echo replies */
+#define LBEACON_PROBE_BUFFER_SIZE 1024
+
+/* The size in bytes of the payload of echo requests */
+#define LBEACON_PROBE_PAYLOAD_SIZE 8
+
+typedef struct {
+
+    /* The ICMP socket */
+    int socket;
+
+    /* A flag indicating whether the socket is a raw socket, whose received
+       packets start with the IP header. Otherwise it is an unprivileged
+       ICMP datagram socket. */
+    bool is_raw_socket;
+
+    /* The identifier of echo requests sent by this prober */
+    uint16_t identifier;
+
+    /* The time interval in seconds between two probing rounds */
+    int interval_in_sec;
+
+    /* The maximal number of echo requests sent per second */
+    int rate_per_sec;
+
+    /* The LBeacons reported within this duration are probed */
+    int tolerance_duration_in_sec;
+
+    AddressMapArray *address_map;
+
+    /* The cache in which the abnormal LBeacon list is kept */
+    HealthStateCache *health_state_cache;
+
+    /* The LBeacons probed in the current round */
+    int number_targets;
+    char target_names[MAX_NUMBER_NODES][NETWORK_ADDR_LENGTH];
+    struct sockaddr_in targets[MAX_NUMBER_NODES];
+    bool is_alive[MAX_NUMBER_NODES];
+
+    /* The number of LBeacons which did not reply in the latest round */
+    int number_abnormal;
+
+} LBeaconProber;
+
+
+/*
+  init_lbeacon_prober:
+
+     This function opens the ICMP socket of the prober. An unprivileged ICMP
+     datagram socket is preferred and a raw socket is used when the gateway
+     is not allowed to open one.
+
+  Parameters:
+
+     prober - A pointer to the prober.
+     address_map - A pointer to the AddressMap of LBeacons.
+     health_state_cache - A pointer to the cache of the health report.
+     interval_in_sec - The time interval in seconds between probing rounds.
+     rate_per_sec - The maximal number of echo requests sent per second.
+     tolerance_duration_in_sec - The LBeacons reported within this duration
+                                 are probed.
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error if the function
+                 fails or WORK SUCCESSFULLY otherwise
+ */
+ErrorCode init_lbeacon_prober(LBeaconProber *prober,
+                              AddressMapArray *address_map,
+                              HealthStateCache *health_state_cache,
+                              int interval_in_sec,
+                              int rate_per_sec,
+                              int tolerance_duration_in_sec);
+
+/*
+  probe_lbeacons:
+
+     This function runs one probing round and stores the LBeacons which did
+     not reply in the health state cache.
+
+  Parameters:
+
+     prober - A pointer to the prober.
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error if the function
+                 fails or WORK SUCCESSFULLY otherwise
+ */
+ErrorCode probe_lbeacons(LBeaconProber *prober);
+
+/*
+  lbeacon_prober_routine:
+
+     This function is executed by the thread which runs probing rounds
+     periodically until the gateway stops.
+
+  Parameters:
+
+     lbeacon_prober - A pointer to the prober.
+
+  Return value:
+
+     None
+ */
+void *lbeacon_prober_routine(void *lbeacon_prober);
+
+/*
+  release_lbeacon_prober:
+
+     This function closes the socket of the prober.
+
+  Parameters:
+
+     prober - A pointer to the prober.
+
+  Return value:
+
+     None
+ */
+void release_lbeacon_prober(LBeaconProber *prober);
+
+#endif
@@ -0,0 +1,397 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Harness.c
+
+  File Description:
+
+     This file contains the programs of the pipeline harness. Usage:
+
+        Harness.out [-n number_lbeacons] [-r number_reports_per_lbeacon]
+                    [-o number_objects] [-b number_broadcasts]
+                    [-h number_health_requests]
+
+     For example, to profile the gateway processing the reports of 1000
+     LBeacons:
+
+        perf record -g ./Harness.out -n 1000 -r 100
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#include "Harness.h"
+
+
+static const char *phase_names[MAX_HARNESS_PHASE] = {
+    "join",
+    "tracked_object_data",
+    "broadcast",
+    "health_request"
+};
+
+
+static void get_lbeacon_address(int index, char *address){
+
+    snprintf(address, NETWORK_ADDR_LENGTH, "10.1.%d.%d",
+             (index / HARNESS_LBEACONS_PER_SUBNET) & 0xFF,
+             index % HARNESS_LBEACONS_PER_SUBNET + 1);
+}
+
+
+static void inject_lbeacon_message(Harness *harness, int index, char *content){
+
+    char address[NETWORK_ADDR_LENGTH];
+
+    get_lbeacon_address(index, address);
+
+    inject_loopback_message(&harness->loopback, address, HARNESS_SOURCE_PORT,
+                            content, strlen(content));
+}
+
+
+static void inject_server_message(Harness *harness,
+                                  int pkt_type,
+                                  int sequence){
+
+    char content[WIFI_MESSAGE_LENGTH];
+
+    snprintf(content, sizeof(content), "%d;%d;%s;%d;",
+             from_server, pkt_type, BOT_SERVER_API_VERSION_LATEST, sequence);
+
+    inject_loopback_message(&harness->loopback, config.server_ip,
+                            HARNESS_SOURCE_PORT, content, strlen(content));
+}
+
+
+int inject_phase(Harness *harness, HarnessPhase phase){
+
+    HarnessConfig *harness_config = &harness->config;
+    char content[WIFI_MESSAGE_LENGTH];
+    char uuid[LENGTH_OF_UUID];
+    char address[NETWORK_ADDR_LENGTH];
+    int content_size;
+    int number_injected = 0;
+    int report;
+    int index;
+    int i;
+
+    switch(phase){
+
+        case PHASE_JOIN:
+
+            for(index = 0; index < harness_config->number_lbeacons; index++){
+
+                snprintf(uuid, LENGTH_OF_UUID, "%032X", index);
+                snprintf(content, sizeof(content), "%d;%d;%s;%s;%d;",
+                         from_beacon, request_to_join,
+                         BOT_GATEWAY_API_VERSION_LATEST, uuid,
+                         get_system_time());
+
+                inject_lbeacon_message(harness, index, content);
+                number_injected++;
+            }
+            break;
+
+        case PHASE_TRACKED_OBJECT_DATA:
+
+            for(report = 0; report < harness_config->number_reports;
+                report++){
+
+                for(index = 0; index < harness_config->number_lbeacons;
+                    index++){
+
+                    snprintf(uuid, LENGTH_OF_UUID, "%032X", index);
+                    get_lbeacon_address(index, address);
+
+                    content_size = snprintf(content, sizeof(content),
+                                            "%d;%d;%s;%s;%d;%s;0;%d;",
+                                            from_beacon, tracked_object_data,
+                                            BOT_GATEWAY_API_VERSION_LATEST,
+                                            uuid, get_system_time(), address,
+                                            harness_config->number_objects);
+
+                    /* The rssi changes with every report, so that reports
+                       are not held back by the aggregation */
+                    for(i = 0; i < harness_config->number_objects &&
+                               content_size < sizeof(content); i++){
+
+                        content_size += snprintf(
+                            content + content_size,
+                            sizeof(content) - content_size,
+                            "AA:BB:%02X:%02X:%02X:%02X;%d;%d;%d;0;100;",
+                            (index >> 8) & 0xFF, index & 0xFF,
+                            (i >> 8) & 0xFF, i & 0xFF,
+                            get_system_time(), get_system_time(),
+                            -60 - (i + report) % 30);
+                    }
+
+                    inject_lbeacon_message(harness, index, content);
+                    number_injected++;
+                }
+            }
+            break;
+
+        case PHASE_BROADCAST:
+
+            for(i = 0; i < harness_config->number_broadcasts; i++){
+
+                inject_server_message(harness, tracked_object_data, i);
+                number_injected++;
+            }
+            break;
+
+        case PHASE_HEALTH_REQUEST:
+
+            for(i = 0; i < harness_config->number_health_requests; i++){
+
+                inject_server_message(harness, gateway_health_report, i);
+                number_injected++;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return number_injected;
+}
+
+
+void wait_for_phase_end(Harness *harness){
+
+    uint64_t idle_time_in_ns = HARNESS_IDLE_TIME_IN_MS * NS_EACH_MS;
+    uint64_t last_sent_time_in_ns;
+
+    while(true){
+
+        sleep_t(BUSY_WAITING_TIME_IN_MS);
+
+        if(is_null( &harness->loopback.inbound_queue) == false)
+            continue;
+
+        last_sent_time_in_ns = __atomic_load_n(
+            &harness->last_sent_time_in_ns, __ATOMIC_ACQUIRE);
+
+        if(get_clock_time_in_ns() - last_sent_time_in_ns > idle_time_in_ns)
+            break;
+    }
+}
+
+
+void *harness_collect_routine(void *_harness){
+
+    Harness *harness = (Harness *)_harness;
+    sPkt *pkt = malloc(sizeof(sPkt));
+
+    if(pkt == NULL)
+        return (void *)NULL;
+
+    while(harness->is_collecting == true){
+
+        if(collect_loopback_message(&harness->loopback, pkt) !=
+           pkt_Queue_SUCCESS){
+
+            sched_yield();
+            continue;
+        }
+
+        if(strncmp((char *)pkt->address, config.server_ip, 
+                   NETWORK_ADDR_LENGTH) == 0)
+            __atomic_fetch_add(&harness->sent_to_server, 1,
+                               __ATOMIC_RELAXED);
+        else
+            __atomic_fetch_add(&harness->sent_to_lbeacons, 1,
+                               __ATOMIC_RELAXED);
+
+        __atomic_store_n(&harness->last_sent_time_in_ns,
+                         get_clock_time_in_ns(), __ATOMIC_RELEASE);
+    }
+
+    free(pkt);
+
+    return (void *)NULL;
+}
+
+
+void *harness_gateway_routine(void *arg){
+
+    run_gateway();
+
+    return (void *)NULL;
+}
+
+
+static ErrorCode parse_harness_options(HarnessConfig *harness_config,
+                                       int argc,
+                                       char **argv){
+
+    int option;
+
+    harness_config->number_lbeacons = 100;
+    harness_config->number_reports = 100;
+    harness_config->number_objects = 10;
+    harness_config->number_broadcasts = 10;
+    harness_config->number_health_requests = 10;
+
+    while((option = getopt(argc, argv, "n:r:o:b:h:")) != -1){
+
+        switch(option){
+            case 'n':
+                harness_config->number_lbeacons = atoi(optarg);
+                break;
+            case 'r':
+                harness_config->number_reports = atoi(optarg);
+                break;
+            case 'o':
+                harness_config->number_objects = atoi(optarg);
+                break;
+            case 'b':
+                harness_config->number_broadcasts = atoi(optarg);
+                break;
+            case 'h':
+                harness_config->number_health_requests = atoi(optarg);
+                break;
+            default:
+                return E_INPUT_PARAMETER;
+        }
+    }
+
+    if(harness_config->number_lbeacons <= 0 ||
+       harness_config->number_lbeacons > MAX_NUMBER_NODES ||
+       harness_config->number_reports < 0 ||
+       harness_config->number_objects < 0 ||
+       harness_config->number_broadcasts < 0 ||
+       harness_config->number_health_requests < 0)
+        return E_INPUT_PARAMETER;
+
+    return WORK_SUCCESSFULLY;
+}
+
+
+int main(int argc, char **argv){
+
+    Harness *harness = NULL;
+    pthread_t gateway_thread;
+    pthread_t collect_thread;
+    uint64_t start_time_in_ns;
+    uint64_t sent_to_lbeacons;
+    uint64_t sent_to_server;
+    uint64_t elapsed_time_in_ns;
+    double seconds;
+    int number_injected;
+    int waiting_time_in_ms;
+    int phase;
+
+    harness = calloc(1, sizeof(Harness));
+    if(harness == NULL)
+        return E_MALLOC;
+
+    if(parse_harness_options(&harness->config, argc, argv)
+       != WORK_SUCCESSFULLY){
+        fprintf(stderr, "Invalid options, see the usage in Harness.c\n");
+        return E_INPUT_PARAMETER;
+    }
+
+    /* The gateway keeps the transport set before it starts */
+    if(init_loopback_transport(&gateway_transport, &harness->loopback) != 0)
+        return E_INITIALIZATION_FAIL;
+
+    if(pthread_create(&gateway_thread, NULL, harness_gateway_routine, NULL)
+       != 0)
+        return E_START_THREAD;
+
+    for(waiting_time_in_ms = 0;
+        NSI_initialization_complete == false ||
+        CommUnit_initialization_complete == false;
+        waiting_time_in_ms += BUSY_WAITING_TIME_IN_MS){
+
+        if(initialization_failed == true ||
+           waiting_time_in_ms > HARNESS_START_TIMEOUT_IN_MS){
+            fprintf(stderr, "The gateway cannot be started\n");
+            return E_INITIALIZATION_FAIL;
+        }
+
+        sleep_t(BUSY_WAITING_TIME_IN_MS);
+    }
+
+    harness->is_collecting = true;
+
+    if(pthread_create(&collect_thread, NULL, harness_collect_routine,
+                      harness) != 0)
+        return E_START_THREAD;
+
+    /* Let the messages the gateway sends on starting be collected */
+    harness->last_sent_time_in_ns = get_clock_time_in_ns();
+    wait_for_phase_end(harness);
+
+    printf("phase,injected,sent_to_lbeacons,sent_to_server,seconds,"
+           "injected_per_sec\n");
+
+    for(phase = 0; phase < MAX_HARNESS_PHASE; phase++){
+
+        sent_to_lbeacons = __atomic_load_n(&harness->sent_to_lbeacons,
+                                           __ATOMIC_ACQUIRE);
+        sent_to_server = __atomic_load_n(&harness->sent_to_server,
+                                         __ATOMIC_ACQUIRE);
+
+        start_time_in_ns = get_clock_time_in_ns();
+        harness->last_sent_time_in_ns = start_time_in_ns;
+
+        number_injected = inject_phase(harness, phase);
+
+        wait_for_phase_end(harness);
+
+        elapsed_time_in_ns = __atomic_load_n(&harness->last_sent_time_in_ns,
+                                             __ATOMIC_ACQUIRE) -
+                             start_time_in_ns;
+        seconds = (double)elapsed_time_in_ns / NS_EACH_SECOND;
+
+        printf("%s,%d,%llu,%llu,%.6f,%.1f\n",
+               phase_names[phase], number_injected,
+               (unsigned long long)(__atomic_load_n(
+                   &harness->sent_to_lbeacons, __ATOMIC_ACQUIRE) -
+                   sent_to_lbeacons),
+               (unsigned long long)(__atomic_load_n(
+                   &harness->sent_to_server, __ATOMIC_ACQUIRE) -
+                   sent_to_server),
+               seconds,
+               seconds > 0 ? number_injected / seconds : 0);
+    }
+
+    /* The gateway stops as it does on SIGINT */
+    ready_to_work = false;
+    pthread_join(gateway_thread, NULL);
+
+    harness->is_collecting = false;
+    pthread_join(collect_thread, NULL);
+
+    release_loopback_transport(&harness->loopback);
+    free(harness);
+
+    return WORK_SUCCESSFULLY;
+}
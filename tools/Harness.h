@@ -0,0 +1,192 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Harness.h
+
+  File Description:
+
+     This header file contains the declarations of the pipeline harness,
+     which links the gateway and runs it in the same process over the
+     loopback transport. No socket is opened, so the gateway can be run
+     under perf or valgrind, and every message received and sent by the
+     gateway is counted exactly.
+
+     The harness injects the messages of each phase as fast as the gateway
+     receives them, waits until the gateway stops sending, and prints for
+     each phase
+
+        phase,injected,sent_to_lbeacons,sent_to_server,seconds,injected_per_sec
+
+     where seconds is the time from the first message injected to the last
+     message sent by the gateway. The gateway reads its configuration from
+     the same files as Gateway.out.
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <getopt.h>
+
+#include "Gateway.h"
+
+/* The number of LBeacon addresses in each 10.1.x.0/24 subnet */
+#define HARNESS_LBEACONS_PER_SUBNET 254
+
+/* The port the messages of the LBeacons and the server come from */
+#define HARNESS_SOURCE_PORT 9999
+
+/* The time in milliseconds without messages sent by the gateway after
+   which a phase is finished */
+#define HARNESS_IDLE_TIME_IN_MS 500
+
+/* The longest time in milliseconds to wait for the gateway to start */
+#define HARNESS_START_TIMEOUT_IN_MS 10000
+
+
+/* The phases of messages injected by the harness */
+typedef enum _HarnessPhase {
+
+    /* request_to_join from every LBeacon */
+    PHASE_JOIN = 0,
+
+    /* tracked_object_data from every LBeacon */
+    PHASE_TRACKED_OBJECT_DATA = 1,
+
+    /* tracked_object_data from the server broadcast to every LBeacon */
+    PHASE_BROADCAST = 2,
+
+    /* gateway_health_report requested by the server */
+    PHASE_HEALTH_REQUEST = 3,
+
+    MAX_HARNESS_PHASE = 4
+
+} HarnessPhase;
+
+typedef struct {
+
+    int number_lbeacons;
+
+    /* The number of tracked_object_data sent by each LBeacon */
+    int number_reports;
+
+    /* The number of objects in each tracked_object_data */
+    int number_objects;
+
+    /* The number of broadcasts and health report requests of the server */
+    int number_broadcasts;
+    int number_health_requests;
+
+} HarnessConfig;
+
+typedef struct {
+
+    HarnessConfig config;
+
+    LoopbackTransport loopback;
+
+    /* The numbers of messages sent by the gateway to LBeacons and to the
+       server */
+    uint64_t sent_to_lbeacons;
+    uint64_t sent_to_server;
+
+    /* The uptime in nanoseconds at which the gateway sent the latest
+       message */
+    uint64_t last_sent_time_in_ns;
+
+    /* The flag keeping the collecting thread running */
+    bool is_collecting;
+
+} Harness;
+
+
+/*
+  inject_phase:
+
+     This function injects the messages of a phase into the gateway.
+
+  Parameters:
+
+     harness - A pointer to the harness.
+     phase - The phase.
+
+  Return value:
+
+     int - The number of messages injected.
+ */
+int inject_phase(Harness *harness, HarnessPhase phase);
+
+/*
+  wait_for_phase_end:
+
+     This function waits until the gateway received every message injected
+     and sent nothing for HARNESS_IDLE_TIME_IN_MS.
+
+  Parameters:
+
+     harness - A pointer to the harness.
+
+  Return value:
+
+     None
+ */
+void wait_for_phase_end(Harness *harness);
+
+/*
+  harness_collect_routine:
+
+     This function is executed by the thread which collects and counts the
+     messages sent by the gateway until the harness stops.
+
+  Parameters:
+
+     harness - A pointer to the harness.
+
+  Return value:
+
+     None
+ */
+void *harness_collect_routine(void *harness);
+
+/*
+  harness_gateway_routine:
+
+     This function is executed by the thread which runs the gateway.
+
+  Parameters:
+
+     arg - Not used.
+
+  Return value:
+
+     None
+ */
+void *harness_gateway_routine(void *arg);
+
+#endif
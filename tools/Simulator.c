@@ -0,0 +1,865 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Simulator.c
+
+  File Description:
+
+     This file contains the programs of the traffic simulator. Usage:
+
+        Simulator.out [-g gateway_ip] [-r gateway_recv_port]
+                      [-s gateway_send_port] [-n number_lbeacons]
+                      [-d duration_in_sec] [-t report_interval_in_ms]
+                      [-o number_objects] [-h health_request_interval_in_ms]
+                      [-b broadcast_interval_in_ms]
+                      [-a alarm_interval_in_ms] [-w drain_time_in_sec]
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#include "Simulator.h"
+
+
+static const char *flow_names[MAX_SIMULATED_FLOW] = {
+    "join",
+    "tracked_object_data",
+    "beacon_health_report",
+    "gateway_health_report",
+    "broadcast",
+    "notification_alarm"
+};
+
+
+/* Formats the uuid of a LBeacon from its index, so that the index is read
+   back from the last digits */
+static void get_lbeacon_uuid(int index, char *uuid){
+
+    snprintf(uuid, LENGTH_OF_UUID, "%032X", index);
+}
+
+
+static int get_lbeacon_index(char *uuid){
+
+    int index;
+
+    if(uuid == NULL || strlen(uuid) != LENGTH_OF_UUID - 1)
+        return -1;
+
+    index = (int)strtol(uuid + LENGTH_OF_UUID - 1 - 8, NULL, 16);
+
+    if(index < 0 || index >= MAX_NUMBER_NODES)
+        return -1;
+
+    return index;
+}
+
+
+/* Records the latency of a flow from the send time, unless the send time is
+   no longer kept */
+static void record_flow(Simulator *simulator,
+                        SimulatedFlow flow,
+                        uint64_t sent_time_in_ns){
+
+    FlowStatistics *statistics = &simulator->flows[flow];
+
+    statistics->received_count++;
+
+    if(sent_time_in_ns != 0)
+        histogram_record(&statistics->latency,
+                         get_clock_time_in_ns() - sent_time_in_ns);
+}
+
+
+/* Gets the send time of a request by its sequence number */
+static uint64_t get_request_time(uint64_t *request_times,
+                                 int number_requests,
+                                 int sequence){
+
+    if(sequence < 0 || sequence >= number_requests ||
+       number_requests - sequence > SIMULATOR_REQUEST_WINDOW)
+        return 0;
+
+    return __atomic_load_n(&request_times[sequence %
+                                          SIMULATOR_REQUEST_WINDOW],
+                           __ATOMIC_ACQUIRE);
+}
+
+
+ErrorCode send_simulated_message(Simulator *simulator,
+                                 struct in_addr source,
+                                 char *content){
+
+    char message[LENGTH_OF_ENCODED_WIFI_MESSAGE];
+    char control[CMSG_SPACE(sizeof(struct in_pktinfo))];
+    struct in_pktinfo *packet_info = NULL;
+    struct cmsghdr *control_message = NULL;
+    struct msghdr message_header;
+    struct iovec iov;
+    int size;
+
+    size = udp_encode_message(content, message, sizeof(message));
+    if(size < 0)
+        return E_BUFFER_SIZE;
+
+    iov.iov_base = message;
+    iov.iov_len = size;
+
+    memset(&message_header, 0, sizeof(message_header));
+    memset(control, 0, sizeof(control));
+
+    message_header.msg_name = &simulator->gateway_address;
+    message_header.msg_namelen = sizeof(simulator->gateway_address);
+    message_header.msg_iov = &iov;
+    message_header.msg_iovlen = 1;
+    message_header.msg_control = control;
+    message_header.msg_controllen = sizeof(control);
+
+    /* The source address tells the gateway which LBeacon sends */
+    control_message = CMSG_FIRSTHDR(&message_header);
+    control_message->cmsg_level = IPPROTO_IP;
+    control_message->cmsg_type = IP_PKTINFO;
+    control_message->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+
+    packet_info = (struct in_pktinfo *)CMSG_DATA(control_message);
+    packet_info->ipi_spec_dst = source;
+
+    if(sendmsg(simulator->send_socket, &message_header, 0) != size)
+        return E_ADD_PACKET_TO_QUEUE;
+
+    return WORK_SUCCESSFULLY;
+}
+
+
+void send_join_requests(Simulator *simulator){
+
+    char content[WIFI_MESSAGE_LENGTH];
+    char uuid[LENGTH_OF_UUID];
+    int i;
+
+    for(i = 0; i < simulator->config.number_lbeacons; i++){
+
+        get_lbeacon_uuid(i, uuid);
+
+        snprintf(content, sizeof(content), "%d;%d;%s;%s;%d;",
+                 from_beacon, request_to_join,
+                 BOT_GATEWAY_API_VERSION_LATEST, uuid, get_system_time());
+
+        __atomic_store_n(&simulator->join_time_in_ns[i],
+                         get_clock_time_in_ns(), __ATOMIC_RELEASE);
+
+        if(send_simulated_message(simulator,
+                                  simulator->lbeacon_addresses[i],
+                                  content) == WORK_SUCCESSFULLY)
+            __atomic_fetch_add(&simulator->flows[FLOW_JOIN].sent_count, 1,
+                               __ATOMIC_RELAXED);
+
+        /* Join in batches, as LBeacons powered on together do */
+        if((i + 1) % SIMULATOR_LBEACONS_PER_SUBNET == 0)
+            sleep_t(SIMULATOR_TICK_IN_MS);
+    }
+}
+
+
+void lbeacon_report_timer_routine(void *arg){
+
+    Simulator *simulator = (Simulator *)arg;
+    SimulatorConfig *config = &simulator->config;
+    char content[WIFI_MESSAGE_LENGTH];
+    char uuid[LENGTH_OF_UUID];
+    uint64_t now = get_clock_time_in_ns();
+    uint64_t number_due;
+    int content_size;
+    int index;
+    int i;
+
+    /* The reports of all LBeacons are spread over the report interval */
+    number_due = (now - simulator->start_time_in_ns) *
+                 config->number_lbeacons /
+                 ((uint64_t)config->report_interval_in_ms * NS_EACH_MS);
+
+    while(simulator->number_reports < number_due){
+
+        index = simulator->number_reports % config->number_lbeacons;
+
+        get_lbeacon_uuid(index, uuid);
+
+        /* The sequence number of the report is sent as the timestamp of the
+           LBeacon, which the gateway forwards to the server */
+        content_size = snprintf(content, sizeof(content),
+                                "%d;%d;%s;%s;%d;%s;0;%d;",
+                                from_beacon, tracked_object_data,
+                                BOT_GATEWAY_API_VERSION_LATEST, uuid,
+                                simulator->number_reports,
+                                simulator->lbeacon_ips[index],
+                                config->number_objects);
+
+        for(i = 0; i < config->number_objects &&
+                   content_size < sizeof(content); i++){
+
+            content_size += snprintf(content + content_size,
+                                     sizeof(content) - content_size,
+                                     "AA:BB:%02X:%02X:%02X:%02X;%d;%d;%d;"
+                                     "0;100;",
+                                     (index >> 8) & 0xFF, index & 0xFF,
+                                     (i >> 8) & 0xFF, i & 0xFF,
+                                     get_system_time(), get_system_time(),
+                                     -60 - (i + simulator->number_reports /
+                                            config->number_lbeacons) % 30);
+        }
+
+        __atomic_store_n(&simulator->report_time_in_ns[
+                             simulator->number_reports %
+                             SIMULATOR_REPORT_WINDOW],
+                         get_clock_time_in_ns(), __ATOMIC_RELEASE);
+
+        if(send_simulated_message(simulator,
+                                  simulator->lbeacon_addresses[index],
+                                  content) == WORK_SUCCESSFULLY)
+            __atomic_fetch_add(
+                &simulator->flows[FLOW_TRACKED_OBJECT_DATA].sent_count, 1,
+                __ATOMIC_RELAXED);
+
+        __atomic_fetch_add(&simulator->number_reports, 1, __ATOMIC_RELEASE);
+    }
+}
+
+
+/* Sends a request of the server whose sequence number is the first field of
+   the content */
+static void send_server_request(Simulator *simulator,
+                               int pkt_type,
+                               uint64_t *request_times,
+                               int *number_requests,
+                               char *parameters){
+
+    char content[WIFI_MESSAGE_LENGTH];
+    struct in_addr source;
+    int written;
+
+    inet_aton(SIMULATOR_SERVER_ADDRESS, &source);
+
+    /* A truncated request would not be parsed by the gateway, so it is not
+       sent */
+    written = snprintf(content, sizeof(content), "%d;%d;%s;%d;%s",
+                       from_server, pkt_type, BOT_SERVER_API_VERSION_LATEST,
+                       *number_requests, parameters);
+    if(written < 0 || written >= sizeof(content))
+        return;
+
+    __atomic_store_n(&request_times[*number_requests %
+                                    SIMULATOR_REQUEST_WINDOW],
+                     get_clock_time_in_ns(), __ATOMIC_RELEASE);
+
+    __atomic_fetch_add(number_requests, 1, __ATOMIC_RELEASE);
+
+    send_simulated_message(simulator, source, content);
+}
+
+
+void health_request_timer_routine(void *arg){
+
+    Simulator *simulator = (Simulator *)arg;
+    int number_joined = __atomic_load_n(&simulator->number_joined,
+                                        __ATOMIC_RELAXED);
+
+    /* The gateway reports its health and asks every LBeacon for its own */
+    __atomic_fetch_add(
+        &simulator->flows[FLOW_GATEWAY_HEALTH_REPORT].sent_count, 1,
+        __ATOMIC_RELAXED);
+    __atomic_fetch_add(&simulator->flows[FLOW_BROADCAST].sent_count,
+                       number_joined, __ATOMIC_RELAXED);
+
+    send_server_request(simulator, gateway_health_report,
+                        simulator->health_request_time_in_ns,
+                        &simulator->number_health_requests, "");
+}
+
+
+void broadcast_timer_routine(void *arg){
+
+    Simulator *simulator = (Simulator *)arg;
+
+    __atomic_fetch_add(&simulator->flows[FLOW_BROADCAST].sent_count,
+                       __atomic_load_n(&simulator->number_joined,
+                                       __ATOMIC_RELAXED),
+                       __ATOMIC_RELAXED);
+
+    send_server_request(simulator, tracked_object_data,
+                        simulator->broadcast_time_in_ns,
+                        &simulator->number_broadcasts, "");
+}
+
+
+void alarm_timer_routine(void *arg){
+
+    Simulator *simulator = (Simulator *)arg;
+    char parameters[WIFI_MESSAGE_LENGTH];
+
+    /* The sequence number is sent as the alarm type, followed by the
+       duration and the list of agents */
+    snprintf(parameters, sizeof(parameters), "5;1,%s:%d,;",
+             SIMULATOR_AGENT_ADDRESS, simulator->config.send_port);
+
+    __atomic_fetch_add(&simulator->flows[FLOW_NOTIFICATION_ALARM].sent_count,
+                       1, __ATOMIC_RELAXED);
+
+    send_server_request(simulator, notification_alarm,
+                        simulator->alarm_time_in_ns,
+                        &simulator->number_alarms, parameters);
+}
+
+
+void stop_timer_routine(void *arg){
+
+    Simulator *simulator = (Simulator *)arg;
+
+    simulator->is_sending = false;
+}
+
+
+/* Handles a message to a LBeacon */
+static void handle_lbeacon_message(Simulator *simulator,
+                                   int index,
+                                   int pkt_type,
+                                   char *content){
+
+    char reply[WIFI_MESSAGE_LENGTH];
+    char uuid[LENGTH_OF_UUID];
+    char *saveptr = NULL;
+    char *field = NULL;
+    int join_status;
+    int sequence;
+
+    switch(pkt_type){
+
+        case join_response:
+
+            /* uuid;timestamp;net_address;join_status; */
+            field = strtok_r(content, DELIMITER_SEMICOLON, &saveptr);
+            if(get_lbeacon_index(field) != index)
+                break;
+
+            strtok_r(NULL, DELIMITER_SEMICOLON, &saveptr);
+            strtok_r(NULL, DELIMITER_SEMICOLON, &saveptr);
+            field = strtok_r(NULL, DELIMITER_SEMICOLON, &saveptr);
+            if(field == NULL)
+                break;
+
+            join_status = atoi(field);
+
+            if(join_status == JOIN_ACK &&
+               simulator->is_joined[index] == false){
+
+                simulator->is_joined[index] = true;
+                __atomic_fetch_add(&simulator->number_joined, 1,
+                                   __ATOMIC_RELAXED);
+            }
+
+            record_flow(simulator, FLOW_JOIN,
+                        __atomic_load_n(&simulator->join_time_in_ns[index],
+                                        __ATOMIC_ACQUIRE));
+            break;
+
+        case tracked_object_data:
+
+            sequence = atoi(content);
+
+            record_flow(simulator, FLOW_BROADCAST,
+                        get_request_time(simulator->broadcast_time_in_ns,
+                                         __atomic_load_n(
+                                             &simulator->number_broadcasts,
+                                             __ATOMIC_ACQUIRE),
+                                         sequence));
+            break;
+
+        case beacon_health_report:
+
+            sequence = atoi(content);
+
+            record_flow(simulator, FLOW_BROADCAST,
+                        get_request_time(simulator->health_request_time_in_ns,
+                                         __atomic_load_n(
+                                             &simulator->number_health_requests,
+                                             __ATOMIC_ACQUIRE),
+                                         sequence));
+
+            /* The LBeacon answers with the sequence number of the request as
+               its timestamp */
+            get_lbeacon_uuid(index, uuid);
+
+            snprintf(reply, sizeof(reply), "%d;%d;%s;%s;%d;%s;%d;",
+                     from_beacon, beacon_health_report,
+                     BOT_GATEWAY_API_VERSION_LATEST, uuid, sequence,
+                     simulator->lbeacon_ips[index], S_NORMAL_STATUS);
+
+            if(send_simulated_message(simulator,
+                                      simulator->lbeacon_addresses[index],
+                                      reply) == WORK_SUCCESSFULLY)
+                __atomic_fetch_add(
+                    &simulator->flows[FLOW_BEACON_HEALTH_REPORT].sent_count, 1,
+                    __ATOMIC_RELAXED);
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/* Handles a message to the server */
+static void handle_server_message(Simulator *simulator,
+                                  int pkt_type,
+                                  char *content){
+
+    char *saveptr = NULL;
+    char *field = NULL;
+    int sequence;
+
+    switch(pkt_type){
+
+        case tracked_object_data:
+        case time_critical_tracked_object_data:
+
+            /* uuid;sequence;... */
+            strtok_r(content, DELIMITER_SEMICOLON, &saveptr);
+            field = strtok_r(NULL, DELIMITER_SEMICOLON, &saveptr);
+            if(field == NULL)
+                break;
+
+            sequence = atoi(field);
+
+            if(sequence < 0 ||
+               __atomic_load_n(&simulator->number_reports, __ATOMIC_ACQUIRE) -
+               sequence > SIMULATOR_REPORT_WINDOW){
+
+                record_flow(simulator, FLOW_TRACKED_OBJECT_DATA, 0);
+                break;
+            }
+
+            record_flow(simulator, FLOW_TRACKED_OBJECT_DATA,
+                        __atomic_load_n(&simulator->report_time_in_ns[
+                                            sequence %
+                                            SIMULATOR_REPORT_WINDOW],
+                                        __ATOMIC_ACQUIRE));
+            break;
+
+        case beacon_health_report:
+
+            strtok_r(content, DELIMITER_SEMICOLON, &saveptr);
+            field = strtok_r(NULL, DELIMITER_SEMICOLON, &saveptr);
+            if(field == NULL)
+                break;
+
+            record_flow(simulator, FLOW_BEACON_HEALTH_REPORT,
+                        get_request_time(simulator->health_request_time_in_ns,
+                                         __atomic_load_n(
+                                             &simulator->number_health_requests,
+                                             __ATOMIC_ACQUIRE),
+                                         atoi(field)));
+            break;
+
+        case gateway_health_report:
+
+            /* The report does not carry the request, so the latency is
+               measured from the last request */
+            record_flow(simulator, FLOW_GATEWAY_HEALTH_REPORT,
+                        get_request_time(simulator->health_request_time_in_ns,
+                                         __atomic_load_n(
+                                             &simulator->number_health_requests,
+                                             __ATOMIC_ACQUIRE),
+                                         simulator->number_health_requests -
+                                         1));
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+void handle_gateway_message(Simulator *simulator,
+                            struct in_addr destination,
+                            char *message){
+
+    char *saveptr = NULL;
+    char *pkt_direction = NULL;
+    char *pkt_type = NULL;
+    char *API_version = NULL;
+    char *content = NULL;
+    uint32_t address = ntohl(destination.s_addr);
+    int index;
+
+    /* pkt_direction;pkt_type;API_version;content */
+    pkt_direction = strtok_r(message, DELIMITER_SEMICOLON, &saveptr);
+    pkt_type = strtok_r(NULL, DELIMITER_SEMICOLON, &saveptr);
+    API_version = strtok_r(NULL, DELIMITER_SEMICOLON, &saveptr);
+    content = saveptr;
+
+    if(API_version == NULL || content == NULL ||
+       atoi(pkt_direction) != from_gateway)
+        return;
+
+    if(destination.s_addr == inet_addr(SIMULATOR_SERVER_ADDRESS)){
+
+        handle_server_message(simulator, atoi(pkt_type), content);
+
+    }else if(destination.s_addr == inet_addr(SIMULATOR_AGENT_ADDRESS)){
+
+        if(atoi(pkt_type) != notification_alarm)
+            return;
+
+        record_flow(simulator, FLOW_NOTIFICATION_ALARM,
+                    get_request_time(simulator->alarm_time_in_ns,
+                                     __atomic_load_n(&simulator->number_alarms,
+                                                     __ATOMIC_ACQUIRE),
+                                     atoi(content)));
+
+    }else if((address >> 16) == ((127 << 8) | 1)){
+
+        /* 127.1.x.y is the LBeacon x * SIMULATOR_LBEACONS_PER_SUBNET + y - 1 */
+        index = ((address >> 8) & 0xFF) * SIMULATOR_LBEACONS_PER_SUBNET +
+                (address & 0xFF) - 1;
+
+        if(index >= 0 && index < simulator->config.number_lbeacons)
+            handle_lbeacon_message(simulator, index, atoi(pkt_type), content);
+    }
+}
+
+
+void *simulator_receive_routine(void *_simulator){
+
+    Simulator *simulator = (Simulator *)_simulator;
+    char message[LENGTH_OF_ENCODED_WIFI_MESSAGE];
+    char control[CMSG_SPACE(sizeof(struct in_pktinfo))];
+    struct cmsghdr *control_message = NULL;
+    struct in_addr destination;
+    struct msghdr message_header;
+    struct pollfd poll_fd;
+    struct iovec iov;
+    ssize_t len;
+
+    poll_fd.fd = simulator->receive_socket;
+    poll_fd.events = POLLIN;
+
+    while(simulator->is_receiving == true){
+
+        if(poll(&poll_fd, 1, SIMULATOR_POLL_TIMEOUT_IN_MS) <= 0)
+            continue;
+
+        iov.iov_base = message;
+        iov.iov_len = sizeof(message) - 1;
+
+        memset(&message_header, 0, sizeof(message_header));
+        message_header.msg_iov = &iov;
+        message_header.msg_iovlen = 1;
+        message_header.msg_control = control;
+        message_header.msg_controllen = sizeof(control);
+
+        len = recvmsg(simulator->receive_socket, &message_header,
+                      MSG_DONTWAIT);
+        if(len <= 0)
+            continue;
+
+        message[len] = '\0';
+
+        /* The destination address tells whom the message is sent to */
+        destination.s_addr = htonl(INADDR_ANY);
+
+        for(control_message = CMSG_FIRSTHDR(&message_header);
+            control_message != NULL;
+            control_message = CMSG_NXTHDR(&message_header, control_message)){
+
+            if(control_message->cmsg_level == IPPROTO_IP &&
+               control_message->cmsg_type == IP_PKTINFO)
+                destination = ((struct in_pktinfo *)
+                               CMSG_DATA(control_message))->ipi_addr;
+        }
+
+        if(udp_decode_message(message) < 0)
+            continue;
+
+        handle_gateway_message(simulator, destination, message);
+    }
+
+    return (void *)NULL;
+}
+
+
+/* Gets a percentile of the latency in milliseconds. The percentile is the
+   upper bound of a bucket, so it is limited to the largest latency. */
+static double get_latency_percentile_in_ms(Histogram *latency,
+                                           double percentile){
+
+    uint64_t value = histogram_percentile(latency, percentile);
+
+    if(value > latency->max_value)
+        value = latency->max_value;
+
+    return (double)value / NS_EACH_MS;
+}
+
+
+void print_flow_statistics(Simulator *simulator, double elapsed_time_in_sec){
+
+    FlowStatistics *statistics = NULL;
+    double loss_percent;
+    int flow;
+
+    printf("flow,sent,received,loss_percent,received_per_sec,"
+           "p50_ms,p99_ms,max_ms\n");
+
+    for(flow = 0; flow < MAX_SIMULATED_FLOW; flow++){
+
+        statistics = &simulator->flows[flow];
+
+        loss_percent = 0;
+        if(statistics->sent_count > statistics->received_count)
+            loss_percent = 100.0 *
+                           (statistics->sent_count -
+                            statistics->received_count) /
+                           statistics->sent_count;
+
+        printf("%s,%llu,%llu,%.2f,%.1f,%.3f,%.3f,%.3f\n",
+               flow_names[flow],
+               (unsigned long long)statistics->sent_count,
+               (unsigned long long)statistics->received_count,
+               loss_percent,
+               statistics->received_count / elapsed_time_in_sec,
+               get_latency_percentile_in_ms(&statistics->latency, 50),
+               get_latency_percentile_in_ms(&statistics->latency, 99),
+               (double)statistics->latency.max_value / NS_EACH_MS);
+    }
+}
+
+
+/* Opens the socket to send from any loopback address and the socket to
+   receive the messages from the gateway */
+static ErrorCode open_simulator_sockets(Simulator *simulator){
+
+    SimulatorConfig *config = &simulator->config;
+    struct sockaddr_in address;
+    int optval = 1;
+    int buffer_size = SIMULATOR_SOCKET_BUFFER_SIZE;
+
+    simulator->send_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    simulator->receive_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+    if(simulator->send_socket == -1 || simulator->receive_socket == -1)
+        return E_OPEN_SOCKET;
+
+    setsockopt(simulator->send_socket, SOL_SOCKET, SO_SNDBUF, &buffer_size,
+               sizeof(buffer_size));
+    setsockopt(simulator->receive_socket, SOL_SOCKET, SO_RCVBUF,
+               &buffer_size, sizeof(buffer_size));
+    setsockopt(simulator->receive_socket, SOL_SOCKET, SO_REUSEADDR, &optval,
+               sizeof(optval));
+
+    if(setsockopt(simulator->receive_socket, IPPROTO_IP, IP_PKTINFO,
+                  &optval, sizeof(optval)) != 0)
+        return E_OPEN_SOCKET;
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(config->send_port);
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if(bind(simulator->receive_socket, (struct sockaddr *)&address,
+            sizeof(address)) != 0)
+        return E_OPEN_SOCKET;
+
+    memset(&simulator->gateway_address, 0,
+           sizeof(simulator->gateway_address));
+    simulator->gateway_address.sin_family = AF_INET;
+    simulator->gateway_address.sin_port = htons(config->gateway_port);
+
+    if(inet_aton(config->gateway_ip,
+                 &simulator->gateway_address.sin_addr) == 0)
+        return E_INPUT_PARAMETER;
+
+    return WORK_SUCCESSFULLY;
+}
+
+
+static ErrorCode parse_simulator_options(SimulatorConfig *config,
+                                         int argc,
+                                         char **argv){
+
+    int option;
+
+    strncpy(config->gateway_ip, "127.0.0.1", NETWORK_ADDR_LENGTH);
+    config->gateway_port = 8888;
+    config->send_port = 9999;
+    config->number_lbeacons = 1000;
+    config->duration_in_sec = 30;
+    config->drain_time_in_sec = 2;
+    config->report_interval_in_ms = 1000;
+    config->number_objects = 10;
+    config->health_request_interval_in_ms = 10000;
+    config->broadcast_interval_in_ms = 10000;
+    config->alarm_interval_in_ms = 10000;
+
+    while((option = getopt(argc, argv, "g:r:s:n:d:t:o:h:b:a:w:")) != -1){
+
+        switch(option){
+            case 'g':
+                strncpy(config->gateway_ip, optarg, NETWORK_ADDR_LENGTH - 1);
+                break;
+            case 'r':
+                config->gateway_port = atoi(optarg);
+                break;
+            case 's':
+                config->send_port = atoi(optarg);
+                break;
+            case 'n':
+                config->number_lbeacons = atoi(optarg);
+                break;
+            case 'd':
+                config->duration_in_sec = atoi(optarg);
+                break;
+            case 't':
+                config->report_interval_in_ms = atoi(optarg);
+                break;
+            case 'o':
+                config->number_objects = atoi(optarg);
+                break;
+            case 'h':
+                config->health_request_interval_in_ms = atoi(optarg);
+                break;
+            case 'b':
+                config->broadcast_interval_in_ms = atoi(optarg);
+                break;
+            case 'a':
+                config->alarm_interval_in_ms = atoi(optarg);
+                break;
+            case 'w':
+                config->drain_time_in_sec = atoi(optarg);
+                break;
+            default:
+                return E_INPUT_PARAMETER;
+        }
+    }
+
+    if(config->number_lbeacons <= 0 ||
+       config->number_lbeacons > MAX_NUMBER_NODES ||
+       config->duration_in_sec <= 0 ||
+       config->report_interval_in_ms <= 0 ||
+       config->number_objects < 0)
+        return E_INPUT_PARAMETER;
+
+    return WORK_SUCCESSFULLY;
+}
+
+
+int main(int argc, char **argv){
+
+    Simulator *simulator = NULL;
+    SimulatorConfig *config = NULL;
+    pthread_t receive_thread;
+    int i;
+
+    simulator = calloc(1, sizeof(Simulator));
+    if(simulator == NULL)
+        return E_MALLOC;
+
+    config = &simulator->config;
+
+    if(parse_simulator_options(config, argc, argv) != WORK_SUCCESSFULLY){
+        fprintf(stderr, "Invalid options, see the usage in Simulator.c\n");
+        return E_INPUT_PARAMETER;
+    }
+
+    if(open_simulator_sockets(simulator) != WORK_SUCCESSFULLY){
+        fprintf(stderr, "Cannot open the sockets, errno [%d]\n", errno);
+        return E_OPEN_SOCKET;
+    }
+
+    for(i = 0; i < config->number_lbeacons; i++){
+
+        if(snprintf(simulator->lbeacon_ips[i], NETWORK_ADDR_LENGTH,
+                    "127.1.%d.%d", i / SIMULATOR_LBEACONS_PER_SUBNET,
+                    i % SIMULATOR_LBEACONS_PER_SUBNET + 1) >= 
+           NETWORK_ADDR_LENGTH)
+            return E_BUFFER_SIZE;
+        inet_aton(simulator->lbeacon_ips[i],
+                  &simulator->lbeacon_addresses[i]);
+    }
+
+    simulator->is_receiving = true;
+
+    if(pthread_create(&receive_thread, NULL, simulator_receive_routine,
+                      simulator) != 0)
+        return E_START_THREAD;
+
+    send_join_requests(simulator);
+
+    /* Give the gateway time to answer the joins before the reports */
+    sleep_t(NORMAL_WAITING_TIME_IN_MS);
+
+    if(init_timer_queue(&simulator->timers) != 0)
+        return E_INITIALIZATION_FAIL;
+
+    simulator->start_time_in_ns = get_clock_time_in_ns();
+    simulator->is_sending = true;
+
+    add_timer(&simulator->timers, lbeacon_report_timer_routine, simulator,
+              SIMULATOR_TICK_IN_MS, SIMULATOR_TICK_IN_MS);
+
+    if(config->health_request_interval_in_ms > 0)
+        add_timer(&simulator->timers, health_request_timer_routine,
+                  simulator, config->health_request_interval_in_ms,
+                  config->health_request_interval_in_ms);
+
+    if(config->broadcast_interval_in_ms > 0)
+        add_timer(&simulator->timers, broadcast_timer_routine, simulator,
+                  config->broadcast_interval_in_ms,
+                  config->broadcast_interval_in_ms);
+
+    if(config->alarm_interval_in_ms > 0)
+        add_timer(&simulator->timers, alarm_timer_routine, simulator,
+                  config->alarm_interval_in_ms, config->alarm_interval_in_ms);
+
+    add_timer(&simulator->timers, stop_timer_routine, simulator,
+              config->duration_in_sec * 1000, 0);
+
+    run_timer_queue(&simulator->timers, &simulator->is_sending);
+
+    /* Wait for the responses to the last messages */
+    sleep_t(config->drain_time_in_sec * 1000);
+
+    simulator->is_receiving = false;
+    pthread_join(receive_thread, NULL);
+
+    print_flow_statistics(simulator, config->duration_in_sec);
+
+    release_timer_queue(&simulator->timers);
+    close(simulator->send_socket);
+    close(simulator->receive_socket);
+    free(simulator);
+
+    return WORK_SUCCESSFULLY;
+}
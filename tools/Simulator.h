@@ -0,0 +1,387 @@
+/*
+  2020 © Copyright (c) BiDaE Technology Inc.
+  Provided under BiDaE SHAREWARE LICENSE-1.0 in the LICENSE.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Simulator.h
+
+  File Description:
+
+     This header file contains the declarations of the traffic simulator,
+     which emulates LBeacons, a BeDIS server and an agent on the loopback
+     interface to load-test a gateway running on the same host.
+
+     Every simulated LBeacon has its own loopback address 127.1.x.y, which is
+     set as the source address of its messages, so the gateway keeps one
+     entry of its AddressMap for each of them. The server sends from
+     127.0.0.1 and the agent listens on SIMULATOR_AGENT_ADDRESS. All the
+     messages are framed by udp_encode_message as the gateway expects, and
+     the messages from the gateway to all of them are received by one socket
+     on the send port of the gateway and told apart by their destination
+     address. The gateway under test is configured with
+
+        server_ip=127.0.0.1
+
+     The simulated LBeacons join, send tracked_object_data periodically and
+     answer the health report requests broadcast by the gateway. The
+     simulated server requests gateway_health_report, broadcasts
+     tracked_object_data and sends notification_alarm to the agent. A
+     sequence number in each message tells the simulator when the message
+     which caused it was sent, and for each flow of messages the simulator
+     prints
+
+        flow,sent,received,loss_percent,received_per_sec,p50_ms,p99_ms,max_ms
+
+  Version:
+
+     1.0, 20261019
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Holly Wang     , hollywang@iis.sinica.edu.tw
+     Chun-Yu Lai    , chunyu1202@gmail.com
+ */
+
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/poll.h>
+
+#include "BeDIS.h"
+#include "TimerQueue.h"
+#include "libEncrypt.h"
+
+/* The address the simulated server sends from */
+#define SIMULATOR_SERVER_ADDRESS "127.0.0.1"
+
+/* The address of the simulated agent receiving notification alarms */
+#define SIMULATOR_AGENT_ADDRESS "127.2.0.1"
+
+/* The number of LBeacon addresses in each 127.1.x.0/24 subnet */
+#define SIMULATOR_LBEACONS_PER_SUBNET 254
+
+/* The number of send times kept for tracked_object_data reports. It must
+   exceed the number of reports in flight. */
+#define SIMULATOR_REPORT_WINDOW 65536
+
+/* The number of send times kept for the requests of the server */
+#define SIMULATOR_REQUEST_WINDOW 1024
+
+/* The period in milliseconds at which the LBeacons send the reports due */
+#define SIMULATOR_TICK_IN_MS 10
+
+/* The time in milliseconds the receive thread waits for a message before
+   checking whether the simulation stops */
+#define SIMULATOR_POLL_TIMEOUT_IN_MS 100
+
+/* The receive buffer of the simulator socket in bytes */
+#define SIMULATOR_SOCKET_BUFFER_SIZE (8 * 1024 * 1024)
+
+
+/* The flows of messages measured by the simulator */
+typedef enum _SimulatedFlow {
+
+    /* request_to_join from a LBeacon and its join_response */
+    FLOW_JOIN = 0,
+
+    /* tracked_object_data from a LBeacon forwarded to the server */
+    FLOW_TRACKED_OBJECT_DATA = 1,
+
+    /* beacon_health_report from a LBeacon, answering a request of the
+       server, forwarded to the server */
+    FLOW_BEACON_HEALTH_REPORT = 2,
+
+    /* gateway_health_report requested by the server */
+    FLOW_GATEWAY_HEALTH_REPORT = 3,
+
+    /* tracked_object_data and health report requests from the server
+       broadcast to every LBeacon */
+    FLOW_BROADCAST = 4,
+
+    /* notification_alarm from the server sent to the agent */
+    FLOW_NOTIFICATION_ALARM = 5,
+
+    MAX_SIMULATED_FLOW = 6
+
+} SimulatedFlow;
+
+/* The counters and the latency of a flow */
+typedef struct {
+
+    uint64_t sent_count;
+
+    uint64_t received_count;
+
+    /* The time in nanoseconds from the message causing the flow to be sent
+       to the end of the flow being received */
+    Histogram latency;
+
+} FlowStatistics;
+
+typedef struct {
+
+    /* The address and receive port of the gateway under test */
+    char gateway_ip[NETWORK_ADDR_LENGTH];
+    int gateway_port;
+
+    /* The port the gateway sends to */
+    int send_port;
+
+    int number_lbeacons;
+
+    /* The time in seconds the LBeacons and the server send traffic */
+    int duration_in_sec;
+
+    /* The time in seconds to wait for the last responses */
+    int drain_time_in_sec;
+
+    /* The interval in milliseconds between the tracked_object_data of each
+       LBeacon */
+    int report_interval_in_ms;
+
+    /* The number of objects in each tracked_object_data */
+    int number_objects;
+
+    /* The intervals in milliseconds between the requests of the server, or
+       0 if the server does not send the request */
+    int health_request_interval_in_ms;
+    int broadcast_interval_in_ms;
+    int alarm_interval_in_ms;
+
+} SimulatorConfig;
+
+typedef struct {
+
+    SimulatorConfig config;
+
+    /* The socket the messages are sent from */
+    int send_socket;
+
+    /* The socket receiving the messages from the gateway */
+    int receive_socket;
+
+    struct sockaddr_in gateway_address;
+
+    /* The loopback address of each LBeacon */
+    struct in_addr lbeacon_addresses[MAX_NUMBER_NODES];
+    char lbeacon_ips[MAX_NUMBER_NODES][NETWORK_ADDR_LENGTH];
+
+    /* The uptime in nanoseconds at which each LBeacon sent request_to_join,
+       and whether the gateway accepted it */
+    uint64_t join_time_in_ns[MAX_NUMBER_NODES];
+    bool is_joined[MAX_NUMBER_NODES];
+    int number_joined;
+
+    /* The send times of the reports and requests by sequence number */
+    uint64_t report_time_in_ns[SIMULATOR_REPORT_WINDOW];
+    uint64_t health_request_time_in_ns[SIMULATOR_REQUEST_WINDOW];
+    uint64_t broadcast_time_in_ns[SIMULATOR_REQUEST_WINDOW];
+    uint64_t alarm_time_in_ns[SIMULATOR_REQUEST_WINDOW];
+
+    /* The number of reports and requests sent */
+    int number_reports;
+    int number_health_requests;
+    int number_broadcasts;
+    int number_alarms;
+
+    /* The uptime in nanoseconds at which the traffic started */
+    uint64_t start_time_in_ns;
+
+    FlowStatistics flows[MAX_SIMULATED_FLOW];
+
+    TimerQueue timers;
+
+    /* The flags keeping the timers and the receive thread running */
+    bool is_sending;
+    bool is_receiving;
+
+} Simulator;
+
+
+/*
+  send_simulated_message:
+
+     This function frames the content and sends it to the gateway from the
+     source address.
+
+  Parameters:
+
+     simulator - A pointer to the simulator.
+     source - The address the message is sent from.
+     content - The content of the message.
+
+  Return value:
+
+     ErrorCode - The error code for the corresponding error if the function
+                 fails or WORK SUCCESSFULLY otherwise
+ */
+ErrorCode send_simulated_message(Simulator *simulator,
+                                 struct in_addr source,
+                                 char *content);
+
+/*
+  send_join_requests:
+
+     This function sends request_to_join from every LBeacon.
+
+  Parameters:
+
+     simulator - A pointer to the simulator.
+
+  Return value:
+
+     None
+ */
+void send_join_requests(Simulator *simulator);
+
+/*
+  lbeacon_report_timer_routine:
+
+     This function is called by the timer queue to send the
+     tracked_object_data of the LBeacons due since the last call, so that
+     the reports are spread evenly over the report interval.
+
+  Parameters:
+
+     arg - A pointer to the simulator.
+
+  Return value:
+
+     None
+ */
+void lbeacon_report_timer_routine(void *arg);
+
+/*
+  health_request_timer_routine:
+
+     This function is called by the timer queue to send
+     gateway_health_report from the server.
+
+  Parameters:
+
+     arg - A pointer to the simulator.
+
+  Return value:
+
+     None
+ */
+void health_request_timer_routine(void *arg);
+
+/*
+  broadcast_timer_routine:
+
+     This function is called by the timer queue to send tracked_object_data
+     from the server to be broadcast to the LBeacons.
+
+  Parameters:
+
+     arg - A pointer to the simulator.
+
+  Return value:
+
+     None
+ */
+void broadcast_timer_routine(void *arg);
+
+/*
+  alarm_timer_routine:
+
+     This function is called by the timer queue to send notification_alarm
+     from the server to the agent.
+
+  Parameters:
+
+     arg - A pointer to the simulator.
+
+  Return value:
+
+     None
+ */
+void alarm_timer_routine(void *arg);
+
+/*
+  stop_timer_routine:
+
+     This function is called by the timer queue when the simulation ends.
+
+  Parameters:
+
+     arg - A pointer to the simulator.
+
+  Return value:
+
+     None
+ */
+void stop_timer_routine(void *arg);
+
+/*
+  handle_gateway_message:
+
+     This function measures a message received from the gateway and lets the
+     LBeacon it is sent to answer health report requests.
+
+  Parameters:
+
+     simulator - A pointer to the simulator.
+     destination - The address the message is sent to.
+     message - The received message terminated by a null character.
+
+  Return value:
+
+     None
+ */
+void handle_gateway_message(Simulator *simulator,
+                            struct in_addr destination,
+                            char *message);
+
+/*
+  simulator_receive_routine:
+
+     This function is executed by the thread which receives the messages
+     from the gateway until the simulation stops.
+
+  Parameters:
+
+     simulator - A pointer to the simulator.
+
+  Return value:
+
+     None
+ */
+void *simulator_receive_routine(void *simulator);
+
+/*
+  print_flow_statistics:
+
+     This function prints one line of comma separated values for each flow.
+
+  Parameters:
+
+     simulator - A pointer to the simulator.
+     elapsed_time_in_sec - The time in seconds the traffic was sent.
+
+  Return value:
+
+     None
+ */
+void print_flow_statistics(Simulator *simulator, double elapsed_time_in_sec);
+
+#endif
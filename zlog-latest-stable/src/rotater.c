@@ -6,6 +6,9 @@
  * Licensed under the LGPL v2.1, see the file COPYING in base directory.
  */
 
+/* for fallocate */
+#define _GNU_SOURCE
+
 #include <string.h>
 #include <glob.h>
 #include <stdio.h>
@@ -17,6 +20,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <zlib.h>
 
 #include "zc_defs.h"
 #include "rotater.h"
@@ -59,10 +63,24 @@ void zlog_rotater_profile(zlog_rotater_t * a_rotater, int flag)
 }
 
 /*******************************************************************************/
+static void *zlog_rotater_job_routine(void *arg);
+
 void zlog_rotater_del(zlog_rotater_t *a_rotater)
 {
 	zc_assert(a_rotater,);
 
+	/* segments switched out are archived before job_thread exits */
+	if (a_rotater->job_thread_started) {
+		pthread_mutex_lock(&(a_rotater->job_mutex));
+		a_rotater->job_exit = 1;
+		pthread_cond_signal(&(a_rotater->job_cond));
+		pthread_mutex_unlock(&(a_rotater->job_mutex));
+
+		if (pthread_join(a_rotater->job_thread, NULL)) {
+			zc_error("pthread_join fail, errno[%d]", errno);
+		}
+	}
+
 	if (a_rotater->lock_fd) {
 		if (close(a_rotater->lock_fd)) {
 			zc_error("close fail, errno[%d]", errno);
@@ -73,6 +91,9 @@ void zlog_rotater_del(zlog_rotater_t *a_rotater)
 		zc_error("pthread_mutex_destroy fail, errno[%d]", errno);
 	}
 
+	pthread_mutex_destroy(&(a_rotater->job_mutex));
+	pthread_cond_destroy(&(a_rotater->job_cond));
+
 	free(a_rotater);
 	zc_debug("zlog_rotater_del[%p]", a_rotater);
 	return;
@@ -97,6 +118,14 @@ zlog_rotater_t *zlog_rotater_new(char *lock_file)
 		return NULL;
 	}
 
+	if (pthread_mutex_init(&(a_rotater->job_mutex), NULL)
+		|| pthread_cond_init(&(a_rotater->job_cond), NULL)) {
+		zc_error("pthread_mutex_init or pthread_cond_init fail, errno[%d]", errno);
+		pthread_mutex_destroy(&(a_rotater->lock_mutex));
+		free(a_rotater);
+		return NULL;
+	}
+
 	/* depends on umask of the user here
 	 * if user A create /tmp/zlog.lock 0600
 	 * user B is unable to read /tmp/zlog.lock
@@ -112,6 +141,14 @@ zlog_rotater_t *zlog_rotater_new(char *lock_file)
 	a_rotater->lock_fd = fd;
 	a_rotater->lock_file = lock_file;
 
+	/* without job_thread, segments are archived by the logging threads */
+	if (pthread_create(&(a_rotater->job_thread), NULL,
+			zlog_rotater_job_routine, a_rotater)) {
+		zc_warn("pthread_create fail, errno[%d], archive in logging threads", errno);
+	} else {
+		a_rotater->job_thread_started = 1;
+	}
+
 	//zlog_rotater_profile(a_rotater, ZC_DEBUG);
 	return a_rotater;
 err:
@@ -273,11 +310,12 @@ static int zlog_rotater_seq_files(zlog_rotater_t * a_rotater)
 		return -1;
 	}
 
-	if (rename(a_rotater->base_path, new_path)) {
-		zc_error("rename[%s]->[%s] fail, errno[%d]", a_rotater->base_path, new_path, errno);
+	if (rename(a_rotater->segment_path, new_path)) {
+		zc_error("rename[%s]->[%s] fail, errno[%d]", a_rotater->segment_path, new_path, errno);
 		return -1;
 	}
 
+	strcpy(a_rotater->last_archive_path, new_path);
 	return 0;
 }
 
@@ -336,11 +374,12 @@ static int zlog_rotater_roll_files(zlog_rotater_t * a_rotater)
 		return -1;
 	}
 
-	if (rename(a_rotater->base_path, new_path)) {
-		zc_error("rename[%s]->[%s] fail, errno[%d]", a_rotater->base_path, new_path, errno);
+	if (rename(a_rotater->segment_path, new_path)) {
+		zc_error("rename[%s]->[%s] fail, errno[%d]", a_rotater->segment_path, new_path, errno);
 		return -1;
 	}
 
+	strcpy(a_rotater->last_archive_path, new_path);
 	return 0;
 }
 
@@ -412,6 +451,7 @@ static int zlog_rotater_parse_archive_path(zlog_rotater_t * a_rotater)
 static void zlog_rotater_clean(zlog_rotater_t *a_rotater)
 {
 	a_rotater->base_path = NULL;
+	a_rotater->segment_path = NULL;
 	a_rotater->archive_path = NULL;
 	a_rotater->max_count = 0;
 	a_rotater->mv_type = 0;
@@ -425,11 +465,13 @@ static void zlog_rotater_clean(zlog_rotater_t *a_rotater)
 }
 
 static int zlog_rotater_lsmv(zlog_rotater_t *a_rotater, 
-		char *base_path, char *archive_path, int archive_max_count)
+		char *base_path, char *segment_path,
+		char *archive_path, int archive_max_count)
 {
 	int rc = 0;
 
 	a_rotater->base_path = base_path;
+	a_rotater->segment_path = segment_path;
 	a_rotater->archive_path = archive_path;
 	a_rotater->max_count = archive_max_count;
 	rc = zlog_rotater_parse_archive_path(a_rotater);
@@ -526,6 +568,31 @@ static int zlog_rotater_unlock(zlog_rotater_t *a_rotater)
 	return rc;
 }
 
+static int zlog_rotater_lock(zlog_rotater_t *a_rotater)
+{
+	struct flock fl;
+
+	fl.l_type = F_WRLCK;
+	fl.l_start = 0;
+	fl.l_whence = SEEK_SET;
+	fl.l_len = 0;
+
+	if (pthread_mutex_lock(&(a_rotater->lock_mutex))) {
+		zc_error("pthread_mutex_lock fail, errno[%d]", errno);
+		return -1;
+	}
+
+	if (fcntl(a_rotater->lock_fd, F_SETLKW, &fl)) {
+		zc_error("lock fd[%d] fail, errno[%d]", a_rotater->lock_fd, errno);
+		if (pthread_mutex_unlock(&(a_rotater->lock_mutex))) {
+			zc_error("pthread_mutex_unlock fail, errno[%d]", errno);
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
 int zlog_rotater_rotate(zlog_rotater_t *a_rotater,
 		char *base_path, size_t msg_len,
 		char *archive_path, long archive_max_size, int archive_max_count)
@@ -555,7 +622,7 @@ int zlog_rotater_rotate(zlog_rotater_t *a_rotater,
 	}
 
 	/* begin list and move files */
-	rc = zlog_rotater_lsmv(a_rotater, base_path, archive_path, archive_max_count);
+	rc = zlog_rotater_lsmv(a_rotater, base_path, base_path, archive_path, archive_max_count);
 	if (rc) {
 		zc_error("zlog_rotater_lsmv [%s] fail, return", base_path);
 		rc = -1;
@@ -573,3 +640,311 @@ exit:
 }
 
 /*******************************************************************************/
+/* aa/bb.log -> aa/.bb.log<suffix>, which the glob of archives never matches */
+static int zlog_rotater_gen_hidden_path(char *hidden_path, size_t size,
+		char *path, char *suffix)
+{
+	int nwrite;
+	char *p;
+
+	p = strrchr(path, '/');
+	p = p ? p + 1 : path;
+
+	nwrite = snprintf(hidden_path, size, "%.*s.%s%s", (int)(p - path), path, p, suffix);
+	if (nwrite < 0 || nwrite >= size) {
+		zc_error("nwirte[%d], overflow or errno[%d]", nwrite, errno);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int zlog_rotater_is_gzip(char *archive_path)
+{
+	size_t len = strlen(archive_path);
+
+	return len > 3 && STRCMP(archive_path + len - 3, ==, ".gz");
+}
+
+/* compress path in place, so the names of archives are rolled as before */
+static int zlog_rotater_gzip(char *path)
+{
+	char tmp_path[MAXLEN_PATH + 1];
+	char buf[4096];
+	ssize_t nread;
+	int fd;
+	gzFile gz_file;
+	int rc = 0;
+
+	if (zlog_rotater_gen_hidden_path(tmp_path, sizeof(tmp_path), path, ".tmp")) {
+		return -1;
+	}
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		zc_error("open file[%s] fail, errno[%d]", path, errno);
+		return -1;
+	}
+
+	/* the lowest level, as the board has little cpu to spare */
+	gz_file = gzopen(tmp_path, "wb1");
+	if (!gz_file) {
+		zc_error("gzopen file[%s] fail, errno[%d]", tmp_path, errno);
+		close(fd);
+		return -1;
+	}
+
+	while ((nread = read(fd, buf, sizeof(buf))) > 0) {
+		if (gzwrite(gz_file, buf, nread) != nread) {
+			zc_error("gzwrite file[%s] fail", tmp_path);
+			rc = -1;
+			break;
+		}
+	}
+	if (nread < 0) {
+		zc_error("read file[%s] fail, errno[%d]", path, errno);
+		rc = -1;
+	}
+
+	if (gzclose(gz_file) != Z_OK) {
+		zc_error("gzclose file[%s] fail", tmp_path);
+		rc = -1;
+	}
+	close(fd);
+
+	if (rc == 0 && rename(tmp_path, path)) {
+		zc_error("rename[%s]->[%s] fail, errno[%d]", tmp_path, path, errno);
+		rc = -1;
+	}
+	if (rc) unlink(tmp_path);
+
+	return rc;
+}
+
+/* reserve the blocks of the next segment, so appending to it on a slow card
+ * does not allocate blocks one by one. the file size is kept for O_APPEND.
+ */
+static void zlog_rotater_preallocate(char *path, long size)
+{
+#ifdef __linux__
+	int fd;
+
+	fd = open(path, O_WRONLY);
+	if (fd < 0) return;
+
+	if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, size)) {
+		zc_debug("fallocate file[%s] fail, errno[%d]", path, errno);
+	}
+	close(fd);
+#endif
+}
+
+static void zlog_rotater_archive_segment(zlog_rotater_t *a_rotater, zlog_rotater_job_t *a_job)
+{
+	struct zlog_stat info;
+	int rc;
+
+	/* give back the blocks preallocated past the end of the segment */
+	if (stat(a_job->segment_path, &info) == 0) {
+		if (truncate(a_job->segment_path, info.st_size)) {
+			zc_debug("truncate file[%s] fail, errno[%d]", a_job->segment_path, errno);
+		}
+	}
+
+	if (zlog_rotater_lock(a_rotater)) {
+		zc_error("zlog_rotater_lock fail, segment[%s] is left", a_job->segment_path);
+		return;
+	}
+
+	rc = zlog_rotater_lsmv(a_rotater, a_job->base_path, a_job->segment_path,
+			a_job->archive_path, a_job->archive_max_count);
+	if (rc) {
+		zc_error("zlog_rotater_lsmv [%s] fail", a_job->segment_path);
+	} else if (zlog_rotater_is_gzip(a_job->archive_path)) {
+		if (zlog_rotater_gzip(a_rotater->last_archive_path)) {
+			zc_error("zlog_rotater_gzip [%s] fail", a_rotater->last_archive_path);
+		}
+	}
+
+	if (zlog_rotater_unlock(a_rotater)) {
+		zc_error("zlog_rotater_unlock fail");
+	}
+
+	zlog_rotater_preallocate(a_job->base_path, a_job->archive_max_size);
+}
+
+/* archive the segments switched out, waiting for more if wait is set */
+static void zlog_rotater_run_jobs(zlog_rotater_t *a_rotater, int wait)
+{
+	zlog_rotater_job_t a_job;
+
+	pthread_mutex_lock(&(a_rotater->job_mutex));
+	for (;;) {
+		while (wait && a_rotater->job_head == a_rotater->job_tail && !a_rotater->job_exit) {
+			pthread_cond_wait(&(a_rotater->job_cond), &(a_rotater->job_mutex));
+		}
+		if (a_rotater->job_head == a_rotater->job_tail) break;
+
+		memcpy(&a_job, &(a_rotater->jobs[a_rotater->job_head % ZLOG_ROTATER_MAX_JOBS]),
+			sizeof(a_job));
+		pthread_mutex_unlock(&(a_rotater->job_mutex));
+
+		zlog_rotater_archive_segment(a_rotater, &a_job);
+
+		pthread_mutex_lock(&(a_rotater->job_mutex));
+		a_rotater->job_head++;
+	}
+	pthread_mutex_unlock(&(a_rotater->job_mutex));
+}
+
+static void *zlog_rotater_job_routine(void *arg)
+{
+	zlog_rotater_run_jobs((zlog_rotater_t *)arg, 1);
+	return NULL;
+}
+
+/* the file of new_fd is put under the number *fd, which writers keep using.
+ * dup2 swaps the file atomically, so a write either goes to the old file,
+ * which stays open while the write is in progress, or to the new one, and
+ * never to a closed or reused fd.
+ */
+static int zlog_rotater_install_fd(int *fd, size_t *size, int new_fd, size_t new_size)
+{
+	if (dup2(new_fd, *fd) < 0) {
+		zc_error("dup2 fail, errno[%d]", errno);
+		close(new_fd);
+		return -1;
+	}
+	close(new_fd);
+	__atomic_store_n(size, new_size, __ATOMIC_RELAXED);
+	return 0;
+}
+
+int zlog_rotater_switch(zlog_rotater_t *a_rotater,
+		char *base_path, int *fd, size_t *size,
+		int open_flags, unsigned int perms,
+		char *archive_path, long archive_max_size, int archive_max_count)
+{
+	int rc = 0;
+	int new_fd;
+	int nwrite;
+	int is_replaced;
+	char suffix[32];
+	struct stat fd_stb;
+	struct stat path_stb;
+	zlog_rotater_job_t *a_job;
+
+	zc_assert(base_path, -1);
+	zc_assert(archive_path, -1);
+
+	if (pthread_mutex_lock(&(a_rotater->job_mutex))) {
+		zc_error("pthread_mutex_lock fail, errno[%d]", errno);
+		return -1;
+	}
+
+	/* switched by another thread already */
+	if (__atomic_load_n(size, __ATOMIC_RELAXED) < archive_max_size) goto exit;
+
+	/* the file may be deleted or replaced by an external tool while it is
+	 * open, then base_path is reopened instead of switched, like the
+	 * dev/inode check of zlog_rule_output_static_file_single
+	 */
+	if (fstat(*fd, &fd_stb)) {
+		zc_error("fstat fail on [%s], errno[%d]", base_path, errno);
+		rc = -1;
+		goto exit;
+	}
+	if (stat(base_path, &path_stb)) {
+		if (errno != ENOENT) {
+			zc_error("stat fail on [%s], errno[%d]", base_path, errno);
+			rc = -1;
+			goto exit;
+		}
+		is_replaced = 1;
+	} else {
+		is_replaced = (path_stb.st_ino != fd_stb.st_ino ||
+				path_stb.st_dev != fd_stb.st_dev);
+	}
+
+	if (is_replaced) {
+		new_fd = open(base_path, open_flags | O_WRONLY | O_APPEND | O_CREAT, perms);
+		if (new_fd < 0) {
+			zc_error("open file[%s] fail, errno[%d]", base_path, errno);
+			rc = -1;
+			goto exit;
+		}
+		if (fstat(new_fd, &path_stb)) {
+			zc_error("fstat fail on new file[%s], errno[%d]", base_path, errno);
+			close(new_fd);
+			rc = -1;
+			goto exit;
+		}
+		if (zlog_rotater_install_fd(fd, size, new_fd, path_stb.st_size)) rc = -1;
+		goto exit;
+	}
+
+	/* too many segments waiting, keep writing to the full file */
+	if (a_rotater->job_tail - a_rotater->job_head >= ZLOG_ROTATER_MAX_JOBS) {
+		zc_warn("[%ld] segments waiting, no switch", (long)ZLOG_ROTATER_MAX_JOBS);
+		goto exit;
+	}
+
+	a_job = &(a_rotater->jobs[a_rotater->job_tail % ZLOG_ROTATER_MAX_JOBS]);
+
+	snprintf(suffix, sizeof(suffix), ".%lu", a_rotater->job_tail);
+	if (zlog_rotater_gen_hidden_path(a_job->segment_path, sizeof(a_job->segment_path),
+			base_path, suffix)) {
+		rc = -1;
+		goto exit;
+	}
+
+	nwrite = snprintf(a_job->base_path, sizeof(a_job->base_path), "%s", base_path);
+	if (nwrite < 0 || nwrite >= sizeof(a_job->base_path)) {
+		zc_error("nwirte[%d], overflow or errno[%d]", nwrite, errno);
+		rc = -1;
+		goto exit;
+	}
+	nwrite = snprintf(a_job->archive_path, sizeof(a_job->archive_path), "%s", archive_path);
+	if (nwrite < 0 || nwrite >= sizeof(a_job->archive_path)) {
+		zc_error("nwirte[%d], overflow or errno[%d]", nwrite, errno);
+		rc = -1;
+		goto exit;
+	}
+	a_job->archive_max_size = archive_max_size;
+	a_job->archive_max_count = archive_max_count;
+
+	/* a rename and an open, the rest is left to job_thread */
+	if (rename(base_path, a_job->segment_path)) {
+		zc_error("rename[%s]->[%s] fail, errno[%d]", base_path, a_job->segment_path, errno);
+		rc = -1;
+		goto exit;
+	}
+
+	new_fd = open(base_path, open_flags | O_WRONLY | O_APPEND | O_CREAT, perms);
+	if (new_fd < 0) {
+		zc_error("open file[%s] fail, errno[%d]", base_path, errno);
+		if (rename(a_job->segment_path, base_path)) {
+			zc_error("rename[%s]->[%s] fail, errno[%d]", a_job->segment_path, base_path, errno);
+		}
+		rc = -1;
+		goto exit;
+	}
+
+	if (zlog_rotater_install_fd(fd, size, new_fd, 0)) {
+		if (rename(a_job->segment_path, base_path)) {
+			zc_error("rename[%s]->[%s] fail, errno[%d]", a_job->segment_path, base_path, errno);
+		}
+		rc = -1;
+		goto exit;
+	}
+
+	a_rotater->job_tail++;
+	pthread_cond_signal(&(a_rotater->job_cond));
+
+exit:
+	pthread_mutex_unlock(&(a_rotater->job_mutex));
+
+	if (!a_rotater->job_thread_started) zlog_rotater_run_jobs(a_rotater, 0);
+
+	return rc;
+}
@@ -11,13 +11,36 @@
 
 #include "zc_defs.h"
 
+/* the segments switched out and waiting to be archived */
+#define ZLOG_ROTATER_MAX_JOBS 16
+
+typedef struct {
+	char segment_path[MAXLEN_PATH + 1];	/* .aa.log.3 */
+	char base_path[MAXLEN_PATH + 1];	/* aa.log */
+	char archive_path[MAXLEN_PATH + 1];	/* aa.#5i.log.gz */
+	long archive_max_size;
+	int archive_max_count;
+} zlog_rotater_job_t;
+
 typedef struct zlog_rotater_s {
 	pthread_mutex_t lock_mutex;
 	char *lock_file;
 	int lock_fd;
 
+	/* segments are archived by job_thread, away from the logging threads */
+	pthread_t job_thread;
+	int job_thread_started;
+	pthread_mutex_t job_mutex;
+	pthread_cond_t job_cond;
+	zlog_rotater_job_t jobs[ZLOG_ROTATER_MAX_JOBS];
+	unsigned long job_head;			/* jobs archived */
+	unsigned long job_tail;			/* jobs switched out */
+	int job_exit;
+
 	/* single-use members */
 	char *base_path;			/* aa.log */
+	char *segment_path;			/* aa.log or .aa.log.3, moved to archive */
+	char last_archive_path[MAXLEN_PATH + 1];	/* aa.00000.log */
 	char *archive_path;			/* aa.#5i.log */
 	char glob_path[MAXLEN_PATH + 1];	/* aa.*.log */
 	size_t num_start_len;			/* 3, offset to glob_path */
@@ -40,6 +63,18 @@ int zlog_rotater_rotate(zlog_rotater_t *a_rotater,
 		char *base_path, size_t msg_len,
 		char *archive_path, long archive_max_size, int archive_max_count);
 
+/* switch a static file out of the way when it is full: base_path is renamed
+ * to a segment, reopened under the same number *fd by dup2, and the segment
+ * is archived by job_thread. writers never see *fd closed, so they need no
+ * lock around the write. if base_path was deleted or replaced by an external
+ * tool, it is reopened instead, and *size is set to its size.
+ * return 0 if switched, reopened or no need, -1 if fail.
+ */
+int zlog_rotater_switch(zlog_rotater_t *a_rotater,
+		char *base_path, int *fd, size_t *size,
+		int open_flags, unsigned int perms,
+		char *archive_path, long archive_max_size, int archive_max_count);
+
 void zlog_rotater_profile(zlog_rotater_t *a_rotater, int flag);
 
 #endif
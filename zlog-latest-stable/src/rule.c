@@ -160,38 +160,23 @@ static char * zlog_rule_gen_archive_path(zlog_rule_t *a_rule, zlog_thread_t *a_t
 static int zlog_rule_output_static_file_rotate(zlog_rule_t * a_rule, zlog_thread_t * a_thread)
 {
 	size_t len;
-	struct zlog_stat info;
-	int fd;
+	size_t size;
 
 	if (zlog_format_gen_msg(a_rule->format, a_thread)) {
 		zc_error("zlog_format_gen_msg fail");
 		return -1;
 	}
 
-	fd = open(a_rule->file_path, 
-		a_rule->file_open_flags | O_WRONLY | O_APPEND | O_CREAT, a_rule->file_perms);
-	if (fd < 0) {
-		zc_error("open file[%s] fail, errno[%d]", a_rule->file_path, errno);
-		return -1;
-	}
-
+	/* the file stays open, and its size is counted instead of stat every time,
+	 * so only one process may write to it
+	 */
 	len = zlog_buf_len(a_thread->msg_buf);
-	if (write(fd, zlog_buf_str(a_thread->msg_buf), len) < 0) {
+	if (write(a_rule->static_fd, zlog_buf_str(a_thread->msg_buf), len) < 0) {
 		zc_error("write fail, errno[%d]", errno);
-		close(fd);
-		return -1;
-	}
-
-	if (a_rule->fsync_period && ++a_rule->fsync_count >= a_rule->fsync_period) {
-		a_rule->fsync_count = 0;
-		if (fsync(fd)) zc_error("fsync[%d] fail, errno[%d]", fd, errno);
-	}
-
-	if (close(fd) < 0) {
-		zc_error("close fail, maybe cause by write, errno[%d]", errno);
 		return -1;
 	}
 
+	/* not so thread safe here, as multiple thread may ++fsync_count at the same time */
 	if (a_rule->fsync_period && ++a_rule->fsync_count >= a_rule->fsync_period) {
 		a_rule->fsync_count = 0;
 		if (fsync(a_rule->static_fd)) {
@@ -205,20 +190,18 @@ static int zlog_rule_output_static_file_rotate(zlog_rule_t * a_rule, zlog_thread
 		return 0;
 	}
 
-	if (stat(a_rule->file_path, &info)) {
-		zc_warn("stat [%s] fail, errno[%d], maybe in rotating", a_rule->file_path, errno);
-		return 0;
-	}
+	size = __atomic_add_fetch(&(a_rule->static_size), len, __ATOMIC_RELAXED);
 
 	/* file not so big, return */
-	if (info.st_size + len < a_rule->archive_max_size) return 0;
+	if (size < a_rule->archive_max_size) return 0;
 
-	if (zlog_rotater_rotate(zlog_env_conf->rotater, 
-		a_rule->file_path, len,
+	if (zlog_rotater_switch(zlog_env_conf->rotater,
+		a_rule->file_path, &(a_rule->static_fd),
+		&(a_rule->static_size), a_rule->file_open_flags, a_rule->file_perms,
 		zlog_rule_gen_archive_path(a_rule, a_thread),
 		a_rule->archive_max_size, a_rule->archive_max_count)
 		) {
-		zc_error("zlog_rotater_rotate fail");
+		zc_error("zlog_rotater_switch fail");
 		return -1;
 	} /* success or no rotation do nothing */
 
@@ -794,8 +777,8 @@ zlog_rule_t *zlog_rule_new(char *line,
 				}
 
 				p = strchr(a_rule->archive_path, '#');
-				if ( (p == NULL) && (
-						(strchr(p, 'r') == NULL) || (strchr(p, 's') == NULL)
+				if ( (p == NULL) || (
+						(strchr(p, 'r') == NULL) && (strchr(p, 's') == NULL)
 					)
 				   ) {
 					zc_error("archive_path must contain #r or #s");
@@ -817,7 +800,7 @@ zlog_rule_t *zlog_rule_new(char *line,
 			if (a_rule->archive_max_size <= 0) {
 				a_rule->output = zlog_rule_output_static_file_single;
 			} else {
-				/* as rotate, so need to reopen everytime */
+				/* kept open, and switched by the rotater when full */
 				a_rule->output = zlog_rule_output_static_file_rotate;
 			}
 
@@ -836,6 +819,7 @@ zlog_rule_t *zlog_rule_new(char *line,
 			}
 			a_rule->static_dev = stb.st_dev;
 			a_rule->static_ino = stb.st_ino;
+			a_rule->static_size = stb.st_size;
 		}
 		break;
 	case '|' :
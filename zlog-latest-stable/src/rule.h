@@ -47,6 +47,7 @@ struct zlog_rule_s {
 	int static_fd;
 	dev_t static_dev;
 	ino_t static_ino;
+	size_t static_size;	/* bytes written to static_fd, for rotation */
 
 	long archive_max_size;
 	int archive_max_count;